@@ -59,12 +59,15 @@
 #include "screen.h"
 #include "session.h"
 #include "settings.h"
+#include "spatial.h"
 #include "stacking.h"
 #include "startup_notification.h"
+#include "tabwin.h"
 #include "transients.h"
 #include "workspaces.h"
 #include "xsync.h"
 #include "event_filter.h"
+#include "eventrecord.h"
 
 /* Event mask definition */
 
@@ -271,6 +274,7 @@ clientUpdateName (Client *c)
     if (refresh)
     {
         frameQueueDraw (c, TRUE);
+        tabwinClientUpdateName (c);
     }
 }
 
@@ -309,7 +313,12 @@ clientUpdateAllFrames (ScreenInfo *screen_info, int mask)
             clientGrabButtons (c);
             clientGrabMouseButton (c);
         }
-        if (mask & UPDATE_CACHE)
+        /* The theme parts were reloaded, or the monitors changed */
+        if (clientUpdateTheme (c))
+        {
+            configure_flags |= CFG_FORCE_REDRAW;
+        }
+        else if (mask & UPDATE_CACHE)
         {
             clientUpdateIconPix (c);
         }
@@ -765,6 +774,11 @@ clientConfigure (Client *c, XWindowChanges * wc, unsigned long mask, unsigned sh
     {
         c->border_width = wc->border_width;
     }
+    if ((mask & (CWX | CWY | CWWidth | CWHeight)) && FLAG_TEST (c->flags, CLIENT_FLAG_HAS_STRUT))
+    {
+        /* The struts apply to the monitors the client is on */
+        placementInvalidateWorkArea (c->screen_info);
+    }
     if (mask & CWStackMode)
     {
         switch (wc->stack_mode)
@@ -848,6 +862,13 @@ clientConfigure (Client *c, XWindowChanges * wc, unsigned long mask, unsigned sh
         }
     }
 
+    /* Frames follow the scale of the monitor they are on */
+    if ((mask & (CWX | CWY | CWWidth | CWHeight)) && clientUpdateTheme (c))
+    {
+        mask |= (CWX | CWY | CWWidth | CWHeight);
+        flags |= CFG_FORCE_REDRAW;
+    }
+
     clientConfigureWindows (c, wc, mask, flags);
     /*
 
@@ -879,6 +900,8 @@ clientConfigure (Client *c, XWindowChanges * wc, unsigned long mask, unsigned sh
     c->applied_geometry.y = c->y;
     c->applied_geometry.width = c->width;
     c->applied_geometry.height = c->height;
+
+    spatialIndexUpdate (c);
 }
 
 void
@@ -1306,6 +1329,7 @@ clientGetWMNormalHints (Client *c, gboolean update)
     {
         c->width = wc.width;
         c->height = wc.height;
+        spatialIndexUpdate (c);
     }
 }
 
@@ -1395,6 +1419,9 @@ clientFree (Client *c)
     {
         g_free (c->hostname);
     }
+    tabwinClientRemove (c);
+    clearAppIconCache (c);
+    frameClearTitleCache (c);
     if (c->size)
     {
         XFree (c->size);
@@ -1509,7 +1536,7 @@ clientCheckShape (Client *c)
 static void
 clientUpdateIconPix (Client *c)
 {
-    ScreenInfo *screen_info;
+    ThemeParts *theme;
     gint size;
     GdkPixbuf *icon;
     int i;
@@ -1518,13 +1545,13 @@ clientUpdateIconPix (Client *c)
     g_return_if_fail (c->window != None);
     TRACE ("client \"%s\" (0x%lx)", c->name, c->window);
 
-    screen_info = c->screen_info;
+    theme = c->theme;
     for (i = 0; i < STATE_TOGGLED; i++)
     {
         xfwmPixmapFree (&c->appmenu[i]);
     }
 
-    if (xfwmPixmapNone(&screen_info->buttons[MENU_BUTTON][ACTIVE]))
+    if (xfwmPixmapNone(&theme->buttons[MENU_BUTTON][ACTIVE]))
     {
         /* The current theme has no menu button */
         return;
@@ -1532,13 +1559,13 @@ clientUpdateIconPix (Client *c)
 
     for (i = 0; i < STATE_TOGGLED; i++)
     {
-        if (!xfwmPixmapNone(&screen_info->buttons[MENU_BUTTON][i]))
+        if (!xfwmPixmapNone(&theme->buttons[MENU_BUTTON][i]))
         {
-            xfwmPixmapDuplicate (&screen_info->buttons[MENU_BUTTON][i], &c->appmenu[i]);
+            xfwmPixmapDuplicate (&theme->buttons[MENU_BUTTON][i], &c->appmenu[i]);
         }
     }
-    size = MIN (screen_info->buttons[MENU_BUTTON][ACTIVE].width,
-                screen_info->buttons[MENU_BUTTON][ACTIVE].height);
+    size = MIN (theme->buttons[MENU_BUTTON][ACTIVE].width,
+                theme->buttons[MENU_BUTTON][ACTIVE].height);
 
     if (size > 1)
     {
@@ -1571,6 +1598,8 @@ update_icon_idle_cb (gpointer data)
     {
         frameQueueDraw (c, FALSE);
     }
+    /* The window switcher shows the icon as well */
+    tabwinClientUpdateIcon (c);
     c->icon_timeout_id = 0;
 
     return FALSE;
@@ -1589,6 +1618,53 @@ clientUpdateIcon (Client *c)
     }
 }
 
+/*
+ * Picks the theme parts at the scale of the monitor the window is on,
+ * returns TRUE if the frame changed to another set, the caller has to
+ * redraw the frame then.
+ */
+gboolean
+clientUpdateTheme (Client *c)
+{
+    ScreenInfo *screen_info;
+    ThemeParts *theme;
+    gint scale;
+
+    g_return_val_if_fail (c != NULL, FALSE);
+    TRACE ("client \"%s\" (0x%lx)", c->name, c->window);
+
+    screen_info = c->screen_info;
+    scale = screen_info->default_scale;
+    if (screen_info->params->scale_decorations)
+    {
+        scale = myScreenGetScaleAtPoint (screen_info, c->x + c->width / 2, c->y + c->height / 2);
+    }
+
+    theme = myScreenGetThemeParts (screen_info, scale);
+    if (theme == c->theme)
+    {
+        return FALSE;
+    }
+    TRACE ("client \"%s\" (0x%lx) theme scale %i", c->name, c->window, theme->scale);
+
+    c->theme = theme;
+    /* The title text follows the scale of the parts */
+    frameClearTitleCache (c);
+
+    if (FLAG_TEST (c->xfwm_flags, XFWM_FLAG_MANAGED))
+    {
+        clientUpdateIconPix (c);
+        setNetFrameExtents (screen_info->display_info,
+                            c->window,
+                            frameTop (c),
+                            frameLeft (c),
+                            frameRight (c),
+                            frameBottom (c));
+    }
+
+    return TRUE;
+}
+
 void
 clientSaveSizePos (Client *c)
 {
@@ -1741,6 +1817,7 @@ _clientFrame (DisplayInfo *display_info,
     c->y = attr->y;
     c->width = attr->width;
     c->height = attr->height;
+    clientUpdateTheme (c);
 
     c->applied_geometry.x = c->x;
     c->applied_geometry.y = c->y;
@@ -1812,6 +1889,11 @@ _clientFrame (DisplayInfo *display_info,
 
     /* Timout for asynchronous icon update */
     c->icon_timeout_id = 0;
+    /* Window switcher widgets and preview */
+    tabwinClientAdd (c);
+    c->icon_set = NULL;
+    c->icon_cache = NULL;
+    c->icon_fetch_serial = 0;
     /* Timout for asynchronous frame update */
     c->frame_timeout_id = 0;
     /* Timeout for blinking on urgency */
@@ -1852,6 +1934,8 @@ _clientFrame (DisplayInfo *display_info,
         FLAG_SET (c->xfwm_flags, XFWM_FLAG_MAP_PENDING);
     }
     c->ignore_unmap = 0;
+    c->net_wm_state_len = -1;
+    c->net_wm_actions_len = -1;
     c->type = UNSET;
     c->type_atom = None;
 
@@ -1909,6 +1993,7 @@ _clientFrame (DisplayInfo *display_info,
         {
             clientInitPosition (c);
         }
+        clientUpdateTheme (c);
     }
     } /* Wayland guard */
 
@@ -2060,6 +2145,7 @@ if (!xfwmIsWaylandCompositor ())
 
     /* Notify the compositor about this new window */
     compositorAddWindow (display_info, c->frame, c);
+    eventRecordClient (c);
 } /* Wayland guard */
 
     if (!FLAG_TEST (c->flags, CLIENT_FLAG_ICONIFIED))
@@ -2104,6 +2190,8 @@ if (!xfwmIsWaylandCompositor ())
     c->xsync_counter = None;
     c->xsync_alarm = None;
     c->xsync_timeout_id = 0;
+    c->xsync_request_time = 0;
+    c->xsync_latency = 0;
     if (display_info->have_xsync)
     {
         clientGetXSyncCounter (c);
@@ -2179,6 +2267,8 @@ clientUnframe (Client *c, gboolean remap)
                          display_info->atoms[NET_WM_DESKTOP]);
         XDeleteProperty (display_info->dpy, c->window,
                          display_info->atoms[NET_WM_ALLOWED_ACTIONS]);
+        c->net_wm_state_len = -1;
+        c->net_wm_actions_len = -1;
     }
 
     xfwmWindowDelete (&c->title);
@@ -3150,6 +3240,7 @@ clientUpdateFullscreenSize (Client *c)
         c->y = wc.y;
         c->height = wc.height;
         c->width = wc.width;
+        spatialIndexUpdate (c);
     }
 }
 
@@ -3516,6 +3607,7 @@ clientToggleMaximizedAtPoint (Client *c, gint cx, gint cy, int mode, gboolean re
     c->y = wc.y;
     c->height = wc.height;
     c->width = wc.width;
+    spatialIndexUpdate (c);
 
     /* Maximizing may remove decoration on the side, update NET_FRAME_EXTENTS accordingly */
     setNetFrameExtents (display_info,
@@ -3825,6 +3917,7 @@ clientTile (Client *c, gint cx, gint cy, tilePositionType tile, gboolean send_co
     c->y = wc.y;
     c->height = wc.height;
     c->width = wc.width;
+    spatialIndexUpdate (c);
 
     if (send_configure)
     {
@@ -3922,6 +4015,7 @@ clientRecomputeTileSize (Client *c)
     c->y = wc.y;
     c->width = wc.width;
     c->height = wc.height;
+    spatialIndexUpdate (c);
 }
 
 void
@@ -4239,12 +4333,12 @@ clientButtonPressEventFilter (XfwmEvent *event, gpointer data)
             if (event->crossing.enter)
             {
                 c->button_status[b] = BUTTON_STATE_PRESSED;
-                frameQueueDraw (c, FALSE);
+                frameQueueDrawParts (c, FRAME_PART_BUTTON (b));
             }
             else
             {
                 c->button_status[b] = BUTTON_STATE_NORMAL;
-                frameQueueDraw (c, FALSE);
+                frameQueueDrawParts (c, FRAME_PART_BUTTON (b));
             }
             break;
         case XFWM_EVENT_XEVENT:
@@ -4313,7 +4407,7 @@ clientButtonPress (Client *c, Window w, XfwmEventButton *event)
     passdata.b = b;
 
     c->button_status[b] = BUTTON_STATE_PRESSED;
-    frameQueueDraw (c, FALSE);
+    frameQueueDrawParts (c, FRAME_PART_BUTTON (b));
 
     TRACE ("entering button press loop");
     eventFilterPush (display_info->xfilter, clientButtonPressEventFilter, &passdata);
@@ -4400,32 +4494,32 @@ clientGetButtonPixmap (Client *c, int button, int state)
             break;
         case SHADE_BUTTON:
             if (FLAG_TEST (c->flags, CLIENT_FLAG_SHADED)
-                && (!xfwmPixmapNone(&screen_info->buttons[SHADE_BUTTON][state + STATE_TOGGLED])))
+                && (!xfwmPixmapNone(&c->theme->buttons[SHADE_BUTTON][state + STATE_TOGGLED])))
             {
-                return &screen_info->buttons[SHADE_BUTTON][state + STATE_TOGGLED];
+                return &c->theme->buttons[SHADE_BUTTON][state + STATE_TOGGLED];
             }
-            return &screen_info->buttons[SHADE_BUTTON][state];
+            return &c->theme->buttons[SHADE_BUTTON][state];
             break;
         case STICK_BUTTON:
             if (FLAG_TEST (c->flags, CLIENT_FLAG_STICKY)
-                && (!xfwmPixmapNone(&screen_info->buttons[STICK_BUTTON][state + STATE_TOGGLED])))
+                && (!xfwmPixmapNone(&c->theme->buttons[STICK_BUTTON][state + STATE_TOGGLED])))
             {
-                return &screen_info->buttons[STICK_BUTTON][state + STATE_TOGGLED];
+                return &c->theme->buttons[STICK_BUTTON][state + STATE_TOGGLED];
             }
-            return &screen_info->buttons[STICK_BUTTON][state];
+            return &c->theme->buttons[STICK_BUTTON][state];
             break;
         case MAXIMIZE_BUTTON:
             if (FLAG_TEST (c->flags, CLIENT_FLAG_MAXIMIZED)
-                && (!xfwmPixmapNone(&screen_info->buttons[MAXIMIZE_BUTTON][state + STATE_TOGGLED])))
+                && (!xfwmPixmapNone(&c->theme->buttons[MAXIMIZE_BUTTON][state + STATE_TOGGLED])))
             {
-                return &screen_info->buttons[MAXIMIZE_BUTTON][state + STATE_TOGGLED];
+                return &c->theme->buttons[MAXIMIZE_BUTTON][state + STATE_TOGGLED];
             }
-            return &screen_info->buttons[MAXIMIZE_BUTTON][state];
+            return &c->theme->buttons[MAXIMIZE_BUTTON][state];
             break;
         default:
             break;
     }
-    return &screen_info->buttons[button][state];
+    return &c->theme->buttons[button][state];
 }
 
 int
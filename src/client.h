@@ -277,6 +277,24 @@ typedef enum
 }
 xfwmClientType;
 
+/* Everything the frame bounding shape depends upon, see frameSetShape() */
+typedef struct
+{
+    gboolean valid;
+    guint serial;
+    gint scale;
+    gint state;
+    gboolean shaded;
+    gboolean maximized;
+    gint width, height;
+    gint left, right, top, bottom;
+    gint title_width;
+    guint visible;
+    gint button_x[BUTTON_COUNT];
+    gint button_pixmap[BUTTON_COUNT];
+}
+FrameShapeKey;
+
 struct _Client
 {
     /* Reference to our screen structure */
@@ -310,6 +328,10 @@ struct _Client
     unsigned long initial_layer;
     unsigned int ignore_unmap;
     Atom type_atom;
+    Atom net_wm_state[16];  /* last values set, to skip redundant updates */
+    gint net_wm_state_len;
+    Atom net_wm_actions[16];
+    gint net_wm_actions_len;
     Visual *visual;
     XSizeHints *size;
     XWMHints *wmhints;
@@ -329,6 +351,9 @@ struct _Client
     GdkRectangle applied_geometry;
     GdkRectangle saved_geometry;
     GdkRectangle pre_fullscreen_geometry;
+    GdkRectangle spatial_range; /* cells of the spatial index holding the frame */
+    guint spatial_stamp;
+    guint stack_index;      /* position in windows_stack, from the bottom */
     gint pre_fullscreen_layer;
     gint pre_relayout_x;    /* to restore original location with XRandR */
     gint pre_relayout_y;
@@ -354,8 +379,29 @@ struct _Client
     gint dialog_fd;
     /* Timout for asynchronous icon update */
     guint icon_timeout_id;
+    /* Last preview shown in the window switcher */
+    GdkPixbuf *tabwin_thumbnail;
+    /* Window switcher widgets, one TabwinEntry per switcher window */
+    GPtrArray *tabwin_entries;
+    /* _NET_WM_ICON images and icons by size, see icons.c */
+    GPtrArray *icon_set;
+    GHashTable *icon_cache;
+    /* _NET_WM_ICON fetch in progress, see iconfetch.c */
+    guint icon_fetch_serial;
+    /* Theme parts at the scale of the monitor of the frame */
+    ThemeParts *theme;
+    /* Title layout and rendered text, see frame.c */
+    gchar *title_cache_name;
+    guint title_cache_serial;
+    PangoLayout *title_layout;
+    PangoRectangle title_logical;
+    PangoRectangle title_bounds;
+    cairo_surface_t *title_text[2];
+    /* Frame shape last applied */
+    FrameShapeKey frame_shape_key;
     /* Timout for asynchronous frame update */
     guint frame_timeout_id;
+    guint frame_dirty;      /* FRAME_PART_* pending redraw */
     /* Timout to manage blinking decorations for urgent windows */
     guint blink_timeout_id;
     /* Timout for asynchronous icon update */
@@ -390,6 +436,8 @@ struct _Client
     XSyncValue xsync_value;
     XSyncValue next_xsync_value;
     guint xsync_timeout_id;
+    gint64 xsync_request_time;
+    gint64 xsync_latency;
 #endif /* HAVE_XSYNC */
 };
 
@@ -427,6 +475,7 @@ void                     clientGetWMNormalHints                 (Client *,
                                                                  gboolean);
 void                     clientGetWMProtocols                   (Client *);
 void                     clientUpdateIcon                       (Client *);
+gboolean                 clientUpdateTheme                      (Client *);
 void                     clientSaveSizePos                      (Client *);
 gboolean                 clientRestoreSizePos                   (Client *);
 Client *                 _clientFrame                           (DisplayInfo *,
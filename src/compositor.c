@@ -57,6 +57,9 @@
 #include "frame.h"
 #include "hints.h"
 #include "compositor.h"
+#include "eventtrace.h"
+#include "xsync.h"
+#include "xaccount.h"
 
 #ifdef HAVE_COMPOSITOR
 #include "common/xfwm-common.h"
@@ -118,10 +121,18 @@
 #define TIMEOUT_THROTTLED_REPAINT_MS   500
 #endif /* TIMEOUT_THROTTLED_REPAINT_MS */
 
+#ifndef TIMEOUT_SAVED_PICTURE_MS
+#define TIMEOUT_SAVED_PICTURE_MS   250
+#endif /* TIMEOUT_SAVED_PICTURE_MS */
+
 #ifndef MONITOR_ROOT_PIXMAP
 #define MONITOR_ROOT_PIXMAP   1
 #endif /* MONITOR_ROOT_PIXMAP */
 
+#ifndef OUTLINE_WIDTH
+#define OUTLINE_WIDTH   2
+#endif /* OUTLINE_WIDTH */
+
 typedef struct _CWindow CWindow;
 struct _CWindow
 {
@@ -146,6 +157,10 @@ struct _CWindow
 #endif /* HAVE_NAME_WINDOW_PIXMAP */
     Picture picture;
     Picture saved_picture;
+    GList saved_link;
+    gsize saved_size;
+    gboolean picture_is_saved;
+    guint saved_timeout_id;
     Picture shadow;
     Picture alphaPict;
     Picture shadowPict;
@@ -164,6 +179,17 @@ struct _CWindow
 
     guint32 opacity;
     guint32 bypass_compositor;
+
+    guint64 frame_serial;
+    gint64 frame_drawn_time;
+    gboolean frame_drawn_pending;
+    gboolean frame_timings_pending;
+
+    /* Position in the scene while moved ahead of the X window */
+    gboolean translated;
+    gint translated_x;
+    gint translated_y;
+    gulong translated_serial;
 };
 
 static CWindow*
@@ -808,6 +834,136 @@ border_size (CWindow *cw)
     return border;
 }
 
+/*
+ * The last contents of unmapped windows are kept in saved_picture, so that
+ * they can be shown straight away when the window gets mapped again (e.g.
+ * when switching back to a workspace), until the client first repaints or
+ * for TIMEOUT_SAVED_PICTURE_MS at most, and used for thumbnails of windows
+ * that are not mapped. Those are kept in a LRU
+ * list per screen, bounded by the unmapped_cache_size setting in MiB.
+ */
+static void
+saved_picture_free (CWindow *cw)
+{
+    DisplayInfo *display_info;
+    ScreenInfo *screen_info;
+
+    screen_info = cw->screen_info;
+    display_info = screen_info->display_info;
+
+    if (cw->saved_size)
+    {
+        g_queue_unlink (&screen_info->saved_pictures, &cw->saved_link);
+        screen_info->saved_pictures_size -= cw->saved_size;
+        cw->saved_size = 0;
+    }
+
+    if (cw->saved_picture)
+    {
+        XRenderFreePicture (display_info->dpy, cw->saved_picture);
+        cw->saved_picture = None;
+    }
+}
+
+static void
+saved_picture_trim (ScreenInfo *screen_info)
+{
+    CWindow *cw;
+    gsize max_size;
+
+    max_size = (gsize) screen_info->params->unmapped_cache_size * 1024 * 1024;
+    while (screen_info->saved_pictures_size > max_size)
+    {
+        cw = (CWindow *) g_queue_peek_tail (&screen_info->saved_pictures);
+        TRACE ("evicting saved picture of window 0x%lx", cw->id);
+        saved_picture_free (cw);
+    }
+}
+
+static void
+saved_picture_drop (CWindow *cw)
+{
+    if (cw->saved_timeout_id)
+    {
+        g_source_remove (cw->saved_timeout_id);
+        cw->saved_timeout_id = 0;
+    }
+
+    if (!cw->picture_is_saved)
+    {
+        return;
+    }
+
+    /* Back to the live contents */
+    if (cw->picture)
+    {
+        XRenderFreePicture (cw->screen_info->display_info->dpy, cw->picture);
+        cw->picture = None;
+    }
+    cw->picture_is_saved = FALSE;
+}
+
+static void
+saved_picture_store (CWindow *cw)
+{
+    ScreenInfo *screen_info;
+
+    screen_info = cw->screen_info;
+    saved_picture_free (cw);
+    if (cw->saved_timeout_id)
+    {
+        g_source_remove (cw->saved_timeout_id);
+        cw->saved_timeout_id = 0;
+    }
+
+    cw->saved_picture = cw->picture;
+    cw->picture = None;
+    cw->picture_is_saved = FALSE;
+    if (cw->saved_picture == None)
+    {
+        return;
+    }
+
+    /* Count the border as well, assume 32 bits per pixel */
+    cw->saved_size = (gsize) (cw->attr.width + 2 * cw->attr.border_width) *
+                     (gsize) (cw->attr.height + 2 * cw->attr.border_width) * 4;
+    cw->saved_link.data = cw;
+    g_queue_push_head_link (&screen_info->saved_pictures, &cw->saved_link);
+    screen_info->saved_pictures_size += cw->saved_size;
+
+    saved_picture_trim (screen_info);
+}
+
+static gboolean
+saved_picture_restore (CWindow *cw)
+{
+    ScreenInfo *screen_info;
+
+    screen_info = cw->screen_info;
+    if (cw->saved_picture == None)
+    {
+        return FALSE;
+    }
+
+    /* Taken off the cache, now in use until the client repaints */
+    if (cw->saved_size)
+    {
+        g_queue_unlink (&screen_info->saved_pictures, &cw->saved_link);
+        screen_info->saved_pictures_size -= cw->saved_size;
+        cw->saved_size = 0;
+    }
+
+    if (cw->picture)
+    {
+        XRenderFreePicture (screen_info->display_info->dpy, cw->picture);
+    }
+    cw->picture = cw->saved_picture;
+    cw->saved_picture = None;
+    cw->picture_is_saved = TRUE;
+
+    return TRUE;
+}
+
 static void
 free_win_data (CWindow *cw, gboolean delete)
 {
@@ -876,17 +1032,14 @@ free_win_data (CWindow *cw, gboolean delete)
 
     if (delete)
     {
+        saved_picture_drop (cw);
         if (cw->picture)
         {
             XRenderFreePicture (display_info->dpy, cw->picture);
             cw->picture = None;
         }
         /* No need to keep this around */
-        if (cw->saved_picture)
-        {
-            XRenderFreePicture (display_info->dpy, cw->saved_picture);
-            cw->saved_picture = None;
-        }
+        saved_picture_free (cw);
 
         if (cw->damage)
         {
@@ -904,12 +1057,7 @@ free_win_data (CWindow *cw, gboolean delete)
     }
     else
     {
-        if (cw->saved_picture)
-        {
-            XRenderFreePicture (display_info->dpy, cw->saved_picture);
-        }
-        cw->saved_picture = cw->picture;
-        cw->picture = None;
+        saved_picture_store (cw);
     }
     myDisplayErrorTrapPopIgnored (display_info);
 }
@@ -2210,6 +2358,49 @@ paint_root (ScreenInfo *screen_info, Picture paint_buffer)
                       screen_info->height);
 }
 
+/*
+ * The outline drawn by the compositor for box move and resize is made of
+ * four strips, only those get damaged when the outline changes.
+ */
+static int
+outline_strips (XRectangle *outline, XRectangle *strips)
+{
+    if ((outline->width <= 2 * OUTLINE_WIDTH) || (outline->height <= 2 * OUTLINE_WIDTH))
+    {
+        strips[0] = *outline;
+        return 1;
+    }
+
+    /* Top and bottom */
+    strips[0].x = strips[1].x = outline->x;
+    strips[0].width = strips[1].width = outline->width;
+    strips[0].height = strips[1].height = OUTLINE_WIDTH;
+    strips[0].y = outline->y;
+    strips[1].y = outline->y + outline->height - OUTLINE_WIDTH;
+
+    /* Left and right, in between */
+    strips[2].y = strips[3].y = outline->y + OUTLINE_WIDTH;
+    strips[2].height = strips[3].height = outline->height - 2 * OUTLINE_WIDTH;
+    strips[2].width = strips[3].width = OUTLINE_WIDTH;
+    strips[2].x = outline->x;
+    strips[3].x = outline->x + outline->width - OUTLINE_WIDTH;
+
+    return 4;
+}
+
+static void
+paint_outline (ScreenInfo *screen_info, XserverRegion region, Picture paint_buffer)
+{
+    XRectangle strips[4];
+    int n_strips;
+
+    n_strips = outline_strips (&screen_info->outline, strips);
+    XFixesSetPictureClipRegion (myScreenGetXDisplay (screen_info),
+                                paint_buffer, 0, 0, region);
+    XRenderFillRectangles (myScreenGetXDisplay (screen_info), PictOpOver, paint_buffer,
+                           &screen_info->outline_color, strips, n_strips);
+}
+
 static void
 paint_cursor (ScreenInfo *screen_info, XserverRegion region, Picture paint_buffer)
 {
@@ -2598,6 +2789,11 @@ paint_all (ScreenInfo *screen_info, XserverRegion region, gushort buffer)
         }
     }
 
+    if (screen_info->outline_visible)
+    {
+        paint_outline (screen_info, region, paint_buffer);
+    }
+
     TRACE ("copying data back to screen");
 #ifdef HAVE_EPOXY
     if (screen_info->use_glx)
@@ -2686,6 +2882,113 @@ remove_timeouts (ScreenInfo *screen_info)
     }
 }
 
+#ifdef HAVE_XSYNC
+static guint32
+get_refresh_interval (ScreenInfo *screen_info)
+{
+    gint rate;
+
+    rate = xfwm_get_primary_refresh_rate (screen_info->gscr);
+    if (rate <= 0)
+    {
+        return 0;
+    }
+
+    return (guint32) (G_USEC_PER_SEC / rate);
+}
+
+static void
+frame_sync_drawn (ScreenInfo *screen_info)
+{
+    CWindow *cw;
+    GList *list;
+    gint64 now;
+    guint32 refresh_interval;
+    gboolean wait_present;
+
+    if (!screen_info->frames_drawn_pending)
+    {
+        return;
+    }
+    screen_info->frames_drawn_pending = FALSE;
+
+    now = g_get_monotonic_time ();
+    refresh_interval = get_refresh_interval (screen_info);
+#ifdef HAVE_PRESENT_EXTENSION
+    wait_present = (screen_info->use_present && screen_info->present_pending);
+#else
+    wait_present = FALSE;
+#endif /* HAVE_PRESENT_EXTENSION */
+
+    for (list = screen_info->cwindows; list; list = g_list_next (list))
+    {
+        cw = (CWindow *) list->data;
+        if (!cw->frame_drawn_pending)
+        {
+            continue;
+        }
+        cw->frame_drawn_pending = FALSE;
+        if (!WIN_HAS_CLIENT(cw))
+        {
+            continue;
+        }
+
+        clientXSyncFrameDrawn (cw->c, cw->frame_serial, now);
+        if (wait_present)
+        {
+            /* Timings are sent once we know when the frame was presented */
+            cw->frame_drawn_time = now;
+            cw->frame_timings_pending = TRUE;
+            screen_info->frames_timings_pending = TRUE;
+        }
+        else
+        {
+            clientXSyncFrameTimings (cw->c, cw->frame_serial, 0, refresh_interval);
+        }
+    }
+}
+
+#ifdef HAVE_PRESENT_EXTENSION
+static void
+frame_sync_presented (ScreenInfo *screen_info, guint64 ust)
+{
+    CWindow *cw;
+    GList *list;
+    guint32 refresh_interval;
+    gint32 offset;
+
+    if (!screen_info->frames_timings_pending)
+    {
+        return;
+    }
+    screen_info->frames_timings_pending = FALSE;
+
+    refresh_interval = get_refresh_interval (screen_info);
+    for (list = screen_info->cwindows; list; list = g_list_next (list))
+    {
+        cw = (CWindow *) list->data;
+        if (!cw->frame_timings_pending)
+        {
+            continue;
+        }
+        cw->frame_timings_pending = FALSE;
+        if (!WIN_HAS_CLIENT(cw))
+        {
+            continue;
+        }
+
+        /* The UST is on the monotonic clock, like the drawn time */
+        offset = 0;
+        if (ust > (guint64) cw->frame_drawn_time)
+        {
+            offset = (gint32) MIN (ust - (guint64) cw->frame_drawn_time, G_MAXINT32);
+        }
+        clientXSyncFrameTimings (cw->c, cw->frame_serial, offset, refresh_interval);
+    }
+}
+#endif /* HAVE_PRESENT_EXTENSION */
+#endif /* HAVE_XSYNC */
+
 static gboolean
 repair_screen (ScreenInfo *screen_info)
 {
@@ -2705,6 +3008,12 @@ repair_screen (ScreenInfo *screen_info)
         return FALSE;
     }
 
+    /* Damage keeps accumulating, compositorThaw() will repaint */
+    if (screen_info->compositor_freeze > 0)
+    {
+        return FALSE;
+    }
+
 #ifdef HAVE_PRESENT_EXTENSION
     /*
      * We do not paint the screen because we are waiting for
@@ -2713,7 +3022,7 @@ repair_screen (ScreenInfo *screen_info)
      if (screen_info->use_present && screen_info->present_pending)
      {
          DBG ("Waiting for Present");
-         return (screen_info->allDamage != None);
+         return ((screen_info->allDamage != None) || screen_info->frames_drawn_pending);
      }
 #endif /* HAVE_PRESENT_EXTENSION */
 
@@ -2734,7 +3043,7 @@ repair_screen (ScreenInfo *screen_info)
          if (status != GL_SIGNALED)
          {
              DBG ("Waiting for GL pipeline");
-             return (screen_info->allDamage != None);
+             return ((screen_info->allDamage != None) || screen_info->frames_drawn_pending);
          }
      }
 #else
@@ -2758,7 +3067,9 @@ repair_screen (ScreenInfo *screen_info)
         }
 
         remove_timeouts (screen_info);
+        xAccountBegin (display_info, "paint");
         paint_all (screen_info, damage, screen_info->current_buffer);
+        xAccountEnd (display_info);
 
         if (screen_info->use_n_buffers > 1)
         {
@@ -2779,6 +3090,11 @@ repair_screen (ScreenInfo *screen_info)
         screen_info->allDamage = None;
     }
 
+#ifdef HAVE_XSYNC
+    /* Whatever the clients drew so far is now on screen */
+    frame_sync_drawn (screen_info);
+#endif /* HAVE_XSYNC */
+
     return FALSE;
 }
 
@@ -2823,6 +3139,11 @@ compositor_timeout_cb (gpointer data)
 static void
 add_repair (ScreenInfo *screen_info)
 {
+    if (screen_info->compositor_freeze > 0)
+    {
+        return;
+    }
+
     if (screen_info->compositor_timeout_id == 0)
     {
         screen_info->compositor_timeout_id =
@@ -2921,6 +3242,22 @@ fix_region (CWindow *cw, XserverRegion region)
     }
 }
 
+static gboolean
+saved_picture_timeout (gpointer data)
+{
+    CWindow *cw;
+
+    cw = (CWindow *) data;
+    cw->saved_timeout_id = 0;
+
+    /* The client did not repaint in time, show whatever it has now */
+    TRACE ("dropping saved picture of window 0x%lx", cw->id);
+    saved_picture_drop (cw);
+    add_damage (cw->screen_info, win_extents (cw));
+
+    return FALSE;
+}
+
 static void
 repair_win (CWindow *cw, XRectangle *r)
 {
@@ -2940,6 +3277,17 @@ repair_win (CWindow *cw, XRectangle *r)
         return;
     }
 
+    if (cw->picture_is_saved)
+    {
+        /*
+         * With XDamageReportNonEmpty the client painting may be merged into
+         * this very first notification, switch to the live contents now and
+         * repaint the whole window from those.
+         */
+        saved_picture_drop (cw);
+        cw->damaged = FALSE;
+    }
+
     myDisplayErrorTrapPush (display_info);
     if (cw->damaged)
     {
@@ -2977,6 +3325,19 @@ damage_screen (ScreenInfo *screen_info)
     add_damage (screen_info, region);
 }
 
+static void
+damage_outline (ScreenInfo *screen_info)
+{
+    XRectangle strips[4];
+    XserverRegion damage;
+    int n_strips;
+
+    n_strips = outline_strips (&screen_info->outline, strips);
+    damage = XFixesCreateRegion (myScreenGetXDisplay (screen_info), strips, n_strips);
+    /* damage region will be destroyed by add_damage () */
+    add_damage (screen_info, damage);
+}
+
 static void
 damage_win (CWindow *cw)
 {
@@ -3143,6 +3504,11 @@ map_win (CWindow *cw)
 
     cw->viewable = TRUE;
     cw->damaged = FALSE;
+    if (saved_picture_restore (cw))
+    {
+        cw->saved_timeout_id =
+            g_timeout_add (TIMEOUT_SAVED_PICTURE_MS, saved_picture_timeout, cw);
+    }
 
     /* Check for new windows to un-redirect. */
     if (WIN_HAS_DAMAGE(cw) && WIN_IS_NATIVE_OPAQUE(cw) &&
@@ -3208,6 +3574,7 @@ unmap_win (CWindow *cw)
     cw->damaged = FALSE;
     cw->redirected = TRUE;
     cw->fulloverlay = FALSE;
+    cw->translated = FALSE;
 
     free_win_data (cw, FALSE);
 }
@@ -3400,6 +3767,9 @@ add_win (DisplayInfo *display_info, Window id, Client *c)
 #endif
     new->picture = None;
     new->saved_picture = None;
+    new->saved_size = 0;
+    new->picture_is_saved = FALSE;
+    new->saved_timeout_id = 0;
     new->alphaPict = None;
     new->alphaBorderPict = None;
     new->shadowPict = None;
@@ -3531,17 +3901,15 @@ resize_win (CWindow *cw, gint x, gint y, gint width, gint height, gint bw)
             cw->name_window_pixmap = None;
         }
 #endif
+        /* A new pixmap gets named for the new size */
+        saved_picture_drop (cw);
         if (cw->picture)
         {
             XRenderFreePicture (display_info->dpy, cw->picture);
             cw->picture = None;
         }
 
-        if (cw->saved_picture)
-        {
-            XRenderFreePicture (display_info->dpy, cw->saved_picture);
-            cw->saved_picture = None;
-        }
+        saved_picture_free (cw);
 
         if (cw->shadow)
         {
@@ -4011,8 +4379,25 @@ compositorHandleConfigureNotify (DisplayInfo *display_info, XConfigureEvent *ev)
     cw = find_cwindow_in_display (display_info, ev->window);
     if (is_on_compositor (cw))
     {
+        gint x, y;
+
+        x = ev->x;
+        y = ev->y;
+        if (cw->translated)
+        {
+            /* Older moves of the X window must not bring the scene back */
+            if ((cw->translated_serial != 0) && ((long) (ev->serial - cw->translated_serial) >= 0))
+            {
+                cw->translated = FALSE;
+            }
+            else
+            {
+                x = cw->translated_x;
+                y = cw->translated_y;
+            }
+        }
         restack_win (cw, ev->above);
-        resize_win (cw, ev->x, ev->y, ev->width, ev->height, ev->border_width);
+        resize_win (cw, x, y, ev->width, ev->height, ev->border_width);
     }
 }
 
@@ -4224,6 +4609,9 @@ compositorHandlePresentCompleteNotify (DisplayInfo *display_info, XPresentComple
         {
              DBG ("present completed, present pending cleared");
              screen_info->present_pending = FALSE;
+#ifdef HAVE_XSYNC
+             frame_sync_presented (screen_info, ev->ust);
+#endif /* HAVE_XSYNC */
              break;
         }
     }
@@ -4469,6 +4857,44 @@ compositorSetClient (DisplayInfo *display_info, Window id, Client *c)
     return FALSE;
 }
 
+/*
+ * Called when a client using the extended sync counter is done with a
+ * frame. Returns FALSE if the frame is not going through the compositor,
+ * in which case the caller reports it as drawn right away.
+ */
+gboolean
+compositorFrameComplete (Client *c, guint64 serial)
+{
+#ifdef HAVE_COMPOSITOR
+    ScreenInfo *screen_info;
+    CWindow *cw;
+
+    g_return_val_if_fail (c != NULL, FALSE);
+    TRACE ("client \"%s\" (0x%lx)", c->name, c->window);
+
+    screen_info = c->screen_info;
+    if (!compositorIsActive (screen_info))
+    {
+        return FALSE;
+    }
+
+    cw = find_cwindow_in_screen (screen_info, c->frame);
+    if ((cw == NULL) || !WIN_IS_REDIRECTED(cw) || !WIN_IS_VISIBLE(cw))
+    {
+        return FALSE;
+    }
+
+    cw->frame_serial = serial;
+    cw->frame_drawn_pending = TRUE;
+    screen_info->frames_drawn_pending = TRUE;
+    add_repair (screen_info);
+
+    return TRUE;
+#else
+    return FALSE;
+#endif /* HAVE_COMPOSITOR */
+}
+
 void
 compositorRemoveWindow (DisplayInfo *display_info, Window id)
 {
@@ -4533,6 +4959,147 @@ compositorResizeWindow (DisplayInfo *display_info, Window id, int x, int y, int
 #endif /* HAVE_COMPOSITOR */
 }
 
+/*
+ * Shows the box move/resize outline as part of the scene. Returns FALSE
+ * if the compositor is not active, the caller has to draw the outline
+ * by other means then.
+ */
+gboolean
+compositorSetOutline (ScreenInfo *screen_info, int x, int y, int width, int height)
+{
+#ifdef HAVE_COMPOSITOR
+    g_return_val_if_fail (screen_info != NULL, FALSE);
+    TRACE ("(%i,%i) %ix%i", x, y, width, height);
+
+    if (!compositorIsActive (screen_info))
+    {
+        return FALSE;
+    }
+
+    if (screen_info->outline_visible)
+    {
+        if ((screen_info->outline.x == x) && (screen_info->outline.y == y) &&
+            (screen_info->outline.width == width) && (screen_info->outline.height == height))
+        {
+            return TRUE;
+        }
+        damage_outline (screen_info);
+    }
+
+    screen_info->outline.x = x;
+    screen_info->outline.y = y;
+    screen_info->outline.width = MAX (width, 1);
+    screen_info->outline.height = MAX (height, 1);
+    screen_info->outline_visible = TRUE;
+    damage_outline (screen_info);
+
+    return TRUE;
+#else /* HAVE_COMPOSITOR */
+    return FALSE;
+#endif /* HAVE_COMPOSITOR */
+}
+
+void
+compositorSetOutlineColor (ScreenInfo *screen_info, gdouble red, gdouble green, gdouble blue)
+{
+#ifdef HAVE_COMPOSITOR
+    g_return_if_fail (screen_info != NULL);
+
+    screen_info->outline_color.red = (unsigned short) (CLAMP (red, 0.0, 1.0) * 0xffff);
+    screen_info->outline_color.green = (unsigned short) (CLAMP (green, 0.0, 1.0) * 0xffff);
+    screen_info->outline_color.blue = (unsigned short) (CLAMP (blue, 0.0, 1.0) * 0xffff);
+    screen_info->outline_color.alpha = 0xffff;
+#endif /* HAVE_COMPOSITOR */
+}
+
+void
+compositorHideOutline (ScreenInfo *screen_info)
+{
+#ifdef HAVE_COMPOSITOR
+    g_return_if_fail (screen_info != NULL);
+    TRACE ("entering");
+
+    if (!screen_info->outline_visible)
+    {
+        return;
+    }
+
+    screen_info->outline_visible = FALSE;
+    if (compositorIsActive (screen_info))
+    {
+        damage_outline (screen_info);
+    }
+#endif /* HAVE_COMPOSITOR */
+}
+
+/*
+ * Moves the window in the scene only, using its current picture, while
+ * the X window is moved at a lower rate. Returns FALSE if the window is
+ * not composited, in which case the caller has to move the X window.
+ */
+gboolean
+compositorTranslateWindow (DisplayInfo *display_info, Window id, int x, int y)
+{
+#ifdef HAVE_COMPOSITOR
+    CWindow *cw;
+
+    g_return_val_if_fail (display_info != NULL, FALSE);
+    g_return_val_if_fail (id != None, FALSE);
+    TRACE ("window 0x%lx (%i,%i)", id, x, y);
+
+    if (!compositorIsUsable (display_info))
+    {
+        return FALSE;
+    }
+
+    cw = find_cwindow_in_display (display_info, id);
+    if (!is_on_compositor (cw) || !cw->redirected || !WIN_IS_VISIBLE(cw))
+    {
+        return FALSE;
+    }
+
+    cw->translated = TRUE;
+    cw->translated_x = x;
+    cw->translated_y = y;
+    cw->translated_serial = 0;
+    resize_win (cw, x, y, cw->attr.width, cw->attr.height, cw->attr.border_width);
+
+    return TRUE;
+#else /* HAVE_COMPOSITOR */
+    return FALSE;
+#endif /* HAVE_COMPOSITOR */
+}
+
+/*
+ * To be called right before the X window is moved to its final position,
+ * the scene follows the X window again from that request onwards.
+ */
+void
+compositorTranslateWindowDone (DisplayInfo *display_info, Window id, int x, int y)
+{
+#ifdef HAVE_COMPOSITOR
+    CWindow *cw;
+
+    g_return_if_fail (display_info != NULL);
+    g_return_if_fail (id != None);
+    TRACE ("window 0x%lx", id);
+
+    if (!compositorIsUsable (display_info))
+    {
+        return;
+    }
+
+    cw = find_cwindow_in_display (display_info, id);
+    if (is_on_compositor (cw) && cw->translated)
+    {
+        cw->translated_x = x;
+        cw->translated_y = y;
+        cw->translated_serial = NextRequest (display_info->dpy);
+        resize_win (cw, x, y, cw->attr.width, cw->attr.height, cw->attr.border_width);
+    }
+#endif /* HAVE_COMPOSITOR */
+}
+
 /* May return None if:
  * - The xserver does not support name window pixmaps
  * - The compositor is disabled at run time
@@ -4576,6 +5143,10 @@ void
 compositorHandleEvent (DisplayInfo *display_info, XEvent *ev)
 {
 #ifdef HAVE_COMPOSITOR
+    const gchar *handler;
+    guint32 timestamp;
+    gint64 trace_start;
+
     g_return_if_fail (display_info != NULL);
     g_return_if_fail (ev != NULL);
     TRACE ("event type %i", ev->type);
@@ -4584,61 +5155,111 @@ compositorHandleEvent (DisplayInfo *display_info, XEvent *ev)
     {
         return;
     }
-    else if (ev->type == CreateNotify)
+
+    handler = NULL;
+    timestamp = (guint32) CurrentTime;
+    trace_start = eventTraceBegin ();
+
+    if (ev->type == CreateNotify)
     {
+        handler = "compositorHandleCreateNotify";
         compositorHandleCreateNotify (display_info, (XCreateWindowEvent *) ev);
     }
     else if (ev->type == DestroyNotify)
     {
+        handler = "compositorHandleDestroyNotify";
         compositorHandleDestroyNotify (display_info, (XDestroyWindowEvent *) ev);
     }
     else if (ev->type == ConfigureNotify)
     {
+        handler = "compositorHandleConfigureNotify";
         compositorHandleConfigureNotify (display_info, (XConfigureEvent *) ev);
     }
     else if (ev->type == ReparentNotify)
     {
+        handler = "compositorHandleReparentNotify";
         compositorHandleReparentNotify (display_info, (XReparentEvent *) ev);
     }
     else if (ev->type == Expose)
     {
+        handler = "compositorHandleExpose";
         compositorHandleExpose (display_info, (XExposeEvent *) ev);
     }
     else if (ev->type == CirculateNotify)
     {
+        handler = "compositorHandleCirculateNotify";
         compositorHandleCirculateNotify (display_info, (XCirculateEvent *) ev);
     }
     else if (ev->type == PropertyNotify)
     {
+        handler = "compositorHandlePropertyNotify";
+        timestamp = (guint32) ((XPropertyEvent *) ev)->time;
         compositorHandlePropertyNotify (display_info, (XPropertyEvent *) ev);
     }
     else if (ev->type == MapNotify)
     {
+        handler = "compositorHandleMapNotify";
         compositorHandleMapNotify (display_info, (XMapEvent *) ev);
     }
     else if (ev->type == UnmapNotify)
     {
+        handler = "compositorHandleUnmapNotify";
         compositorHandleUnmapNotify (display_info, (XUnmapEvent *) ev);
     }
     else if (ev->type == (display_info->damage_event_base + XDamageNotify))
     {
+        handler = "compositorHandleDamage";
+        timestamp = (guint32) ((XDamageNotifyEvent *) ev)->timestamp;
         compositorHandleDamage (display_info, (XDamageNotifyEvent *) ev);
     }
     else if (ev->type == (display_info->shape_event_base + ShapeNotify))
     {
+        handler = "compositorHandleShapeNotify";
         compositorHandleShapeNotify (display_info, (XShapeEvent *) ev);
     }
     else if (ev->type == (display_info->fixes_event_base + XFixesCursorNotify))
     {
+        handler = "compositorHandleCursorNotify";
         compositorHandleCursorNotify (display_info, (XFixesCursorNotifyEvent *) ev);
     }
 #ifdef HAVE_PRESENT_EXTENSION
     else if (ev->type == GenericEvent)
     {
+        handler = "compositorHandleGenericEvent";
         compositorHandleGenericEvent (display_info, (XGenericEvent *) ev);
     }
 #endif /* HAVE_PRESENT_EXTENSION */
 
+    eventTraceEnd (display_info, trace_start, handler, ev, timestamp);
+#endif /* HAVE_COMPOSITOR */
+}
+
+void
+compositorFreeze (ScreenInfo *screen_info)
+{
+#ifdef HAVE_COMPOSITOR
+    g_return_if_fail (screen_info != NULL);
+    TRACE ("entering");
+
+    screen_info->compositor_freeze++;
+#endif /* HAVE_COMPOSITOR */
+}
+
+void
+compositorThaw (ScreenInfo *screen_info)
+{
+#ifdef HAVE_COMPOSITOR
+    g_return_if_fail (screen_info != NULL);
+    g_return_if_fail (screen_info->compositor_freeze > 0);
+    TRACE ("entering");
+
+    screen_info->compositor_freeze--;
+    if ((screen_info->compositor_freeze == 0) &&
+        ((screen_info->allDamage != None) || screen_info->frames_drawn_pending))
+    {
+        /* Present all the damage accumulated meanwhile at once */
+        add_repair (screen_info);
+    }
 #endif /* HAVE_COMPOSITOR */
 }
 
@@ -4931,6 +5552,11 @@ compositorManageScreen (ScreenInfo *screen_info)
     screen_info->cwindow_hash = g_hash_table_new(g_direct_hash, g_direct_equal);
     screen_info->wins_unredirected = 0;
     screen_info->compositor_timeout_id = 0;
+    screen_info->compositor_freeze = 0;
+    screen_info->frames_drawn_pending = FALSE;
+    screen_info->frames_timings_pending = FALSE;
+    g_queue_init (&screen_info->saved_pictures);
+    screen_info->saved_pictures_size = 0;
     screen_info->zoomed = FALSE;
     screen_info->zoom_timeout_id = 0;
     screen_info->damages_pending = FALSE;
@@ -5056,6 +5682,8 @@ compositorUnmanageScreen (ScreenInfo *screen_info)
     screen_info->cwindow_hash = NULL;
     g_list_free (screen_info->cwindows);
     screen_info->cwindows = NULL;
+    g_queue_init (&screen_info->saved_pictures);
+    screen_info->saved_pictures_size = 0;
 
 #ifdef HAVE_EPOXY
     if (screen_info->use_glx)
@@ -5424,3 +6052,24 @@ compositorSetVblankMode (ScreenInfo *screen_info,
     screen_info->vblank_mode = vblank_mode;
 #endif /* HAVE_COMPOSITOR */
 }
+
+void
+compositorTrimSavedPictures (ScreenInfo *screen_info)
+{
+#ifdef HAVE_COMPOSITOR
+    DisplayInfo *display_info;
+
+    g_return_if_fail (screen_info != NULL);
+    TRACE ("entering");
+
+    display_info = screen_info->display_info;
+    if (!compositorIsActive (screen_info))
+    {
+        return;
+    }
+
+    myDisplayErrorTrapPush (display_info);
+    saved_picture_trim (screen_info);
+    myDisplayErrorTrapPopIgnored (display_info);
+#endif /* HAVE_COMPOSITOR */
+}
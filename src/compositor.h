@@ -42,6 +42,8 @@ void                     compositorAddWindow                    (DisplayInfo *,
 gboolean                 compositorSetClient                    (DisplayInfo *,
                                                                  Window,
                                                                  Client *);
+gboolean                 compositorFrameComplete                (Client *,
+                                                                 guint64);
 void                     compositorRemoveWindow                 (DisplayInfo *,
                                                                  Window);
 void                     compositorDamageWindow                 (DisplayInfo *,
@@ -52,12 +54,32 @@ void                     compositorResizeWindow                 (DisplayInfo *,
                                                                  int,
                                                                  int,
                                                                  int);
+gboolean                 compositorSetOutline                   (ScreenInfo *,
+                                                                 int,
+                                                                 int,
+                                                                 int,
+                                                                 int);
+void                     compositorSetOutlineColor              (ScreenInfo *,
+                                                                 gdouble,
+                                                                 gdouble,
+                                                                 gdouble);
+void                     compositorHideOutline                  (ScreenInfo *);
+gboolean                 compositorTranslateWindow              (DisplayInfo *,
+                                                                 Window,
+                                                                 int,
+                                                                 int);
+void                     compositorTranslateWindowDone          (DisplayInfo *,
+                                                                 Window,
+                                                                 int,
+                                                                 int);
 Pixmap                   compositorGetWindowPixmapAtSize        (ScreenInfo *,
                                                                  Window,
                                                                  guint *,
                                                                  guint *);
 void                     compositorHandleEvent                  (DisplayInfo *,
                                                                  XEvent *);
+void                     compositorFreeze                       (ScreenInfo *);
+void                     compositorThaw                         (ScreenInfo *);
 void                     compositorZoomIn                       (ScreenInfo *,
                                                                  XfwmEventButton *);
 void                     compositorZoomOut                      (ScreenInfo *,
@@ -82,6 +104,7 @@ gboolean                 compositorTestServer                   (DisplayInfo *);
 vblankMode               compositorParseVblankMode              (const gchar *);
 void                     compositorSetVblankMode                (ScreenInfo *,
                                                                  vblankMode);
+void                     compositorTrimSavedPictures            (ScreenInfo *);
 
 
 #endif /* INC_COMPOSITOR_H */
@@ -28,6 +28,7 @@
 #endif
 
 #include "display.h"
+#include "eventrecord.h"
 
 #ifdef HAVE_XI2
 static const struct
@@ -605,6 +606,7 @@ xfwm_device_check_mask_event (XfwmDevices *devices, Display *display,
     if (result)
     {
         xfwm_device_translate_event (devices, event->meta.xevent, event);
+        eventRecordEvent (event);
     }
 
     return result;
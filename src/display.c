@@ -107,6 +107,8 @@ myDisplayInitAtoms (DisplayInfo *display_info)
         "_NET_WM_BYPASS_COMPOSITOR",
         "_NET_WM_CONTEXT_HELP",
         "_NET_WM_DESKTOP",
+        "_NET_WM_FRAME_DRAWN",
+        "_NET_WM_FRAME_TIMINGS",
         "_NET_WM_FULLSCREEN_MONITORS",
         "_NET_WM_ICON",
         "_NET_WM_ICON_GEOMETRY",
@@ -212,6 +214,7 @@ myDisplayInit (GdkDisplay *gdisplay)
     display->session = NULL;
     display->quit = FALSE;
     display->reload = FALSE;
+    display->dump_trace = FALSE;
 
     /* Initialize internal atoms */
     if (!myDisplayInitAtoms (display))
@@ -755,7 +758,7 @@ myDisplayGetDefaultScreen (DisplayInfo *display)
 }
 
 guint32
-myDisplayUpdateCurrentTime (DisplayInfo *display, XfwmEvent *event)
+myDisplayGetEventTime (DisplayInfo *display, XfwmEvent *event)
 {
     guint32 timestamp;
     XEvent *xevent;
@@ -821,6 +824,17 @@ myDisplayUpdateCurrentTime (DisplayInfo *display, XfwmEvent *event)
             }
     }
 
+    return timestamp;
+}
+
+guint32
+myDisplayUpdateCurrentTime (DisplayInfo *display, XfwmEvent *event)
+{
+    guint32 timestamp;
+
+    g_return_val_if_fail (display != NULL, (guint32) CurrentTime);
+
+    timestamp = myDisplayGetEventTime (display, event);
     if ((timestamp != (guint32) CurrentTime))
     {
         display->current_time = timestamp;
@@ -227,6 +227,8 @@ enum
     NET_WM_BYPASS_COMPOSITOR,
     NET_WM_CONTEXT_HELP,
     NET_WM_DESKTOP,
+    NET_WM_FRAME_DRAWN,
+    NET_WM_FRAME_TIMINGS,
     NET_WM_FULLSCREEN_MONITORS,
     NET_WM_ICON,
     NET_WM_ICON_GEOMETRY,
@@ -298,6 +300,7 @@ typedef struct _xfwmPixmap        xfwmPixmap;
 typedef struct _XfwmParams        XfwmParams;
 typedef struct _ScreenInfo        ScreenInfo;
 typedef struct _Settings          Settings;
+typedef struct _ThemeParts        ThemeParts;
 
 struct _DisplayInfo
 {
@@ -307,6 +310,7 @@ struct _DisplayInfo
     XfceSMClient *session;
     gboolean quit;
     gboolean reload;
+    gboolean dump_trace;
 
     Window timestamp_win;
     Cursor busy_cursor;
@@ -426,6 +430,8 @@ Client                  *myDisplayGetClientFromXSyncAlarm       (DisplayInfo *,
                                                                  XSyncAlarm);
 #endif /* HAVE_XSYNC */
 ScreenInfo              *myDisplayGetDefaultScreen              (DisplayInfo *);
+guint32                  myDisplayGetEventTime                  (DisplayInfo *,
+                                                                 XfwmEvent *);
 guint32                  myDisplayUpdateCurrentTime             (DisplayInfo *,
                                                                  XfwmEvent *);
 guint32                  myDisplayGetCurrentTime                (DisplayInfo *);
@@ -32,6 +32,7 @@
 #include <libxfce4util/libxfce4util.h>
 #include "display.h"
 #include "event_filter.h"
+#include "eventrecord.h"
 
 static eventFilterStatus
 default_event_filter (XfwmEvent *event, gpointer data)
@@ -152,23 +153,16 @@ default_event_filter (XfwmEvent *event, gpointer data)
     return EVENT_FILTER_STOP;
 }
 
-static GdkFilterReturn
-eventXfwmFilter (GdkXEvent *gdk_xevent, GdkEvent *gevent, gpointer data)
+static eventFilterStatus
+eventFilterRun (eventFilterSetup *setup, XfwmEvent *event)
 {
-    XfwmEvent *event;
     eventFilterStatus loop;
-    eventFilterSetup *setup;
     eventFilterStack *filterelt;
 
-    setup = (eventFilterSetup *) data;
-    g_return_val_if_fail (setup != NULL, GDK_FILTER_CONTINUE);
-
     filterelt = setup->filterstack;
-    g_return_val_if_fail (filterelt != NULL, GDK_FILTER_CONTINUE);
+    g_return_val_if_fail (filterelt != NULL, EVENT_FILTER_CONTINUE);
 
-    event = xfwm_device_translate_event (setup->devices, (XEvent *)gdk_xevent, NULL);
     loop = EVENT_FILTER_CONTINUE;
-
     while ((filterelt) && (loop == EVENT_FILTER_CONTINUE))
     {
         eventFilterStack *filterelt_next = filterelt->next;
@@ -176,10 +170,42 @@ eventXfwmFilter (GdkXEvent *gdk_xevent, GdkEvent *gevent, gpointer data)
         filterelt = filterelt_next;
     }
 
+    return loop;
+}
+
+static GdkFilterReturn
+eventXfwmFilter (GdkXEvent *gdk_xevent, GdkEvent *gevent, gpointer data)
+{
+    XfwmEvent *event;
+    eventFilterStatus loop;
+    eventFilterSetup *setup;
+
+    setup = (eventFilterSetup *) data;
+    g_return_val_if_fail (setup != NULL, GDK_FILTER_CONTINUE);
+    g_return_val_if_fail (setup->filterstack != NULL, GDK_FILTER_CONTINUE);
+
+    event = xfwm_device_translate_event (setup->devices, (XEvent *)gdk_xevent, NULL);
+    eventRecordEvent (event);
+    loop = eventFilterRun (setup, event);
+
     xfwm_device_free_event (event);
     return (loop & EVENT_FILTER_REMOVE) ? GDK_FILTER_REMOVE : GDK_FILTER_CONTINUE;
 }
 
+void
+eventFilterDispatch (eventFilterSetup *setup, XEvent *xevent)
+{
+    XfwmEvent *event;
+
+    g_return_if_fail (setup != NULL);
+    g_return_if_fail (xevent != NULL);
+
+    event = xfwm_device_translate_event (setup->devices, xevent, NULL);
+    eventFilterRun (setup, event);
+
+    xfwm_device_free_event (event);
+}
+
 eventFilterStack *
 eventFilterPush (eventFilterSetup *setup, XfwmFilter filter, gpointer data)
 {
@@ -69,5 +69,7 @@ eventFilterStack        *eventFilterPop                         (eventFilterSetu
 eventFilterSetup        *eventFilterInit                        (XfwmDevices *,
                                                                  gpointer);
 void                     eventFilterClose                       (eventFilterSetup *);
+void                     eventFilterDispatch                    (eventFilterSetup *,
+                                                                 XEvent *);
 
 #endif /* INC_EVENT_FILTER_H */
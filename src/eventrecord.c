@@ -0,0 +1,604 @@
+/*      $Id$
+
+        This program is free software; you can redistribute it and/or modify
+        it under the terms of the GNU General Public License as published by
+        the Free Software Foundation; either version 2, or (at your option)
+        any later version.
+
+        This program is distributed in the hope that it will be useful,
+        but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+        GNU General Public License for more details.
+
+        You should have received a copy of the GNU General Public License
+        along with this program; if not, write to the Free Software
+        Foundation, Inc., Inc., 51 Franklin Street, Fifth Floor, Boston,
+        MA 02110-1301, USA.
+
+
+        xfwm4    - (c) 2002-2022 Olivier Fourdan
+
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <errno.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <X11/Xlib.h>
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <gtk/gtk.h>
+#include <libxfce4util/libxfce4util.h>
+
+#include "client.h"
+#include "device.h"
+#include "display.h"
+#include "event_filter.h"
+#include "eventrecord.h"
+#include "eventrecordfile.h"
+#include "screen.h"
+#include "xaccount.h"
+
+/*
+ * Pointers in the XEvent are meaningless once written out, so XI2 device
+ * events are stored as their core equivalent, which the device layer
+ * translates into the very same XfwmEvent, and other generic events are
+ * not recorded at all.
+ *
+ * Replaying feeds the recorded input events and client messages one at a
+ * time to the filter stack from a recursive idle source, so that the
+ * nested loops of interactive operations (move, resize, cycling) get
+ * their events from the recording as well. Everything else, mapping,
+ * configuring, properties, comes from the live clients of the replaying
+ * session: each client record of the recording is bound to the next
+ * client framed in the replaying session, waiting for it if need be, and
+ * the recorded window IDs are translated to the live ones from then on.
+ * Recorded timestamps are moved to the time of the replaying server.
+ */
+
+/* How long to wait for a live client to bind a client record to */
+#define REPLAY_CLIENT_TIMEOUT   5000
+#define REPLAY_CLIENT_POLL      10
+
+typedef struct _EventReplay EventReplay;
+struct _EventReplay
+{
+    DisplayInfo *display_info;
+    gchar *filename;
+    gchar *contents;
+    gsize length;
+    gsize offset;
+    guint count;
+    gint64 start;
+    gint64 wait_until;
+    guint64 first_request;
+    guint64 first_round_trip;
+    GHashTable *windows;
+    GQueue *clients;
+    guint32 time_offset;
+    gboolean have_time_offset;
+    gboolean quit;
+};
+
+static FILE *record_file = NULL;
+static gint64 record_origin = 0;
+static Window record_root = None;
+static EventReplay *replay_current = NULL;
+
+static void
+eventRecordSetRoot (Display *dpy)
+{
+    guint64 root;
+
+    if (G_LIKELY (record_root != None) || (dpy == NULL))
+    {
+        return;
+    }
+
+    /* The display is only known once events come in */
+    record_root = DefaultRootWindow (dpy);
+    root = (guint64) record_root;
+    fseek (record_file, offsetof (EventRecordHeader, root), SEEK_SET);
+    fwrite (&root, sizeof (root), 1, record_file);
+    fseek (record_file, 0, SEEK_END);
+}
+
+static void
+eventRecordClientWindows (Client *c, Window *windows)
+{
+    int i;
+
+    G_STATIC_ASSERT (RECORD_CLIENT_SIDES + SIDE_COUNT == RECORD_CLIENT_CORNERS);
+    G_STATIC_ASSERT (RECORD_CLIENT_CORNERS + CORNER_COUNT == RECORD_CLIENT_BUTTONS);
+    G_STATIC_ASSERT (RECORD_CLIENT_BUTTONS + BUTTON_COUNT <= RECORD_CLIENT_SLOTS);
+    G_STATIC_ASSERT (sizeof (EventRecordClient) <= sizeof (XEvent));
+
+    memset (windows, 0, sizeof (Window) * RECORD_CLIENT_SLOTS);
+    windows[RECORD_CLIENT_WINDOW] = c->window;
+    windows[RECORD_CLIENT_FRAME] = c->frame;
+    windows[RECORD_CLIENT_TITLE] = c->title.window;
+    for (i = 0; i < SIDE_COUNT; i++)
+    {
+        windows[RECORD_CLIENT_SIDES + i] = c->sides[i].window;
+    }
+    for (i = 0; i < CORNER_COUNT; i++)
+    {
+        windows[RECORD_CLIENT_CORNERS + i] = c->corners[i].window;
+    }
+    for (i = 0; i < BUTTON_COUNT; i++)
+    {
+        windows[RECORD_CLIENT_BUTTONS + i] = c->buttons[i].window;
+    }
+}
+
+static void
+eventRecordToCore (XfwmEvent *event, XEvent *xevent)
+{
+    XEvent *source;
+
+    source = event->meta.xevent;
+    memset (xevent, 0, sizeof (XEvent));
+    xevent->xany.serial = source->xany.serial;
+    xevent->xany.send_event = source->xany.send_event;
+    xevent->xany.window = event->meta.window;
+
+    switch (event->meta.type)
+    {
+        case XFWM_EVENT_KEY:
+            xevent->xkey.type = event->key.pressed ? KeyPress : KeyRelease;
+            xevent->xkey.root = event->key.root;
+            xevent->xkey.keycode = event->key.keycode;
+            xevent->xkey.state = event->key.state;
+            xevent->xkey.time = event->key.time;
+            xevent->xkey.same_screen = True;
+            break;
+        case XFWM_EVENT_BUTTON:
+            xevent->xbutton.type = event->button.pressed ? ButtonPress : ButtonRelease;
+            xevent->xbutton.root = event->button.root;
+            xevent->xbutton.subwindow = event->button.subwindow;
+            xevent->xbutton.button = event->button.button;
+            xevent->xbutton.state = event->button.state;
+            xevent->xbutton.x = event->button.x;
+            xevent->xbutton.y = event->button.y;
+            xevent->xbutton.x_root = event->button.x_root;
+            xevent->xbutton.y_root = event->button.y_root;
+            xevent->xbutton.time = event->button.time;
+            xevent->xbutton.same_screen = True;
+            break;
+        case XFWM_EVENT_MOTION:
+            xevent->xmotion.type = MotionNotify;
+            xevent->xmotion.x = event->motion.x;
+            xevent->xmotion.y = event->motion.y;
+            xevent->xmotion.x_root = event->motion.x_root;
+            xevent->xmotion.y_root = event->motion.y_root;
+            xevent->xmotion.time = event->motion.time;
+            xevent->xmotion.same_screen = True;
+            break;
+        case XFWM_EVENT_CROSSING:
+            xevent->xcrossing.type = event->crossing.enter ? EnterNotify : LeaveNotify;
+            xevent->xcrossing.root = event->crossing.root;
+            xevent->xcrossing.mode = event->crossing.mode;
+            xevent->xcrossing.detail = event->crossing.detail;
+            xevent->xcrossing.x_root = event->crossing.x_root;
+            xevent->xcrossing.y_root = event->crossing.y_root;
+            xevent->xcrossing.time = event->crossing.time;
+            xevent->xcrossing.same_screen = True;
+            break;
+        default:
+            break;
+    }
+}
+
+gboolean
+eventRecordStart (const gchar *filename)
+{
+    EventRecordHeader header;
+
+    g_return_val_if_fail (filename != NULL, FALSE);
+    g_return_val_if_fail (record_file == NULL, FALSE);
+
+    record_file = g_fopen (filename, "wb");
+    if (!record_file)
+    {
+        g_warning ("Cannot open event recording %s: %s", filename, g_strerror (errno));
+        return FALSE;
+    }
+
+    memset (&header, 0, sizeof (header));
+    g_strlcpy (header.magic, RECORD_MAGIC, sizeof (header.magic));
+    header.version = RECORD_VERSION;
+    header.event_size = sizeof (XEvent);
+    header.root = None;
+    fwrite (&header, sizeof (header), 1, record_file);
+
+    record_origin = g_get_monotonic_time ();
+    record_root = None;
+
+    return TRUE;
+}
+
+void
+eventRecordEvent (XfwmEvent *event)
+{
+    EventRecord record;
+
+    if (G_LIKELY (record_file == NULL))
+    {
+        return;
+    }
+
+    if (event->meta.xevent->type != GenericEvent)
+    {
+        record.xevent = *event->meta.xevent;
+    }
+    else if (event->meta.type != XFWM_EVENT_XEVENT)
+    {
+        eventRecordToCore (event, &record.xevent);
+    }
+    else
+    {
+        return;
+    }
+
+    eventRecordSetRoot (record.xevent.xany.display);
+    record.xevent.xany.display = NULL;
+    record.time = g_get_monotonic_time () - record_origin;
+    fwrite (&record, sizeof (record), 1, record_file);
+}
+
+void
+eventRecordClient (Client *c)
+{
+    EventRecordClient client;
+    EventRecord record;
+    Window *windows;
+
+    g_return_if_fail (c != NULL);
+
+    if (G_LIKELY (record_file == NULL) && G_LIKELY (replay_current == NULL))
+    {
+        return;
+    }
+
+    memset (&client, 0, sizeof (client));
+    client.type = RECORD_CLIENT;
+    eventRecordClientWindows (c, client.windows);
+
+    if (record_file)
+    {
+        eventRecordSetRoot (myScreenGetXDisplay (c->screen_info));
+        memset (&record, 0, sizeof (record));
+        memcpy (&record.xevent, &client, sizeof (client));
+        record.time = g_get_monotonic_time () - record_origin;
+        fwrite (&record, sizeof (record), 1, record_file);
+    }
+
+    if (replay_current)
+    {
+        windows = g_new (Window, RECORD_CLIENT_SLOTS);
+        memcpy (windows, client.windows, sizeof (client.windows));
+        g_queue_push_tail (replay_current->clients, windows);
+    }
+}
+
+void
+eventRecordStop (void)
+{
+    if (record_file)
+    {
+        fclose (record_file);
+        record_file = NULL;
+    }
+}
+
+static Window
+eventReplayWindow (EventReplay *replay, Window w)
+{
+    gpointer live;
+
+    if (w == None)
+    {
+        return None;
+    }
+
+    /* Unknown windows are kept as is, they simply match no client */
+    live = g_hash_table_lookup (replay->windows, GSIZE_TO_POINTER (w));
+
+    return live ? (Window) GPOINTER_TO_SIZE (live) : w;
+}
+
+static gboolean
+eventReplayBind (EventReplay *replay, EventRecordClient *client)
+{
+    Window *windows;
+    int i;
+
+    windows = g_queue_pop_head (replay->clients);
+    if (!windows)
+    {
+        return FALSE;
+    }
+
+    for (i = 0; i < RECORD_CLIENT_SLOTS; i++)
+    {
+        if (client->windows[i] && windows[i])
+        {
+            g_hash_table_insert (replay->windows,
+                                 GSIZE_TO_POINTER (client->windows[i]),
+                                 GSIZE_TO_POINTER (windows[i]));
+        }
+    }
+    g_free (windows);
+
+    return TRUE;
+}
+
+/*
+ * The data of a client message is only translated where the protocol puts
+ * a window, other values could happen to match a recorded window ID.
+ * Returns the index in data.l, or -1 if the message carries no window.
+ */
+static int
+eventReplayMessageWindowSlot (DisplayInfo *display_info, XClientMessageEvent *ev)
+{
+    if (ev->format != 32)
+    {
+        return -1;
+    }
+
+    if (ev->message_type == display_info->atoms[NET_ACTIVE_WINDOW])
+    {
+        /* The currently active window of the requestor */
+        return 2;
+    }
+    if ((ev->message_type == display_info->atoms[WM_PROTOCOLS]) &&
+        ((Atom) ev->data.l[0] == display_info->atoms[NET_WM_PING]))
+    {
+        /* The pinged client window, echoed back */
+        return 2;
+    }
+    if (ev->message_type == display_info->atoms[MANAGER])
+    {
+        /* The new selection owner */
+        return 2;
+    }
+
+    return -1;
+}
+
+static gboolean
+eventReplayTranslate (EventReplay *replay, XEvent *xevent)
+{
+    int slot;
+
+    switch (xevent->type)
+    {
+        case KeyPress:
+        case KeyRelease:
+        case ButtonPress:
+        case ButtonRelease:
+        case MotionNotify:
+        case EnterNotify:
+        case LeaveNotify:
+            /* All of these share the layout of XKeyEvent up to the time */
+            xevent->xkey.window = eventReplayWindow (replay, xevent->xkey.window);
+            xevent->xkey.root = eventReplayWindow (replay, xevent->xkey.root);
+            xevent->xkey.subwindow = eventReplayWindow (replay, xevent->xkey.subwindow);
+            if (!replay->have_time_offset)
+            {
+                replay->time_offset = myDisplayGetTime (replay->display_info, CurrentTime)
+                                      - (guint32) xevent->xkey.time;
+                replay->have_time_offset = TRUE;
+            }
+            xevent->xkey.time = (guint32) xevent->xkey.time + replay->time_offset;
+            return TRUE;
+        case ClientMessage:
+            xevent->xclient.window = eventReplayWindow (replay, xevent->xclient.window);
+            slot = eventReplayMessageWindowSlot (replay->display_info, &xevent->xclient);
+            if (slot >= 0)
+            {
+                xevent->xclient.data.l[slot] =
+                    eventReplayWindow (replay, xevent->xclient.data.l[slot]);
+            }
+            return TRUE;
+        default:
+            break;
+    }
+
+    return FALSE;
+}
+
+static void eventReplaySchedule (EventReplay *, guint);
+
+static void
+eventReplayFinish (EventReplay *replay)
+{
+    DisplayInfo *display_info;
+
+    display_info = replay->display_info;
+    XSync (display_info->dpy, FALSE);
+    g_print ("Replayed %u events from %s in %.1f ms, %" G_GUINT64_FORMAT " X requests, "
+             "%" G_GUINT64_FORMAT " round-trips\n",
+             replay->count, replay->filename,
+             (g_get_monotonic_time () - replay->start) / 1000.0,
+             xAccountGetRequests () - replay->first_request,
+             xAccountGetRoundTrips () - replay->first_round_trip);
+
+    if (replay->quit)
+    {
+        gtk_main_quit ();
+        display_info->quit = TRUE;
+    }
+
+    replay_current = NULL;
+    g_hash_table_destroy (replay->windows);
+    g_queue_free_full (replay->clients, g_free);
+    g_free (replay->filename);
+    g_free (replay->contents);
+    g_free (replay);
+}
+
+static gboolean
+eventReplayNext (gpointer data)
+{
+    EventReplay *replay;
+    EventRecord record;
+    EventRecordClient client;
+    DisplayInfo *display_info;
+
+    replay = (EventReplay *) data;
+    display_info = replay->display_info;
+
+    if (replay->offset + sizeof (EventRecord) > replay->length)
+    {
+        eventReplayFinish (replay);
+        return FALSE;
+    }
+
+    /* The recording has no alignment guarantee */
+    memcpy (&record, replay->contents + replay->offset, sizeof (EventRecord));
+
+    if (record.xevent.type == RECORD_CLIENT)
+    {
+        memcpy (&client, &record.xevent, sizeof (client));
+        if (!eventReplayBind (replay, &client))
+        {
+            if (replay->wait_until == 0)
+            {
+                replay->wait_until = g_get_monotonic_time () + REPLAY_CLIENT_TIMEOUT * 1000;
+            }
+            if (g_get_monotonic_time () < replay->wait_until)
+            {
+                /* Give the live client time to be mapped and framed */
+                eventReplaySchedule (replay, REPLAY_CLIENT_POLL);
+                return FALSE;
+            }
+            g_warning ("No client to replay client 0x%lx with, skipping it",
+                       client.windows[RECORD_CLIENT_WINDOW]);
+        }
+        replay->wait_until = 0;
+        replay->offset += sizeof (EventRecord);
+
+        return TRUE;
+    }
+
+    replay->offset += sizeof (EventRecord);
+    if (!eventReplayTranslate (replay, &record.xevent))
+    {
+        return TRUE;
+    }
+    replay->count++;
+
+    /* May recurse from a nested loop, do not use replay past this point */
+    record.xevent.xany.display = display_info->dpy;
+    eventFilterDispatch (display_info->xfilter, &record.xevent);
+
+    return TRUE;
+}
+
+static gboolean
+eventReplayResume (gpointer data)
+{
+    eventReplaySchedule ((EventReplay *) data, 0);
+
+    return FALSE;
+}
+
+static void
+eventReplaySchedule (EventReplay *replay, guint delay)
+{
+    GSource *source;
+
+    if (delay)
+    {
+        g_timeout_add (delay, eventReplayResume, replay);
+        return;
+    }
+
+    source = g_idle_source_new ();
+    g_source_set_can_recurse (source, TRUE);
+    g_source_set_callback (source, eventReplayNext, replay, NULL);
+    g_source_attach (source, NULL);
+    g_source_unref (source);
+}
+
+gboolean
+eventReplayStart (DisplayInfo *display_info, const gchar *filename, gboolean quit)
+{
+    EventRecordHeader header;
+    EventReplay *replay;
+    ScreenInfo *screen_info;
+    GSList *screens;
+    GList *list;
+    GError *error;
+    gchar *contents;
+    gsize length;
+    Window *windows;
+
+    g_return_val_if_fail (display_info != NULL, FALSE);
+    g_return_val_if_fail (filename != NULL, FALSE);
+    g_return_val_if_fail (replay_current == NULL, FALSE);
+
+    error = NULL;
+    if (!g_file_get_contents (filename, &contents, &length, &error))
+    {
+        g_warning ("Cannot read event recording: %s", error->message);
+        g_error_free (error);
+        return FALSE;
+    }
+
+    if (length >= sizeof (header))
+    {
+        memcpy (&header, contents, sizeof (header));
+    }
+    if ((length < sizeof (header)) ||
+        (strncmp (header.magic, RECORD_MAGIC, sizeof (header.magic)) != 0) ||
+        (header.version != RECORD_VERSION) ||
+        (header.event_size != sizeof (XEvent)))
+    {
+        g_warning ("%s is not a compatible event recording", filename);
+        g_free (contents);
+        return FALSE;
+    }
+
+    replay = g_new0 (EventReplay, 1);
+    replay->display_info = display_info;
+    replay->filename = g_strdup (filename);
+    replay->contents = contents;
+    replay->length = length;
+    replay->offset = sizeof (header);
+    replay->quit = quit;
+    replay->windows = g_hash_table_new (g_direct_hash, g_direct_equal);
+    replay->clients = g_queue_new ();
+    if (header.root != None)
+    {
+        g_hash_table_insert (replay->windows,
+                             GSIZE_TO_POINTER ((Window) header.root),
+                             GSIZE_TO_POINTER (DefaultRootWindow (display_info->dpy)));
+    }
+
+    /* Clients framed before the replay starts are bound first, in order */
+    for (screens = display_info->screens; screens; screens = g_slist_next (screens))
+    {
+        screen_info = (ScreenInfo *) screens->data;
+        for (list = screen_info->windows; list; list = g_list_next (list))
+        {
+            windows = g_new (Window, RECORD_CLIENT_SLOTS);
+            eventRecordClientWindows ((Client *) list->data, windows);
+            g_queue_push_tail (replay->clients, windows);
+        }
+    }
+    replay_current = replay;
+
+    replay->start = g_get_monotonic_time ();
+    replay->first_request = xAccountGetRequests ();
+    replay->first_round_trip = xAccountGetRoundTrips ();
+    eventReplaySchedule (replay, 0);
+
+    return TRUE;
+}
@@ -0,0 +1,80 @@
+/*      $Id$
+
+        This program is free software; you can redistribute it and/or modify
+        it under the terms of the GNU General Public License as published by
+        the Free Software Foundation; either version 2, or (at your option)
+        any later version.
+
+        This program is distributed in the hope that it will be useful,
+        but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+        GNU General Public License for more details.
+
+        You should have received a copy of the GNU General Public License
+        along with this program; if not, write to the Free Software
+        Foundation, Inc., Inc., 51 Franklin Street, Fifth Floor, Boston,
+        MA 02110-1301, USA.
+
+
+        xfwm4    - (c) 2002-2022 Olivier Fourdan
+
+ */
+
+#ifndef INC_EVENTRECORDFILE_H
+#define INC_EVENTRECORDFILE_H
+
+#include <X11/Xlib.h>
+#include <glib.h>
+
+/*
+ * On-disk layout of event recordings, shared with the tests which
+ * generate recordings from scenarios.
+ *
+ * A recording is a header followed by fixed size records, each made of
+ * the time since the start of the recording and a raw XEvent. Besides
+ * X events, a "client" record is written each time a client is framed,
+ * listing the client window and the windows of its frame, so that the
+ * window IDs of the recording can be bound to the windows of the
+ * replaying session.
+ */
+
+#define RECORD_MAGIC            "XFWMREC"
+#define RECORD_VERSION          2
+
+/* Private record type, past the range of core X events */
+#define RECORD_CLIENT           (LASTEvent + 1)
+
+/* Slots of a client record, sides, corners and buttons in their enum order */
+#define RECORD_CLIENT_WINDOW    0
+#define RECORD_CLIENT_FRAME     1
+#define RECORD_CLIENT_TITLE     2
+#define RECORD_CLIENT_SIDES     3
+#define RECORD_CLIENT_CORNERS   7
+#define RECORD_CLIENT_BUTTONS   11
+#define RECORD_CLIENT_SLOTS     20
+
+typedef struct _EventRecordHeader EventRecordHeader;
+struct _EventRecordHeader
+{
+    gchar magic[8];
+    guint32 version;
+    guint32 event_size;
+    guint64 root;
+};
+
+typedef struct _EventRecord EventRecord;
+struct _EventRecord
+{
+    gint64 time;
+    XEvent xevent;
+};
+
+/* Stored in place of the XEvent of a record */
+typedef struct _EventRecordClient EventRecordClient;
+struct _EventRecordClient
+{
+    int type;
+    Window windows[RECORD_CLIENT_SLOTS];
+};
+
+#endif /* INC_EVENTRECORDFILE_H */
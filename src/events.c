@@ -60,12 +60,15 @@
 #include "netwm.h"
 #include "menu.h"
 #include "hints.h"
+#include "icons.h"
 #include "startup_notification.h"
 #include "compositor.h"
 #include "events.h"
 #include "event_filter.h"
 #include "xsync.h"
 #include "display.h"
+#include "eventtrace.h"
+#include "xaccount.h"
 
 #ifndef CHECK_BUTTON_TIME
 #define CHECK_BUTTON_TIME 0
@@ -1144,6 +1147,7 @@ handleMapRequest (DisplayInfo *display_info, XMapRequestEvent * ev)
         return status;
     }
 
+    xAccountBegin (display_info, "map");
     c = myDisplayGetClientFromWindow (display_info, ev->window, SEARCH_WINDOW);
     if (c)
     {
@@ -1170,6 +1174,7 @@ handleMapRequest (DisplayInfo *display_info, XMapRequestEvent * ev)
     {
         clientFrameX11 (display_info, ev->window, FALSE);
     }
+    xAccountEnd (display_info);
 
     status = EVENT_FILTER_REMOVE;
     return status;
@@ -1357,7 +1362,7 @@ handleEnterNotify (DisplayInfo *display_info, XfwmEventCrossing *event)
     ScreenInfo *screen_info;
     Client *c;
     int b;
-    gboolean need_redraw;
+    guint redraw_parts;
 
     /* See http://rfc-ref.org/RFC-TEXTS/1013/chapter12.html for details */
 
@@ -1372,7 +1377,7 @@ handleEnterNotify (DisplayInfo *display_info, XfwmEventCrossing *event)
 
     TRACE ("window (0x%lx)", event->meta.window);
 
-    need_redraw = FALSE;
+    redraw_parts = 0;
     c = myDisplayGetClientFromWindow (display_info, event->meta.window,
                                       SEARCH_FRAME | SEARCH_BUTTON);
     if (c)
@@ -1408,13 +1413,13 @@ handleEnterNotify (DisplayInfo *display_info, XfwmEventCrossing *event)
                     if (!xfwmPixmapNone(clientGetButtonPixmap(c, b, PRELIGHT)))
                     {
                         c->button_status[b] = BUTTON_STATE_PRELIGHT;
-                        need_redraw = TRUE;
+                        redraw_parts |= FRAME_PART_BUTTON (b);
                     }
                 }
             }
-            if (need_redraw)
+            if (redraw_parts)
             {
-                frameQueueDraw (c, FALSE);
+                frameQueueDrawParts (c, redraw_parts);
             }
         }
 
@@ -1451,11 +1456,11 @@ handleLeaveNotify (DisplayInfo *display_info, XfwmEventCrossing *event)
 {
     Client *c;
     int b;
-    gboolean need_redraw;
+    guint redraw_parts;
 
     TRACE ("entering");
 
-    need_redraw = FALSE;
+    redraw_parts = 0;
     c = myDisplayGetClientFromWindow (display_info, event->meta.window,
                                       SEARCH_FRAME | SEARCH_BUTTON);
     if (c)
@@ -1467,13 +1472,13 @@ handleLeaveNotify (DisplayInfo *display_info, XfwmEventCrossing *event)
                 if (MYWINDOW_XWINDOW(c->buttons[b]) == event->meta.window)
                 {
                     c->button_status[b] = BUTTON_STATE_NORMAL;
-                    need_redraw = TRUE;
+                    redraw_parts |= FRAME_PART_BUTTON (b);
                 }
             }
         }
-        if (need_redraw)
+        if (redraw_parts)
         {
-            frameQueueDraw (c, FALSE);
+            frameQueueDrawParts (c, redraw_parts);
         }
 
         /* No need to process the event any further */
@@ -1652,6 +1657,7 @@ handlePropertyNotify (DisplayInfo *display_info, XPropertyEvent * ev)
 {
     eventFilterStatus status;
     ScreenInfo *screen_info;
+    gboolean had_icon_pixmap;
     Client *c;
 
     TRACE ("entering");
@@ -1685,8 +1691,10 @@ handlePropertyNotify (DisplayInfo *display_info, XPropertyEvent * ev)
             TRACE ("client \"%s\" (0x%lx) has received a XA_WM_HINTS notify", c->name, c->window);
 
             /* Free previous wmhints if any */
+            had_icon_pixmap = FALSE;
             if (c->wmhints)
             {
+                had_icon_pixmap = (c->wmhints->flags & IconPixmapHint) != 0;
                 XFree (c->wmhints);
             }
 
@@ -1700,9 +1708,17 @@ handlePropertyNotify (DisplayInfo *display_info, XPropertyEvent * ev)
                 {
                     c->group_leader = c->wmhints->window_group;
                 }
-                if ((c->wmhints->flags & IconPixmapHint) && (screen_info->params->show_app_icon))
+                if (c->wmhints->flags & IconPixmapHint)
                 {
-                    clientUpdateIcon (c);
+                    invalidateAppIcon (c, FALSE);
+                    if (screen_info->params->show_app_icon)
+                    {
+                        clientUpdateIcon (c);
+                    }
+                }
+                else if (had_icon_pixmap)
+                {
+                    invalidateAppIcon (c, FALSE);
                 }
                 if (HINTS_ACCEPT_INPUT (c->wmhints))
                 {
@@ -1800,11 +1816,14 @@ handlePropertyNotify (DisplayInfo *display_info, XPropertyEvent * ev)
                 FLAG_UNSET (c->xfwm_flags, XFWM_FLAG_OPACITY_LOCKED);
             }
         }
-        else if ((screen_info->params->show_app_icon) &&
-                 ((ev->atom == display_info->atoms[NET_WM_ICON]) ||
-                  (ev->atom == display_info->atoms[KWM_WIN_ICON])))
+        else if ((ev->atom == display_info->atoms[NET_WM_ICON]) ||
+                 (ev->atom == display_info->atoms[KWM_WIN_ICON]))
         {
-            clientUpdateIcon (c);
+            invalidateAppIcon (c, (ev->atom == display_info->atoms[NET_WM_ICON]));
+            if (screen_info->params->show_app_icon)
+            {
+                clientUpdateIcon (c);
+            }
         }
         else if (ev->atom == display_info->atoms[GTK_FRAME_EXTENTS])
         {
@@ -2165,46 +2184,61 @@ static eventFilterStatus
 handleEvent (DisplayInfo *display_info, XfwmEvent *event)
 {
     eventFilterStatus status;
+    const gchar *handler;
+    guint32 timestamp;
+    gint64 trace_start;
+
     status = EVENT_FILTER_PASS;
+    handler = NULL;
 
     TRACE ("entering");
 
     /* Update the display time */
+    timestamp = myDisplayGetEventTime (display_info, event);
     myDisplayUpdateCurrentTime (display_info, event);
     sn_process_event (event->meta.xevent);
 
+    trace_start = eventTraceBegin ();
+
     switch (event->meta.type)
     {
         case XFWM_EVENT_KEY:
             if (event->key.pressed)
             {
+                handler = "handleKeyPress";
                 status = handleKeyPress (display_info, &event->key);
             }
             else
             {
+                handler = "handleKeyRelease";
                 status = handleKeyRelease (display_info, &event->key);
             }
             break;
         case XFWM_EVENT_BUTTON:
             if (event->button.pressed)
             {
+                handler = "handleButtonPress";
                 status = handleButtonPress (display_info, &event->button);
             }
             else
             {
+                handler = "handleButtonRelease";
                 status = handleButtonRelease (display_info, &event->button);
             }
             break;
         case XFWM_EVENT_MOTION:
+            handler = "handleMotionNotify";
             status = handleMotionNotify (display_info, &event->motion);
             break;
         case XFWM_EVENT_CROSSING:
             if (event->crossing.enter)
             {
+                handler = "handleEnterNotify";
                 status = handleEnterNotify (display_info, &event->crossing);
             }
             else
             {
+                handler = "handleLeaveNotify";
                 status = handleLeaveNotify (display_info, &event->crossing);
             }
             break;
@@ -2212,54 +2246,75 @@ handleEvent (DisplayInfo *display_info, XfwmEvent *event)
             switch (event->meta.xevent->type)
             {
                 case DestroyNotify:
+                    handler = "handleDestroyNotify";
                     status = handleDestroyNotify (display_info, (XDestroyWindowEvent *) event->meta.xevent);
                     break;
                 case UnmapNotify:
+                    handler = "handleUnmapNotify";
                     status = handleUnmapNotify (display_info, (XUnmapEvent *) event->meta.xevent);
                     break;
                 case MapRequest:
+                    handler = "handleMapRequest";
                     status = handleMapRequest (display_info, (XMapRequestEvent *) event->meta.xevent);
                     break;
                 case MapNotify:
+                    handler = "handleMapNotify";
                     status = handleMapNotify (display_info, (XMapEvent *) event->meta.xevent);
                     break;
                 case ConfigureNotify:
+                    handler = "handleConfigureNotify";
                     status = handleConfigureNotify (display_info, (XConfigureEvent *) event->meta.xevent);
                     break;
                 case ConfigureRequest:
+                    handler = "handleConfigureRequest";
+                    xAccountBegin (display_info, "configure request");
                     status = handleConfigureRequest (display_info, (XConfigureRequestEvent *) event->meta.xevent);
+                    xAccountEnd (display_info);
                     break;
                 case FocusIn:
+                    handler = "handleFocusIn";
                     status = handleFocusIn (display_info, (XFocusChangeEvent *) event->meta.xevent);
                     break;
                 case FocusOut:
+                    handler = "handleFocusOut";
                     status = handleFocusOut (display_info, (XFocusChangeEvent *) event->meta.xevent);
                     break;
                 case PropertyNotify:
+                    handler = "handlePropertyNotify";
+                    xAccountBegin (display_info, "property");
                     status = handlePropertyNotify (display_info, (XPropertyEvent *) event->meta.xevent);
+                    xAccountEnd (display_info);
                     break;
                 case ClientMessage:
+                    handler = "handleClientMessage";
+                    xAccountBegin (display_info, "client message");
                     status = handleClientMessage (display_info, (XClientMessageEvent *) event->meta.xevent);
+                    xAccountEnd (display_info);
                     break;
                 case SelectionClear:
+                    handler = "handleSelectionClear";
                     status = handleSelectionClear (display_info, (XSelectionClearEvent *) event->meta.xevent);
                     break;
                 case ColormapNotify:
+                    handler = "handleColormapNotify";
                     handleColormapNotify (display_info, (XColormapEvent *) event->meta.xevent);
                     break;
                 case ReparentNotify:
+                    handler = "handleReparentNotify";
                     status = handleReparentNotify (display_info, (XReparentEvent *) event->meta.xevent);
                     break;
                 default:
                     if ((display_info->have_shape) &&
                             (event->meta.xevent->type == display_info->shape_event_base))
                     {
+                        handler = "handleShape";
                         status = handleShape (display_info, (XShapeEvent *) event->meta.xevent);
                     }
 #ifdef HAVE_XSYNC
                     if ((display_info->have_xsync) &&
                             (event->meta.xevent->type == (display_info->xsync_event_base + XSyncAlarmNotify)))
                     {
+                        handler = "handleXSyncAlarmNotify";
                         status = handleXSyncAlarmNotify (display_info, (XSyncAlarmNotifyEvent *) event->meta.xevent);
                     }
 #endif /* HAVE_XSYNC */
@@ -2267,8 +2322,16 @@ handleEvent (DisplayInfo *display_info, XfwmEvent *event)
             }
             break;
     }
+    eventTraceEnd (display_info, trace_start, handler, event->meta.xevent, timestamp);
+
     if (!gdk_events_pending () && !XPending (display_info->dpy))
     {
+        if (display_info->dump_trace)
+        {
+            eventTraceDump (display_info);
+            xAccountDump ();
+            display_info->dump_trace = FALSE;
+        }
         if (display_info->reload)
         {
             reloadSettings (display_info, UPDATE_ALL);
@@ -2452,7 +2515,7 @@ show_window_menu (Client *c, gint px, gint py, guint button, guint32 timestamp,
     }
 
     c->button_status[MENU_BUTTON] = BUTTON_STATE_PRESSED;
-    frameQueueDraw (c, FALSE);
+    frameQueueDrawParts (c, FRAME_PART_BUTTON (MENU_BUTTON));
     if (CLIENT_HAS_FRAME (c))
     {
         x = px;
@@ -2631,7 +2694,7 @@ show_window_menu (Client *c, gint px, gint py, guint button, guint32 timestamp,
         TRACE ("cannot open menu");
         gdk_display_beep (display_info->gdisplay);
         c->button_status[MENU_BUTTON] = BUTTON_STATE_NORMAL;
-        frameQueueDraw (c, FALSE);
+        frameQueueDrawParts (c, FRAME_PART_BUTTON (MENU_BUTTON));
         xfwmWindowDelete (&menu_event_window);
         menu_free (menu);
     }
@@ -2719,6 +2782,19 @@ update_screen_font (ScreenInfo *screen_info)
     clientUpdateAllFrames (screen_info, UPDATE_FRAME);
 }
 
+static void
+update_screen_scale (ScreenInfo *screen_info)
+{
+    /* Monitors are never scaled less than GDK does */
+    myScreenUpdateMonitorScales (screen_info);
+    if (screen_info->params->scale_decorations)
+    {
+        /* Theme parts are scaled to the new factors when loaded */
+        reloadSettings (screen_info->display_info, UPDATE_MAXIMIZE | UPDATE_GRAVITY | UPDATE_CACHE);
+    }
+    update_screen_font (screen_info);
+}
+
 static gboolean
 refresh_font_cb (GObject * obj, GdkEvent * ev, gpointer data)
 {
@@ -2820,6 +2896,18 @@ monitors_changed_cb(GdkScreen *gscreen, gpointer data)
     myScreenRebuildMonitorIndex (screen_info);
     size_changed = myScreenComputeSize (screen_info);
 
+    if (screen_info->params->scale_decorations &&
+        (myScreenGetMonitorScales (screen_info) != screen_info->theme_scales))
+    {
+        /* Load the theme parts at the scales of the new monitors */
+        reloadSettings (display_info, UPDATE_MAXIMIZE | UPDATE_GRAVITY | UPDATE_CACHE);
+    }
+    else if (screen_info->params->scale_decorations)
+    {
+        /* Frames may now be on a monitor of another scale */
+        clientUpdateAllFrames (screen_info, NO_UPDATE_FLAG);
+    }
+
     if (size_changed || (screen_info->num_monitors != previous_num_monitors))
     {
 
@@ -2856,7 +2944,7 @@ initPerScreenCallbacks (ScreenInfo *screen_info)
 
     g_signal_connect_swapped (G_OBJECT (myScreenGetGtkWidget (screen_info)),
                               "notify::scale-factor",
-                              G_CALLBACK (update_screen_font),
+                              G_CALLBACK (update_screen_scale),
                               screen_info);
 }
 
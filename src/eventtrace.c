@@ -0,0 +1,515 @@
+/*      $Id$
+
+        This program is free software; you can redistribute it and/or modify
+        it under the terms of the GNU General Public License as published by
+        the Free Software Foundation; either version 2, or (at your option)
+        any later version.
+
+        This program is distributed in the hope that it will be useful,
+        but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+        GNU General Public License for more details.
+
+        You should have received a copy of the GNU General Public License
+        along with this program; if not, write to the Free Software
+        Foundation, Inc., Inc., 51 Franklin Street, Fifth Floor, Boston,
+        MA 02110-1301, USA.
+
+
+        xfwm4    - (c) 2002-2022 Olivier Fourdan
+
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <errno.h>
+#include <stdio.h>
+#include <unistd.h>
+
+#include <X11/Xlib.h>
+#include <X11/extensions/shape.h>
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <libxfce4util/libxfce4util.h>
+
+#ifdef HAVE_COMPOSITOR
+#include <X11/extensions/Xdamage.h>
+#include <X11/extensions/Xfixes.h>
+#endif /* HAVE_COMPOSITOR */
+
+#ifdef HAVE_XSYNC
+#include <X11/extensions/sync.h>
+#endif /* HAVE_XSYNC */
+
+#include "display.h"
+#include "eventtrace.h"
+
+/*
+ * The event tracer accounts, for each handler and each event type it
+ * handles, the time spent in the handler and the lag between the X
+ * server timestamp of the event and its dispatch.
+ *
+ * X server timestamps are in milliseconds on the server clock, which
+ * may not match our monotonic clock, so the lag is measured relative
+ * to the smallest offset seen between the two clocks, i.e. the most
+ * promptly dispatched event counts as zero lag.
+ *
+ * Durations are kept in log2 histograms of microseconds, and each
+ * dispatch may also be streamed to a file in the Chrome trace event
+ * format, which both chrome://tracing and Perfetto can load.
+ */
+
+#define TRACE_EVENT_TYPES  128
+#define TRACE_BUCKETS      24
+
+typedef struct _EventTraceHistogram EventTraceHistogram;
+struct _EventTraceHistogram
+{
+    guint64 count;
+    guint64 total;
+    guint64 max;
+    guint64 buckets[TRACE_BUCKETS];
+};
+
+typedef struct _EventTraceStats EventTraceStats;
+struct _EventTraceStats
+{
+    const gchar *handler;
+    gint type;
+    EventTraceHistogram duration;
+    EventTraceHistogram lag;
+};
+
+typedef struct _EventTraceHandler EventTraceHandler;
+struct _EventTraceHandler
+{
+    const gchar *name;
+    EventTraceStats *types[TRACE_EVENT_TYPES];
+};
+
+static gboolean trace_enabled = FALSE;
+static GHashTable *trace_handlers = NULL;
+static FILE *trace_file = NULL;
+static gboolean trace_file_empty = TRUE;
+static gint64 trace_origin = 0;
+static guint32 trace_clock_offset = 0;
+static gboolean trace_clock_synced = FALSE;
+
+static const gchar *core_event_names[LASTEvent] =
+{
+    NULL,
+    NULL,
+    "KeyPress",
+    "KeyRelease",
+    "ButtonPress",
+    "ButtonRelease",
+    "MotionNotify",
+    "EnterNotify",
+    "LeaveNotify",
+    "FocusIn",
+    "FocusOut",
+    "KeymapNotify",
+    "Expose",
+    "GraphicsExpose",
+    "NoExpose",
+    "VisibilityNotify",
+    "CreateNotify",
+    "DestroyNotify",
+    "UnmapNotify",
+    "MapNotify",
+    "MapRequest",
+    "ReparentNotify",
+    "ConfigureNotify",
+    "ConfigureRequest",
+    "GravityNotify",
+    "ResizeRequest",
+    "CirculateNotify",
+    "CirculateRequest",
+    "PropertyNotify",
+    "SelectionClear",
+    "SelectionRequest",
+    "SelectionNotify",
+    "ColormapNotify",
+    "ClientMessage",
+    "MappingNotify",
+    "GenericEvent"
+};
+
+static const gchar *
+eventTraceTypeName (DisplayInfo *display_info, gint type)
+{
+    static gchar name[32];
+
+    if (type == 0)
+    {
+        return "operation";
+    }
+    if ((type > 1) && (type < LASTEvent))
+    {
+        return core_event_names[type];
+    }
+    if ((display_info->have_shape) && (type == display_info->shape_event_base + ShapeNotify))
+    {
+        return "ShapeNotify";
+    }
+#ifdef HAVE_XSYNC
+    if ((display_info->have_xsync) && (type == display_info->xsync_event_base + XSyncAlarmNotify))
+    {
+        return "XSyncAlarmNotify";
+    }
+#endif /* HAVE_XSYNC */
+#ifdef HAVE_COMPOSITOR
+    if ((display_info->have_damage) && (type == display_info->damage_event_base + XDamageNotify))
+    {
+        return "XDamageNotify";
+    }
+    if ((display_info->have_fixes) && (type == display_info->fixes_event_base + XFixesCursorNotify))
+    {
+        return "XFixesCursorNotify";
+    }
+#endif /* HAVE_COMPOSITOR */
+
+    g_snprintf (name, sizeof (name), "Event%d", type);
+    return name;
+}
+
+static void
+eventTraceHistogramAdd (EventTraceHistogram *histogram, guint64 value)
+{
+    guint64 v;
+    gint bucket;
+
+    histogram->count++;
+    histogram->total += value;
+    histogram->max = MAX (histogram->max, value);
+
+    bucket = 0;
+    for (v = value; (v > 0) && (bucket < TRACE_BUCKETS - 1); v >>= 1)
+    {
+        bucket++;
+    }
+    histogram->buckets[bucket]++;
+}
+
+static guint64
+eventTraceHistogramPercentile (EventTraceHistogram *histogram, guint percent)
+{
+    guint64 target, seen;
+    gint bucket;
+
+    target = (histogram->count * percent + 99) / 100;
+    seen = 0;
+    for (bucket = 0; bucket < TRACE_BUCKETS; bucket++)
+    {
+        seen += histogram->buckets[bucket];
+        if (seen >= target)
+        {
+            /* Upper bound of the bucket */
+            return MIN ((bucket ? (G_GUINT64_CONSTANT (1) << bucket) - 1 : 0), histogram->max);
+        }
+    }
+
+    return histogram->max;
+}
+
+static void
+eventTraceHistogramPrint (const gchar *label, EventTraceHistogram *histogram)
+{
+    GString *buckets;
+    gint bucket;
+
+    if (histogram->count == 0)
+    {
+        return;
+    }
+
+    buckets = g_string_new (NULL);
+    for (bucket = 0; bucket < TRACE_BUCKETS; bucket++)
+    {
+        if (histogram->buckets[bucket])
+        {
+            g_string_append_printf (buckets, " <%" G_GUINT64_FORMAT ":%" G_GUINT64_FORMAT,
+                                    G_GUINT64_CONSTANT (1) << bucket, histogram->buckets[bucket]);
+        }
+    }
+
+    g_printerr ("    %-8s n=%" G_GUINT64_FORMAT " mean=%" G_GUINT64_FORMAT
+                " p50=%" G_GUINT64_FORMAT " p99=%" G_GUINT64_FORMAT
+                " max=%" G_GUINT64_FORMAT " us |%s\n",
+                label, histogram->count, histogram->total / histogram->count,
+                eventTraceHistogramPercentile (histogram, 50),
+                eventTraceHistogramPercentile (histogram, 99),
+                histogram->max, buckets->str);
+
+    g_string_free (buckets, TRUE);
+}
+
+static void
+eventTraceHandlerFree (gpointer data)
+{
+    EventTraceHandler *handler;
+    gint i;
+
+    handler = (EventTraceHandler *) data;
+    for (i = 0; i < TRACE_EVENT_TYPES; i++)
+    {
+        g_free (handler->types[i]);
+    }
+    g_free (handler);
+}
+
+static gint
+eventTraceCompareStats (gconstpointer a, gconstpointer b)
+{
+    const EventTraceStats *s1 = *((EventTraceStats **) a);
+    const EventTraceStats *s2 = *((EventTraceStats **) b);
+
+    /* Most expensive handlers first */
+    if (s1->duration.total > s2->duration.total)
+    {
+        return -1;
+    }
+    if (s1->duration.total < s2->duration.total)
+    {
+        return 1;
+    }
+    return 0;
+}
+
+static guint32
+eventTraceLag (guint32 timestamp, gint64 now)
+{
+    guint32 offset;
+    gint32 lag;
+
+    /* Both clocks wrap around at 32 bits of milliseconds */
+    offset = (guint32) (now / 1000) - timestamp;
+    if (!trace_clock_synced)
+    {
+        trace_clock_offset = offset;
+        trace_clock_synced = TRUE;
+    }
+
+    lag = (gint32) (offset - trace_clock_offset);
+    if (lag < 0)
+    {
+        trace_clock_offset = offset;
+        lag = 0;
+    }
+
+    return (guint32) lag;
+}
+
+gboolean
+eventTraceInit (const gchar *filename)
+{
+    g_return_val_if_fail (trace_handlers == NULL, FALSE);
+
+    if (filename)
+    {
+        trace_file = g_fopen (filename, "w");
+        if (!trace_file)
+        {
+            g_warning ("Cannot open trace file %s: %s", filename, g_strerror (errno));
+            return FALSE;
+        }
+        fputs ("[\n", trace_file);
+        trace_file_empty = TRUE;
+    }
+
+    trace_handlers = g_hash_table_new_full (g_direct_hash, g_direct_equal,
+                                            NULL, eventTraceHandlerFree);
+    trace_origin = g_get_monotonic_time ();
+    trace_enabled = TRUE;
+
+    return TRUE;
+}
+
+gboolean
+eventTraceIsEnabled (void)
+{
+    return trace_enabled;
+}
+
+gint64
+eventTraceBegin (void)
+{
+    if (G_LIKELY (!trace_enabled))
+    {
+        return 0;
+    }
+
+    return g_get_monotonic_time ();
+}
+
+static EventTraceStats *
+eventTraceGetStats (const gchar *name, gint type)
+{
+    EventTraceHandler *handler;
+    EventTraceStats *stats;
+
+    handler = g_hash_table_lookup (trace_handlers, name);
+    if (!handler)
+    {
+        handler = g_new0 (EventTraceHandler, 1);
+        handler->name = name;
+        g_hash_table_insert (trace_handlers, (gpointer) name, handler);
+    }
+
+    stats = handler->types[type];
+    if (!stats)
+    {
+        stats = g_new0 (EventTraceStats, 1);
+        stats->handler = name;
+        stats->type = type;
+        handler->types[type] = stats;
+    }
+
+    return stats;
+}
+
+void
+eventTraceEnd (DisplayInfo *display_info, gint64 start, const gchar *name,
+               XEvent *ev, guint32 timestamp)
+{
+    EventTraceStats *stats;
+    gint64 now;
+    guint32 lag;
+    gint type;
+
+    if (G_LIKELY (!trace_enabled) || (start == 0) || (name == NULL))
+    {
+        return;
+    }
+
+    now = g_get_monotonic_time ();
+    type = ev->type & 0x7f;
+    stats = eventTraceGetStats (name, type);
+    eventTraceHistogramAdd (&stats->duration, (guint64) (now - start));
+
+    lag = 0;
+    if (timestamp != (guint32) CurrentTime)
+    {
+        lag = eventTraceLag (timestamp, start);
+        eventTraceHistogramAdd (&stats->lag, (guint64) lag * 1000);
+    }
+
+    if (trace_file)
+    {
+        fprintf (trace_file,
+                 "%s{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\","
+                 "\"ts\":%" G_GINT64_FORMAT ",\"dur\":%" G_GINT64_FORMAT ","
+                 "\"pid\":%d,\"tid\":1,\"args\":{\"serial\":%lu",
+                 trace_file_empty ? "" : ",\n",
+                 name, eventTraceTypeName (display_info, type),
+                 start - trace_origin, now - start,
+                 (int) getpid (), ev->xany.serial);
+        if (timestamp != (guint32) CurrentTime)
+        {
+            fprintf (trace_file, ",\"time\":%u,\"lag_ms\":%u", timestamp, lag);
+        }
+        fputs ("}}", trace_file);
+        trace_file_empty = FALSE;
+    }
+}
+
+void
+eventTraceSpan (const gchar *name, gint64 start)
+{
+    EventTraceStats *stats;
+    gint64 now;
+
+    if (G_LIKELY (!trace_enabled) || (start == 0))
+    {
+        return;
+    }
+
+    /* Operations spanning several events are accounted as type 0 */
+    now = g_get_monotonic_time ();
+    stats = eventTraceGetStats (name, 0);
+    eventTraceHistogramAdd (&stats->duration, (guint64) (now - start));
+
+    if (trace_file)
+    {
+        fprintf (trace_file,
+                 "%s{\"name\":\"%s\",\"cat\":\"operation\",\"ph\":\"X\","
+                 "\"ts\":%" G_GINT64_FORMAT ",\"dur\":%" G_GINT64_FORMAT ","
+                 "\"pid\":%d,\"tid\":1}",
+                 trace_file_empty ? "" : ",\n",
+                 name, start - trace_origin, now - start, (int) getpid ());
+        trace_file_empty = FALSE;
+    }
+}
+
+void
+eventTraceDump (DisplayInfo *display_info)
+{
+    GHashTableIter iter;
+    GPtrArray *all_stats;
+    EventTraceHandler *handler;
+    EventTraceStats *stats;
+    guint i;
+    gint type;
+
+    g_return_if_fail (display_info != NULL);
+
+    if (!trace_enabled)
+    {
+        return;
+    }
+
+    all_stats = g_ptr_array_new ();
+    g_hash_table_iter_init (&iter, trace_handlers);
+    while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &handler))
+    {
+        for (type = 0; type < TRACE_EVENT_TYPES; type++)
+        {
+            if (handler->types[type])
+            {
+                g_ptr_array_add (all_stats, handler->types[type]);
+            }
+        }
+    }
+    g_ptr_array_sort (all_stats, eventTraceCompareStats);
+
+    g_printerr ("xfwm4 event trace, %.3f s since start:\n",
+                (g_get_monotonic_time () - trace_origin) / (gdouble) G_USEC_PER_SEC);
+    for (i = 0; i < all_stats->len; i++)
+    {
+        stats = g_ptr_array_index (all_stats, i);
+        g_printerr ("  %s (%s)\n", stats->handler,
+                    eventTraceTypeName (display_info, stats->type));
+        eventTraceHistogramPrint ("duration", &stats->duration);
+        eventTraceHistogramPrint ("lag", &stats->lag);
+    }
+    g_ptr_array_free (all_stats, TRUE);
+
+    if (trace_file)
+    {
+        fflush (trace_file);
+    }
+}
+
+void
+eventTraceClose (DisplayInfo *display_info)
+{
+    if (!trace_enabled)
+    {
+        return;
+    }
+
+    eventTraceDump (display_info);
+
+    if (trace_file)
+    {
+        fputs ("\n]\n", trace_file);
+        fclose (trace_file);
+        trace_file = NULL;
+    }
+
+    g_hash_table_destroy (trace_handlers);
+    trace_handlers = NULL;
+    trace_enabled = FALSE;
+}
@@ -47,6 +47,7 @@
 #include "workspaces.h"
 #include "hints.h"
 #include "netwm.h"
+#include "xaccount.h"
 
 typedef struct _ClientPair ClientPair;
 struct _ClientPair
@@ -580,6 +581,7 @@ clientSetFocus (ScreenInfo *screen_info, Client *c, guint32 timestamp, unsigned
         if (FLAG_TEST (c->wm_flags, WM_FLAG_INPUT) || !(screen_info->params->focus_hint))
         {
             pending_focus = c;
+            xAccountBegin (screen_info->display_info, "focus");
             /*
              * When shaded, the client window is unmapped, so it can not be focused.
              * Instead, we focus the frame that is still mapped.
@@ -599,6 +601,7 @@ clientSetFocus (ScreenInfo *screen_info, Client *c, guint32 timestamp, unsigned
                 clientFocusNone (screen_info, c2, timestamp);
                 clientClearDelayedFocus ();
             }
+            xAccountEnd (screen_info->display_info);
         }
         else if (flags & FOCUS_TRANSITION)
         {
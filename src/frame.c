@@ -38,20 +38,36 @@
 #include "focus.h"
 #include "frame.h"
 #include "compositor.h"
+#include "xaccount.h"
+
+/* Flushed altogether when full, frames keep their background anyway */
+#define FRAME_PARTS_MAX 256
 
 typedef struct
 {
     xfwmPixmap pm_title;
-    xfwmPixmap pm_sides[SIDE_COUNT];
+    xfwmPixmap pm_top;
+    xfwmPixmap *pm_sides[SIDE_COUNT];
 } FramePixmap;
 
-static int
-frameDecorationBorderTop (ScreenInfo *screen_info)
+typedef struct
 {
-    TRACE ("entering");
+    gint64 key;
+    xfwmPixmap pixmap;
+} FramePart;
 
-    g_return_val_if_fail (screen_info != NULL, 0);
-    return screen_info->params->frame_border_top;
+typedef struct
+{
+    FrameShapeKey key;
+    XRectangle *rects;
+    int count;
+    int ordering;
+} FrameShape;
+
+static int
+frameTitleHeight (Client * c)
+{
+    return c->theme->title[TITLE_3][ACTIVE].height;
 }
 
 static int
@@ -65,7 +81,7 @@ frameBorderTop (Client * c)
         && FLAG_TEST_ALL (c->flags, CLIENT_FLAG_MAXIMIZED)
         && (c->screen_info->params->borderless_maximize))
     {
-        return frameDecorationBorderTop (c->screen_info);
+        return c->theme->frame_border_top;
     }
     return 0;
 }
@@ -81,7 +97,7 @@ frameTopLeftWidth (Client * c, int state)
     {
         return 0;
     }
-    return c->screen_info->corners[CORNER_TOP_LEFT][state].width;
+    return c->theme->corners[CORNER_TOP_LEFT][state].width;
 
 }
 
@@ -96,7 +112,7 @@ frameTopRightWidth (Client * c, int state)
     {
         return 0;
     }
-    return c->screen_info->corners[CORNER_TOP_RIGHT][state].width;
+    return c->theme->corners[CORNER_TOP_RIGHT][state].width;
 }
 
 static int
@@ -108,32 +124,387 @@ frameButtonOffset (Client *c)
     if (FLAG_TEST_ALL (c->flags, CLIENT_FLAG_MAXIMIZED)
         && c->screen_info->params->borderless_maximize)
     {
-        return MAX (0, c->screen_info->params->maximized_offset);
+        return MAX (0, c->theme->maximized_offset);
     }
-    return c->screen_info->params->button_offset;
+    return c->theme->button_offset;
 }
 
+/*
+ * The left, right and bottom sides are the theme parts tiled to the size
+ * of the frame. Those are kept per screen and shared between all frames
+ * of the same size and scale, instead of being created for each redraw
+ * of each frame. Only the title and top side, which depend on the title
+ * of the window, remain specific to each client.
+ */
 static void
-frameFillTitlePixmap (Client * c, int state, int part, int x, int w, int h, xfwmPixmap * title_pm, xfwmPixmap * top_pm)
+framePartFree (gpointer data)
+{
+    FramePart *part;
+
+    part = (FramePart *) data;
+    xfwmPixmapFree (&part->pixmap);
+    g_free (part);
+}
+
+void
+frameFreeParts (ScreenInfo *screen_info)
+{
+    g_return_if_fail (screen_info != NULL);
+
+    if (screen_info->frame_parts)
+    {
+        g_hash_table_destroy (screen_info->frame_parts);
+        screen_info->frame_parts = NULL;
+    }
+    if (screen_info->frame_shapes)
+    {
+        g_hash_table_destroy (screen_info->frame_shapes);
+        screen_info->frame_shapes = NULL;
+    }
+}
+
+static void
+frameTrimParts (ScreenInfo *screen_info)
+{
+    /* Only between redraws, a frame being drawn may use any of them */
+    if (screen_info->frame_parts &&
+        (g_hash_table_size (screen_info->frame_parts) >= FRAME_PARTS_MAX))
+    {
+        g_hash_table_remove_all (screen_info->frame_parts);
+    }
+    if (screen_info->frame_shapes &&
+        (g_hash_table_size (screen_info->frame_shapes) >= FRAME_PARTS_MAX))
+    {
+        g_hash_table_remove_all (screen_info->frame_shapes);
+    }
+}
+
+/*
+ * Only looks parts up or adds them, the table is trimmed by
+ * frameTrimParts() at the start of frameDrawWin().
+ */
+static xfwmPixmap *
+frameGetSidePixmap (ScreenInfo *screen_info, ThemeParts *theme, int side, int state, int width, int height)
+{
+    FramePart *part;
+    gint64 key;
+
+    key = ((gint64) (side * 2 + state) << 59) |
+          ((gint64) (theme->scale & 0x7) << 56) |
+          ((gint64) (width & 0xfffffff) << 28) |
+          (gint64) (height & 0xfffffff);
+
+    if (screen_info->frame_parts == NULL)
+    {
+        screen_info->frame_parts = g_hash_table_new_full (g_int64_hash, g_int64_equal,
+                                                          NULL, framePartFree);
+    }
+
+    part = g_hash_table_lookup (screen_info->frame_parts, &key);
+    if (part)
+    {
+        return &part->pixmap;
+    }
+
+    part = g_new0 (FramePart, 1);
+    part->key = key;
+    xfwmPixmapInit (screen_info, &part->pixmap);
+    xfwmPixmapCreate (screen_info, &part->pixmap, width, height);
+    xfwmPixmapFill (&theme->sides[side][state], &part->pixmap, 0, 0, width, height);
+    g_hash_table_insert (screen_info->frame_parts, &part->key, part);
+
+    return &part->pixmap;
+}
+
+/*
+ * The bounding shape of a frame is the union of the shapes of its parts,
+ * it depends on the theme and on the layout of the frame only, unless the
+ * client window is shaped itself or the application icon is used as menu
+ * button. Shapes are kept per screen as rectangle lists, so that frames
+ * with the same layout get their shape in a single request, and a frame
+ * is not shaped again if its layout has not changed.
+ */
+static guint
+frameShapeHash (gconstpointer data)
+{
+    const guint32 *words;
+    guint hash;
+    guint i;
+
+    words = data;
+    hash = 2166136261u;
+    for (i = 0; i < sizeof (FrameShapeKey) / sizeof (guint32); i++)
+    {
+        hash = (hash ^ words[i]) * 16777619u;
+    }
+
+    return hash;
+}
+
+static gboolean
+frameShapeEqual (gconstpointer a, gconstpointer b)
+{
+    return (memcmp (a, b, sizeof (FrameShapeKey)) == 0);
+}
+
+static void
+frameShapeFree (gpointer data)
+{
+    FrameShape *shape;
+
+    shape = (FrameShape *) data;
+    if (shape->rects)
+    {
+        XFree (shape->rects);
+    }
+    g_free (shape);
+}
+
+static gboolean
+frameGetShapeKey (Client * c, int state, int button_x[BUTTON_COUNT], FrameShapeKey * key)
 {
     ScreenInfo *screen_info;
+    xfwmPixmap *my_pixmap;
+    guint i;
+
+    screen_info = c->screen_info;
+    memset (key, 0, sizeof (FrameShapeKey));
+
+    if (FLAG_TEST (c->flags, CLIENT_FLAG_HAS_SHAPE))
+    {
+        return FALSE;
+    }
+
+    key->serial = screen_info->title_cache_serial;
+    key->scale = c->theme->scale;
+    key->state = state;
+    key->shaded = FLAG_TEST (c->flags, CLIENT_FLAG_SHADED) ? TRUE : FALSE;
+    key->maximized = FLAG_TEST_ALL (c->flags, CLIENT_FLAG_MAXIMIZED) ? TRUE : FALSE;
+    key->width = frameWidth (c);
+    key->height = frameHeight (c);
+    key->left = frameLeft (c);
+    key->right = frameRight (c);
+    key->top = frameTop (c);
+    key->bottom = frameBottom (c);
+    /* The title parts are laid out around the text */
+    key->title_width = c->title_logical.width;
+
+    if (xfwmWindowVisible (&c->title))
+    {
+        key->visible |= FRAME_PART_TITLE;
+    }
+    for (i = 0; i < SIDE_COUNT; i++)
+    {
+        if (xfwmWindowVisible (&c->sides[i]))
+        {
+            key->visible |= FRAME_PART_SIDE (i);
+        }
+    }
+    for (i = 0; i < CORNER_COUNT; i++)
+    {
+        if (xfwmWindowVisible (&c->corners[i]))
+        {
+            key->visible |= FRAME_PART_CORNER (i);
+        }
+    }
+    for (i = 0; i < BUTTON_COUNT; i++)
+    {
+        key->button_x[i] = -1;
+        key->button_pixmap[i] = -1;
+        if (!xfwmWindowVisible (&c->buttons[i]))
+        {
+            continue;
+        }
+        if ((i == MENU_BUTTON) && (screen_info->params->show_app_icon))
+        {
+            return FALSE;
+        }
+        my_pixmap = clientGetButtonPixmap (c, i, clientGetButtonState (c, i, state));
+        key->visible |= FRAME_PART_BUTTON (i);
+        key->button_x[i] = button_x[i];
+        key->button_pixmap[i] = my_pixmap - c->theme->buttons[i];
+    }
+    key->valid = TRUE;
+
+    return TRUE;
+}
+
+static void
+frameStoreShape (ScreenInfo *screen_info, FrameShapeKey * key)
+{
+    DisplayInfo *display_info;
+    FrameShape *shape;
+
+    display_info = screen_info->display_info;
+    if (screen_info->frame_shapes == NULL)
+    {
+        screen_info->frame_shapes = g_hash_table_new_full (frameShapeHash, frameShapeEqual,
+                                                           NULL, frameShapeFree);
+    }
+
+    shape = g_new0 (FrameShape, 1);
+    shape->key = *key;
+    shape->rects = XShapeGetRectangles (display_info->dpy, screen_info->shape_win,
+                                        ShapeBounding, &shape->count, &shape->ordering);
+    g_hash_table_replace (screen_info->frame_shapes, &shape->key, shape);
+}
+
+static void
+frameFillTitlePixmap (Client * c, int state, int part, int x, int w, int h, xfwmPixmap * title_pm, xfwmPixmap * top_pm)
+{
+    ThemeParts *theme;
 
     g_return_if_fail (c);
     g_return_if_fail (title_pm);
     g_return_if_fail (top_pm);
     TRACE ("client \"%s\" (0x%lx)", c->name, c->window);
 
-    screen_info = c->screen_info;
+    theme = c->theme;
 
-    if (!xfwmPixmapNone(&screen_info->top[part][state]))
+    if (!xfwmPixmapNone(&theme->top[part][state]))
     {
-        xfwmPixmapFill (&screen_info->top[part][state], top_pm, x, 0, w, h);
+        xfwmPixmapFill (&theme->top[part][state], top_pm, x, 0, w, h);
     }
     else
     {
-        xfwmPixmapFill (&screen_info->title[part][state], top_pm, x, 0, w, h);
+        xfwmPixmapFill (&theme->title[part][state], top_pm, x, 0, w, h);
     }
-    xfwmPixmapFill (&screen_info->title[part][state], title_pm, x, 0, w, frameDecorationTop(screen_info));
+    xfwmPixmapFill (&theme->title[part][state], title_pm, x, 0, w, frameTitleHeight (c));
+}
+
+/*
+ * The title layout is kept per client until its name, the font or the
+ * theme change, and the text is rendered once per state into a surface
+ * on the server side, so that redrawing a frame on focus change or
+ * resize does not go through Pango. With subpixel antialiasing the text
+ * has to be rendered over the title background though, only the layout
+ * is kept then.
+ */
+void
+frameClearTitleCache (Client * c)
+{
+    int i;
+
+    g_return_if_fail (c != NULL);
+
+    for (i = 0; i < 2; i++)
+    {
+        if (c->title_text[i])
+        {
+            cairo_surface_destroy (c->title_text[i]);
+            c->title_text[i] = NULL;
+        }
+    }
+    if (c->title_layout)
+    {
+        g_object_unref (G_OBJECT (c->title_layout));
+        c->title_layout = NULL;
+    }
+    g_free (c->title_cache_name);
+    c->title_cache_name = NULL;
+}
+
+static PangoLayout *
+frameGetTitleLayout (Client * c)
+{
+    ScreenInfo *screen_info;
+    PangoLayout *layout;
+    PangoRectangle ink_rect;
+
+    screen_info = c->screen_info;
+    if ((c->title_layout != NULL) &&
+        (c->title_cache_serial == screen_info->title_cache_serial) &&
+        (g_strcmp0 (c->title_cache_name, c->name) == 0))
+    {
+        return c->title_layout;
+    }
+    frameClearTitleCache (c);
+
+    layout = gtk_widget_create_pango_layout (myScreenGetGtkWidget (screen_info), c->name);
+    pango_layout_set_font_description (layout, myScreenGetFontDescription (screen_info));
+    pango_layout_set_auto_dir (layout, FALSE);
+    if (c->theme->pango_attr_list != NULL)
+    {
+        pango_layout_set_attributes (layout, c->theme->pango_attr_list);
+    }
+    pango_layout_get_pixel_extents (layout, &ink_rect, &c->title_logical);
+
+    /* Glyphs may draw outside of the logical extents */
+    c->title_bounds.x = MIN (ink_rect.x, c->title_logical.x);
+    c->title_bounds.y = MIN (ink_rect.y, c->title_logical.y);
+    c->title_bounds.width = MAX (ink_rect.x + ink_rect.width,
+                                 c->title_logical.x + c->title_logical.width) - c->title_bounds.x;
+    c->title_bounds.height = MAX (ink_rect.y + ink_rect.height,
+                                  c->title_logical.y + c->title_logical.height) - c->title_bounds.y;
+
+    c->title_layout = layout;
+    c->title_cache_name = g_strdup (c->name);
+    c->title_cache_serial = screen_info->title_cache_serial;
+
+    return layout;
+}
+
+static void
+frameDrawTitleText (ScreenInfo *screen_info, cairo_t *cr, PangoLayout *layout, int state)
+{
+    if (screen_info->params->title_shadow[state])
+    {
+        gdk_cairo_set_source_rgba (cr, &screen_info->title_shadow_colors[state]);
+        if (screen_info->params->title_shadow[state] == TITLE_SHADOW_UNDER)
+        {
+            cairo_translate (cr, 1, 1);
+            pango_cairo_show_layout (cr, layout);
+            cairo_translate (cr, -1, -1);
+        }
+        else
+        {
+            cairo_translate (cr, -1, 0);
+            pango_cairo_show_layout (cr, layout);
+            cairo_translate (cr, 1, -1);
+            pango_cairo_show_layout (cr, layout);
+            cairo_translate (cr, 1, 1);
+            pango_cairo_show_layout (cr, layout);
+            cairo_translate (cr, -1, 1);
+            pango_cairo_show_layout (cr, layout);
+            cairo_translate (cr, 0, -1);
+        }
+    }
+    gdk_cairo_set_source_rgba (cr, &screen_info->title_colors[state]);
+    pango_cairo_show_layout (cr, layout);
+}
+
+static cairo_surface_t *
+frameGetTitleText (Client * c, int state, cairo_surface_t *target)
+{
+    ScreenInfo *screen_info;
+    const cairo_font_options_t *options;
+    cairo_surface_t *text;
+    cairo_t *cr;
+
+    screen_info = c->screen_info;
+    if (c->title_text[state])
+    {
+        return c->title_text[state];
+    }
+
+    options = gdk_screen_get_font_options (screen_info->gscr);
+    if (options && (cairo_font_options_get_antialias (options) == CAIRO_ANTIALIAS_SUBPIXEL))
+    {
+        return NULL;
+    }
+
+    /* One pixel around for the shadow */
+    text = cairo_surface_create_similar (target, CAIRO_CONTENT_COLOR_ALPHA,
+                                         c->title_bounds.width + 2,
+                                         c->title_bounds.height + 2);
+    cr = cairo_create (text);
+    cairo_translate (cr, 1 - c->title_bounds.x, 1 - c->title_bounds.y);
+    frameDrawTitleText (screen_info, cr, c->title_layout, state);
+    cairo_destroy (cr);
+
+    c->title_text[state] = text;
+
+    return text;
 }
 
 static void
@@ -141,6 +512,7 @@ frameCreateTitlePixmap (Client * c, int state, int left, int right, xfwmPixmap *
 {
     ScreenInfo *screen_info;
     cairo_surface_t *surface;
+    cairo_surface_t *text;
     cairo_t *cr;
     PangoLayout *layout;
     PangoRectangle logical_rect;
@@ -189,40 +561,34 @@ frameCreateTitlePixmap (Client * c, int state, int left, int right, xfwmPixmap *
 
     if (state == ACTIVE)
     {
-        voffset = screen_info->params->title_vertical_offset_active;
+        voffset = c->theme->title_vertical_offset_active;
     }
     else
     {
-        voffset = screen_info->params->title_vertical_offset_inactive;
+        voffset = c->theme->title_vertical_offset_inactive;
     }
 
-    layout = gtk_widget_create_pango_layout (myScreenGetGtkWidget (screen_info), c->name);
-    pango_layout_set_font_description (layout, myScreenGetFontDescription (screen_info));
-    pango_layout_set_auto_dir (layout, FALSE);
-    if (screen_info->pango_attr_list != NULL)
-    {
-        pango_layout_set_attributes (layout, screen_info->pango_attr_list);
-    }
-    pango_layout_get_pixel_extents (layout, NULL, &logical_rect);
+    layout = frameGetTitleLayout (c);
+    logical_rect = c->title_logical;
 
     title_height = logical_rect.height;
-    title_y = voffset + (frameDecorationTop(screen_info) - title_height) / 2;
-    if (title_y + title_height > frameDecorationTop(screen_info))
+    title_y = voffset + (frameTitleHeight (c) - title_height) / 2;
+    if (title_y + title_height > frameTitleHeight (c))
     {
-        title_y = MAX (0, frameDecorationTop(screen_info) - title_height);
+        title_y = MAX (0, frameTitleHeight (c) - title_height);
     }
 
-    if (!xfwmPixmapNone(&screen_info->top[3][ACTIVE]))
+    if (!xfwmPixmapNone(&c->theme->top[3][ACTIVE]))
     {
-        top_height = screen_info->top[3][ACTIVE].height;
+        top_height = c->theme->top[3][ACTIVE].height;
     }
-    else if (frameDecorationBorderTop(c->screen_info) > 0)
+    else if (c->theme->frame_border_top > 0)
     {
-        top_height = frameDecorationBorderTop(c->screen_info);
+        top_height = c->theme->frame_border_top;
     }
     else
     {
-        top_height = frameDecorationTop(screen_info) / 10 + 1;
+        top_height = frameTitleHeight (c) / 10 + 1;
         if (top_height > title_y - 1)
         {
              top_height = MAX (title_y - 1, 0);
@@ -230,8 +596,8 @@ frameCreateTitlePixmap (Client * c, int state, int left, int right, xfwmPixmap *
     }
 
     w1 = 0;
-    w2 = screen_info->title[TITLE_2][state].width;
-    w4 = screen_info->title[TITLE_4][state].width;
+    w2 = c->theme->title[TITLE_2][state].width;
+    w4 = c->theme->title[TITLE_4][state].width;
 
     if (screen_info->params->full_width_title)
     {
@@ -245,18 +611,18 @@ frameCreateTitlePixmap (Client * c, int state, int left, int right, xfwmPixmap *
         switch (screen_info->params->title_alignment)
         {
             case ALIGN_LEFT:
-                hoffset = screen_info->params->title_horizontal_offset;
+                hoffset = c->theme->title_horizontal_offset;
                 break;
             case ALIGN_RIGHT:
-                hoffset = w3 - logical_rect.width - screen_info->params->title_horizontal_offset;
+                hoffset = w3 - logical_rect.width - c->theme->title_horizontal_offset;
                 break;
             case ALIGN_CENTER:
                 hoffset = (w3 / 2) - (logical_rect.width / 2);
                 break;
         }
-        if (hoffset < screen_info->params->title_horizontal_offset)
+        if (hoffset < c->theme->title_horizontal_offset)
         {
-            hoffset = screen_info->params->title_horizontal_offset;
+            hoffset = c->theme->title_horizontal_offset;
         }
     }
     else
@@ -274,10 +640,10 @@ frameCreateTitlePixmap (Client * c, int state, int left, int right, xfwmPixmap *
         switch (screen_info->params->title_alignment)
         {
             case ALIGN_LEFT:
-                w1 = left + screen_info->params->title_horizontal_offset;
+                w1 = left + c->theme->title_horizontal_offset;
                 break;
             case ALIGN_RIGHT:
-                w1 = right - w2 - w3 - w4 - screen_info->params->title_horizontal_offset;
+                w1 = right - w2 - w3 - w4 - c->theme->title_horizontal_offset;
                 break;
             case ALIGN_CENTER:
                 w1 = left + ((right - left) / 2) - (w3 / 2) - w2;
@@ -290,7 +656,7 @@ frameCreateTitlePixmap (Client * c, int state, int left, int right, xfwmPixmap *
     }
 
     xfwmPixmapCreate (screen_info, top_pm, width, top_height);
-    xfwmPixmapCreate (screen_info, title_pm, width, frameDecorationTop(screen_info));
+    xfwmPixmapCreate (screen_info, title_pm, width, frameTitleHeight (c));
 
     surface = xfwmPixmapCreateSurface (title_pm, FALSE);
     cr = cairo_create (surface);
@@ -308,31 +674,19 @@ frameCreateTitlePixmap (Client * c, int state, int left, int right, xfwmPixmap *
     {
         frameFillTitlePixmap (c, state, TITLE_3, x, w3, top_height, title_pm, top_pm);
         title_x = hoffset + x;
-        cairo_translate (cr, title_x, title_y);
-        if (screen_info->params->title_shadow[state])
+        text = frameGetTitleText (c, state, surface);
+        if (text)
         {
-            gdk_cairo_set_source_rgba (cr, &screen_info->title_shadow_colors[state]);
-            if (screen_info->params->title_shadow[state] == TITLE_SHADOW_UNDER)
-            {
-                cairo_translate (cr, 1, 1);
-                pango_cairo_show_layout (cr, layout);
-                cairo_translate (cr, -1, -1);
-            }
-            else
-            {
-                cairo_translate (cr, -1, 0);
-                pango_cairo_show_layout (cr, layout);
-                cairo_translate (cr, 1, -1);
-                pango_cairo_show_layout (cr, layout);
-                cairo_translate (cr, 1, 1);
-                pango_cairo_show_layout (cr, layout);
-                cairo_translate (cr, -1, 1);
-                pango_cairo_show_layout (cr, layout);
-                cairo_translate (cr, 0, -1);
-            }
+            cairo_set_source_surface (cr, text,
+                                      title_x + c->title_bounds.x - 1,
+                                      title_y + c->title_bounds.y - 1);
+            cairo_paint (cr);
+        }
+        else
+        {
+            cairo_translate (cr, title_x, title_y);
+            frameDrawTitleText (screen_info, cr, layout, state);
         }
-        gdk_cairo_set_source_rgba (cr, &screen_info->title_colors[state]);
-        pango_cairo_show_layout (cr, layout);
         x = x + w3;
     }
 
@@ -349,7 +703,6 @@ frameCreateTitlePixmap (Client * c, int state, int left, int right, xfwmPixmap *
     }
     cairo_destroy (cr);
     cairo_surface_destroy (surface);
-    g_object_unref (G_OBJECT (layout));
 }
 
 static int
@@ -455,28 +808,36 @@ getLetterFromButton (int i, Client * c)
     return chr;
 }
 
+/*
+ * The frame bounding shape is the union of the shapes of its parts, which
+ * must be set already, clipped to the frame.
+ */
 static void
-frameSetShape (Client * c, int state, FramePixmap * frame_pix, int button_x[BUTTON_COUNT])
+frameCombineShape (Client * c, int state, gboolean decorated, int button_x[BUTTON_COUNT],
+                   FrameShapeKey * key, gboolean cacheable)
 {
     ScreenInfo *screen_info;
     DisplayInfo *display_info;
+    FrameShape *shape;
     XRectangle rect;
-    xfwmPixmap *my_pixmap;
     int i;
 
-    g_return_if_fail (c != NULL);
-    TRACE ("client \"%s\" (0x%lx)", c->name, c->window);
-
     screen_info = c->screen_info;
     display_info = screen_info->display_info;
 
-    if (!display_info->have_shape)
+    shape = NULL;
+    if (cacheable && screen_info->frame_shapes)
     {
+        shape = g_hash_table_lookup (screen_info->frame_shapes, key);
+    }
+    if (shape)
+    {
+        XShapeCombineRectangles (display_info->dpy, c->frame, ShapeBounding, 0, 0,
+                                 shape->rects, shape->count, ShapeSet, shape->ordering);
+        c->frame_shape_key = *key;
         return;
     }
 
-    myDisplayErrorTrapPush (display_info);
-
     if (screen_info->shape_win == None)
     {
         screen_info->shape_win = XCreateSimpleWindow (display_info->dpy, screen_info->xroot, 0, 0, frameWidth (c), frameHeight (c), 0, 0, 0);
@@ -507,6 +868,139 @@ frameSetShape (Client * c, int state, FramePixmap * frame_pix, int button_x[BUTT
         XShapeCombineShape (display_info->dpy, screen_info->shape_win, ShapeBounding, frameLeft (c),
                             frameTop (c), c->window, ShapeBounding, ShapeSet);
     }
+    if (decorated)
+    {
+        if (!FLAG_TEST (c->flags, CLIENT_FLAG_SHADED))
+        {
+            if (xfwmWindowVisible (&c->sides[SIDE_LEFT]))
+            {
+                XShapeCombineShape (display_info->dpy, screen_info->shape_win, ShapeBounding, 0, frameTop (c),
+                                    MYWINDOW_XWINDOW (c->sides[SIDE_LEFT]), ShapeBounding, ShapeUnion);
+            }
+
+            if (xfwmWindowVisible (&c->sides[SIDE_RIGHT]))
+            {
+                XShapeCombineShape (display_info->dpy, screen_info->shape_win, ShapeBounding, frameWidth (c) - frameRight (c), frameTop (c),
+                                    MYWINDOW_XWINDOW (c->sides[SIDE_RIGHT]), ShapeBounding, ShapeUnion);
+            }
+        }
+
+        if (xfwmWindowVisible (&c->title))
+        {
+            XShapeCombineShape (display_info->dpy, screen_info->shape_win, ShapeBounding,
+                                frameTopLeftWidth (c, state), 0,
+                                MYWINDOW_XWINDOW (c->title), ShapeBounding, ShapeUnion);
+        }
+
+        if (xfwmWindowVisible (&c->corners[CORNER_TOP_LEFT]))
+        {
+
+            XShapeCombineShape (display_info->dpy, screen_info->shape_win, ShapeBounding, 0, 0,
+                                MYWINDOW_XWINDOW (c->corners[CORNER_TOP_LEFT]), ShapeBounding, ShapeUnion);
+        }
+
+        if (xfwmWindowVisible (&c->sides[SIDE_BOTTOM]))
+        {
+            XShapeCombineShape (display_info->dpy, screen_info->shape_win, ShapeBounding,
+                                c->theme->corners[CORNER_BOTTOM_LEFT][state].width,
+                                frameHeight (c) - frameBottom (c),
+                                MYWINDOW_XWINDOW (c->sides[SIDE_BOTTOM]), ShapeBounding, ShapeUnion);
+        }
+
+        if (xfwmWindowVisible (&c->sides[SIDE_TOP]))
+        {
+            XShapeCombineShape (display_info->dpy, screen_info->shape_win, ShapeBounding,
+                                c->theme->corners[CORNER_BOTTOM_LEFT][state].width,
+                                frameTop (c) - frameBottom (c),
+                                MYWINDOW_XWINDOW (c->sides[SIDE_TOP]), ShapeBounding, ShapeUnion);
+        }
+
+        if (xfwmWindowVisible (&c->corners[CORNER_BOTTOM_LEFT]))
+        {
+            XShapeCombineShape (display_info->dpy, screen_info->shape_win, ShapeBounding, 0,
+                                frameHeight (c) - c->theme->corners[CORNER_BOTTOM_LEFT][state].height,
+                                MYWINDOW_XWINDOW (c->corners[CORNER_BOTTOM_LEFT]), ShapeBounding, ShapeUnion);
+        }
+
+        if (xfwmWindowVisible (&c->corners[CORNER_BOTTOM_RIGHT]))
+        {
+            XShapeCombineShape (display_info->dpy, screen_info->shape_win, ShapeBounding,
+                                frameWidth (c) - c->theme->corners[CORNER_BOTTOM_RIGHT][state].width,
+                                frameHeight (c) - c->theme->corners[CORNER_BOTTOM_RIGHT][state].height,
+                                MYWINDOW_XWINDOW (c->corners[CORNER_BOTTOM_RIGHT]), ShapeBounding, ShapeUnion);
+        }
+
+        if (xfwmWindowVisible (&c->corners[CORNER_TOP_RIGHT]))
+        {
+            XShapeCombineShape (display_info->dpy, screen_info->shape_win, ShapeBounding,
+                                frameWidth (c) - frameTopRightWidth (c, state),
+                                0, MYWINDOW_XWINDOW (c->corners[CORNER_TOP_RIGHT]), ShapeBounding, ShapeUnion);
+        }
+
+        for (i = 0; i < BUTTON_COUNT; i++)
+        {
+            if (xfwmWindowVisible (&c->buttons[i]))
+            {
+                XShapeCombineShape (display_info->dpy, screen_info->shape_win, ShapeBounding, button_x[i],
+                                    (frameTop (c) - c->theme->buttons[i][state].height + 1) / 2,
+                                    MYWINDOW_XWINDOW (c->buttons[i]), ShapeBounding, ShapeUnion);
+            }
+        }
+    }
+    rect.x = 0;
+    rect.y = 0;
+    rect.width  = frameWidth (c);
+    rect.height = frameHeight (c);
+    XShapeCombineRectangles (display_info->dpy, screen_info->shape_win, ShapeBounding, 0, 0, &rect, 1, ShapeIntersect, Unsorted);
+    XShapeCombineShape (display_info->dpy, c->frame, ShapeBounding, 0, 0, screen_info->shape_win, ShapeBounding, ShapeSet);
+
+    if (cacheable)
+    {
+        frameStoreShape (screen_info, key);
+    }
+    c->frame_shape_key = *key;
+}
+
+static void
+frameSetShape (Client * c, int state, FramePixmap * frame_pix, int button_x[BUTTON_COUNT])
+{
+    ScreenInfo *screen_info;
+    DisplayInfo *display_info;
+    FrameShapeKey key;
+    XRectangle rect;
+    xfwmPixmap *my_pixmap;
+    gboolean cacheable;
+    int i;
+
+    g_return_if_fail (c != NULL);
+    TRACE ("client \"%s\" (0x%lx)", c->name, c->window);
+
+    screen_info = c->screen_info;
+    display_info = screen_info->display_info;
+
+    if (!display_info->have_shape)
+    {
+        return;
+    }
+
+    cacheable = FALSE;
+    if (frame_pix)
+    {
+        cacheable = frameGetShapeKey (c, state, button_x, &key);
+    }
+    else
+    {
+        memset (&key, 0, sizeof (FrameShapeKey));
+    }
+
+    if (cacheable && frameShapeEqual (&key, &c->frame_shape_key))
+    {
+        TRACE ("frame shape unchanged");
+        return;
+    }
+
+    myDisplayErrorTrapPush (display_info);
+
     if (frame_pix)
     {
         XShapeCombineMask (display_info->dpy, MYWINDOW_XWINDOW (c->title), ShapeBounding,
@@ -516,50 +1010,50 @@ frameSetShape (Client * c, int state, FramePixmap * frame_pix, int button_x[BUTT
             if (xfwmWindowVisible (&c->sides[SIDE_LEFT]))
             {
                 XShapeCombineMask (display_info->dpy, MYWINDOW_XWINDOW (c->sides[SIDE_LEFT]),
-                                   ShapeBounding, 0, 0, frame_pix->pm_sides[SIDE_LEFT].mask, ShapeSet);
+                                   ShapeBounding, 0, 0, frame_pix->pm_sides[SIDE_LEFT]->mask, ShapeSet);
             }
 
             if (xfwmWindowVisible (&c->sides[SIDE_RIGHT]))
             {
                 XShapeCombineMask (display_info->dpy, MYWINDOW_XWINDOW (c->sides[SIDE_RIGHT]),
-                                   ShapeBounding, 0, 0, frame_pix->pm_sides[SIDE_RIGHT].mask, ShapeSet);
+                                   ShapeBounding, 0, 0, frame_pix->pm_sides[SIDE_RIGHT]->mask, ShapeSet);
             }
         }
 
         if (xfwmWindowVisible (&c->sides[SIDE_BOTTOM]))
         {
             XShapeCombineMask (display_info->dpy, MYWINDOW_XWINDOW (c->sides[SIDE_BOTTOM]),
-                               ShapeBounding, 0, 0, frame_pix->pm_sides[SIDE_BOTTOM].mask, ShapeSet);
+                               ShapeBounding, 0, 0, frame_pix->pm_sides[SIDE_BOTTOM]->mask, ShapeSet);
         }
 
         if (xfwmWindowVisible (&c->sides[SIDE_TOP]))
         {
             XShapeCombineMask (display_info->dpy, MYWINDOW_XWINDOW (c->sides[SIDE_TOP]),
-                               ShapeBounding, 0, 0, frame_pix->pm_sides[SIDE_TOP].mask, ShapeSet);
+                               ShapeBounding, 0, 0, frame_pix->pm_sides[SIDE_TOP]->mask, ShapeSet);
         }
 
         if (xfwmWindowVisible (&c->corners[CORNER_BOTTOM_LEFT]))
         {
             XShapeCombineMask (display_info->dpy, MYWINDOW_XWINDOW (c->corners[CORNER_BOTTOM_LEFT]),
-                               ShapeBounding, 0, 0, screen_info->corners[CORNER_BOTTOM_LEFT][state].mask, ShapeSet);
+                               ShapeBounding, 0, 0, c->theme->corners[CORNER_BOTTOM_LEFT][state].mask, ShapeSet);
         }
 
         if (xfwmWindowVisible (&c->corners[CORNER_BOTTOM_RIGHT]))
         {
             XShapeCombineMask (display_info->dpy, MYWINDOW_XWINDOW (c->corners[CORNER_BOTTOM_RIGHT]),
-                               ShapeBounding, 0, 0, screen_info->corners[CORNER_BOTTOM_RIGHT][state].mask, ShapeSet);
+                               ShapeBounding, 0, 0, c->theme->corners[CORNER_BOTTOM_RIGHT][state].mask, ShapeSet);
         }
 
         if (xfwmWindowVisible (&c->corners[CORNER_TOP_LEFT]))
         {
             XShapeCombineMask (display_info->dpy, MYWINDOW_XWINDOW (c->corners[CORNER_TOP_LEFT]),
-                               ShapeBounding, 0, 0, screen_info->corners[CORNER_TOP_LEFT][state].mask, ShapeSet);
+                               ShapeBounding, 0, 0, c->theme->corners[CORNER_TOP_LEFT][state].mask, ShapeSet);
         }
 
         if (xfwmWindowVisible (&c->corners[CORNER_TOP_RIGHT]))
         {
             XShapeCombineMask (display_info->dpy, MYWINDOW_XWINDOW (c->corners[CORNER_TOP_RIGHT]),
-                               ShapeBounding, 0, 0, screen_info->corners[CORNER_TOP_RIGHT][state].mask, ShapeSet);
+                               ShapeBounding, 0, 0, c->theme->corners[CORNER_TOP_RIGHT][state].mask, ShapeSet);
         }
 
         for (i = 0; i < BUTTON_COUNT; i++)
@@ -573,138 +1067,75 @@ frameSetShape (Client * c, int state, FramePixmap * frame_pix, int button_x[BUTT
         }
 
         if (xfwmWindowVisible (&c->corners[CORNER_TOP_LEFT]) &&
-            (screen_info->corners[CORNER_TOP_LEFT][state].height > frameHeight (c) - frameBottom (c) + 1))
+            (c->theme->corners[CORNER_TOP_LEFT][state].height > frameHeight (c) - frameBottom (c) + 1))
         {
             rect.x      = 0;
             rect.y      = frameHeight (c) - frameBottom (c) + 1;
             rect.width  = frameTopLeftWidth (c, state);
-            rect.height = screen_info->corners[CORNER_TOP_LEFT][state].height
+            rect.height = c->theme->corners[CORNER_TOP_LEFT][state].height
                            - (frameHeight (c) - frameBottom (c) + 1);
             XShapeCombineRectangles (display_info->dpy, MYWINDOW_XWINDOW (c->corners[CORNER_TOP_LEFT]),
                                      ShapeBounding, 0, 0, &rect, 1, ShapeSubtract, 0);
         }
 
         if (xfwmWindowVisible (&c->corners[CORNER_TOP_RIGHT]) &&
-            (screen_info->corners[CORNER_TOP_RIGHT][state].height > frameHeight (c) - frameBottom (c) + 1))
+            (c->theme->corners[CORNER_TOP_RIGHT][state].height > frameHeight (c) - frameBottom (c) + 1))
         {
             rect.x      = 0;
             rect.y      = frameHeight (c) - frameBottom (c) + 1;
             rect.width  = frameTopRightWidth (c, state);
-            rect.height = screen_info->corners[CORNER_TOP_RIGHT][state].height
+            rect.height = c->theme->corners[CORNER_TOP_RIGHT][state].height
                            - (frameHeight (c) - frameBottom (c) + 1);
             XShapeCombineRectangles (display_info->dpy, MYWINDOW_XWINDOW (c->corners[CORNER_TOP_RIGHT]),
                                      ShapeBounding, 0, 0, &rect, 1, ShapeSubtract, 0);
         }
 
         if (xfwmWindowVisible (&c->corners[CORNER_BOTTOM_LEFT]) &&
-            (screen_info->corners[CORNER_BOTTOM_LEFT][state].height > frameHeight (c) - frameTop (c) + 1))
+            (c->theme->corners[CORNER_BOTTOM_LEFT][state].height > frameHeight (c) - frameTop (c) + 1))
         {
             rect.x      = 0;
             rect.y      = 0;
-            rect.width  = screen_info->corners[CORNER_BOTTOM_LEFT][state].width;
-            rect.height = screen_info->corners[CORNER_BOTTOM_LEFT][state].height
+            rect.width  = c->theme->corners[CORNER_BOTTOM_LEFT][state].width;
+            rect.height = c->theme->corners[CORNER_BOTTOM_LEFT][state].height
                            - (frameHeight (c) - frameTop (c) + 1);
             XShapeCombineRectangles (display_info->dpy, MYWINDOW_XWINDOW (c->corners[CORNER_BOTTOM_LEFT]),
                                      ShapeBounding, 0, 0, &rect, 1, ShapeSubtract, 0);
         }
 
         if (xfwmWindowVisible (&c->corners[CORNER_BOTTOM_RIGHT]) &&
-            (screen_info->corners[CORNER_BOTTOM_RIGHT][state].height > frameHeight (c) - frameTop (c) + 1))
+            (c->theme->corners[CORNER_BOTTOM_RIGHT][state].height > frameHeight (c) - frameTop (c) + 1))
         {
             rect.x      = 0;
             rect.y      = 0;
-            rect.width  = screen_info->corners[CORNER_BOTTOM_RIGHT][state].width;
-            rect.height = screen_info->corners[CORNER_BOTTOM_RIGHT][state].height
+            rect.width  = c->theme->corners[CORNER_BOTTOM_RIGHT][state].width;
+            rect.height = c->theme->corners[CORNER_BOTTOM_RIGHT][state].height
                            - (frameHeight (c) - frameTop (c) + 1);
             XShapeCombineRectangles (display_info->dpy, MYWINDOW_XWINDOW (c->corners[CORNER_BOTTOM_RIGHT]),
                                      ShapeBounding, 0, 0, &rect, 1, ShapeSubtract, 0);
         }
+    }
 
-        if (!FLAG_TEST (c->flags, CLIENT_FLAG_SHADED))
-        {
-            if (xfwmWindowVisible (&c->sides[SIDE_LEFT]))
-            {
-                XShapeCombineShape (display_info->dpy, screen_info->shape_win, ShapeBounding, 0, frameTop (c),
-                                    MYWINDOW_XWINDOW (c->sides[SIDE_LEFT]), ShapeBounding, ShapeUnion);
-            }
-
-            if (xfwmWindowVisible (&c->sides[SIDE_RIGHT]))
-            {
-                XShapeCombineShape (display_info->dpy, screen_info->shape_win, ShapeBounding, frameWidth (c) - frameRight (c), frameTop (c),
-                                    MYWINDOW_XWINDOW (c->sides[SIDE_RIGHT]), ShapeBounding, ShapeUnion);
-            }
-        }
-
-        if (xfwmWindowVisible (&c->title))
-        {
-            XShapeCombineShape (display_info->dpy, screen_info->shape_win, ShapeBounding,
-                                frameTopLeftWidth (c, state), 0,
-                                MYWINDOW_XWINDOW (c->title), ShapeBounding, ShapeUnion);
-        }
-
-        if (xfwmWindowVisible (&c->corners[CORNER_TOP_LEFT]))
-        {
-
-            XShapeCombineShape (display_info->dpy, screen_info->shape_win, ShapeBounding, 0, 0,
-                                MYWINDOW_XWINDOW (c->corners[CORNER_TOP_LEFT]), ShapeBounding, ShapeUnion);
-        }
-
-        if (xfwmWindowVisible (&c->sides[SIDE_BOTTOM]))
-        {
-            XShapeCombineShape (display_info->dpy, screen_info->shape_win, ShapeBounding,
-                                screen_info->corners[CORNER_BOTTOM_LEFT][state].width,
-                                frameHeight (c) - frameBottom (c),
-                                MYWINDOW_XWINDOW (c->sides[SIDE_BOTTOM]), ShapeBounding, ShapeUnion);
-        }
-
-        if (xfwmWindowVisible (&c->sides[SIDE_TOP]))
-        {
-            XShapeCombineShape (display_info->dpy, screen_info->shape_win, ShapeBounding,
-                                screen_info->corners[CORNER_BOTTOM_LEFT][state].width,
-                                frameTop (c) - frameBottom (c),
-                                MYWINDOW_XWINDOW (c->sides[SIDE_TOP]), ShapeBounding, ShapeUnion);
-        }
+    frameCombineShape (c, state, frame_pix != NULL, button_x, &key, cacheable);
 
-        if (xfwmWindowVisible (&c->corners[CORNER_BOTTOM_LEFT]))
-        {
-            XShapeCombineShape (display_info->dpy, screen_info->shape_win, ShapeBounding, 0,
-                                frameHeight (c) - screen_info->corners[CORNER_BOTTOM_LEFT][state].height,
-                                MYWINDOW_XWINDOW (c->corners[CORNER_BOTTOM_LEFT]), ShapeBounding, ShapeUnion);
-        }
-
-        if (xfwmWindowVisible (&c->corners[CORNER_BOTTOM_RIGHT]))
-        {
-            XShapeCombineShape (display_info->dpy, screen_info->shape_win, ShapeBounding,
-                                frameWidth (c) - screen_info->corners[CORNER_BOTTOM_RIGHT][state].width,
-                                frameHeight (c) - screen_info->corners[CORNER_BOTTOM_RIGHT][state].height,
-                                MYWINDOW_XWINDOW (c->corners[CORNER_BOTTOM_RIGHT]), ShapeBounding, ShapeUnion);
-        }
+    myDisplayErrorTrapPopIgnored (display_info);
+}
 
-        if (xfwmWindowVisible (&c->corners[CORNER_TOP_RIGHT]))
-        {
-            XShapeCombineShape (display_info->dpy, screen_info->shape_win, ShapeBounding,
-                                frameWidth (c) - frameTopRightWidth (c, state),
-                                0, MYWINDOW_XWINDOW (c->corners[CORNER_TOP_RIGHT]), ShapeBounding, ShapeUnion);
-        }
+static int
+frameGetState (Client * c)
+{
+    if (c == clientGetFocus ())
+    {
+        return ACTIVE;
+    }
 
-        for (i = 0; i < BUTTON_COUNT; i++)
-        {
-            if (xfwmWindowVisible (&c->buttons[i]))
-            {
-                XShapeCombineShape (display_info->dpy, screen_info->shape_win, ShapeBounding, button_x[i],
-                                    (frameTop (c) - screen_info->buttons[i][state].height + 1) / 2,
-                                    MYWINDOW_XWINDOW (c->buttons[i]), ShapeBounding, ShapeUnion);
-            }
-        }
+    TRACE ("\"%s\" is not the active window", c->name);
+    if (FLAG_TEST (c->wm_flags, WM_FLAG_URGENT)
+        && FLAG_TEST (c->xfwm_flags, XFWM_FLAG_SEEN_ACTIVE))
+    {
+        return ACTIVE;
     }
-    rect.x = 0;
-    rect.y = 0;
-    rect.width  = frameWidth (c);
-    rect.height = frameHeight (c);
-    XShapeCombineRectangles (display_info->dpy, screen_info->shape_win, ShapeBounding, 0, 0, &rect, 1, ShapeIntersect, Unsorted);
-    XShapeCombineShape (display_info->dpy, c->frame, ShapeBounding, 0, 0, screen_info->shape_win, ShapeBounding, ShapeSet);
 
-    myDisplayErrorTrapPopIgnored (display_info);
+    return INACTIVE;
 }
 
 static void
@@ -726,36 +1157,20 @@ frameDrawWin (Client * c)
     TRACE ("client \"%s\" (0x%lx)", c->name, c->window);
 
     frameClearQueueDraw (c);
+    c->frame_dirty = 0;
 
     screen_info = c->screen_info;
     display_info = screen_info->display_info;
+    frameTrimParts (screen_info);
 
     requires_clearing = FALSE;
     width_changed = FALSE;
     height_changed = FALSE;
-    state = ACTIVE;
 
+    xAccountBegin (display_info, "frame draw");
     myDisplayErrorTrapPush (display_info);
 
-    if (c != clientGetFocus ())
-    {
-        TRACE ("\"%s\" is not the active window", c->name);
-        if (FLAG_TEST (c->wm_flags, WM_FLAG_URGENT))
-        {
-            if (FLAG_TEST (c->xfwm_flags, XFWM_FLAG_SEEN_ACTIVE))
-            {
-                state = ACTIVE;
-            }
-            else
-            {
-                state = INACTIVE;
-            }
-        }
-        else
-        {
-            state = INACTIVE;
-        }
-    }
+    state = frameGetState (c);
 
     if ((state == INACTIVE)
         && FLAG_TEST(c->xfwm_flags, XFWM_FLAG_DRAW_ACTIVE | XFWM_FLAG_FIRST_MAP))
@@ -780,6 +1195,7 @@ frameDrawWin (Client * c)
         width_changed = TRUE;
         height_changed = TRUE;
         requires_clearing = TRUE;
+        c->frame_shape_key.valid = FALSE;
     }
     else
     {
@@ -823,7 +1239,7 @@ frameDrawWin (Client * c)
             }
             else if (button >= 0)
             {
-                if (x + screen_info->buttons[button][state].width + screen_info->params->button_spacing < right)
+                if (x + c->theme->buttons[button][state].width + c->theme->button_spacing < right)
                 {
                     my_pixmap = clientGetButtonPixmap (c, button, clientGetButtonState (c, button, state));
                     if (!xfwmPixmapNone(my_pixmap))
@@ -831,12 +1247,12 @@ frameDrawWin (Client * c)
                         xfwmWindowSetBG (&c->buttons[button], my_pixmap);
                     }
                     xfwmWindowShow (&c->buttons[button], x,
-                        ((frameDecorationTop(screen_info) - screen_info->buttons[button][state].height + 1) / 2) - frameBorderTop (c),
-                        screen_info->buttons[button][state].width,
-                        screen_info->buttons[button][state].height, TRUE);
+                        ((frameTitleHeight (c) - c->theme->buttons[button][state].height + 1) / 2) - frameBorderTop (c),
+                        c->theme->buttons[button][state].width,
+                        c->theme->buttons[button][state].height, TRUE);
                     button_x[button] = x;
-                    x = x + screen_info->buttons[button][state].width +
-                        screen_info->params->button_spacing;
+                    x = x + c->theme->buttons[button][state].width +
+                        c->theme->button_spacing;
                 }
                 else
                 {
@@ -844,10 +1260,10 @@ frameDrawWin (Client * c)
                 }
             }
         }
-        left = x + screen_info->params->button_spacing;
+        left = x + c->theme->button_spacing;
 
         /* and those that we do have on right... */
-        x = frameWidth (c) - frameRight (c) + screen_info->params->button_spacing -
+        x = frameWidth (c) - frameRight (c) + c->theme->button_spacing -
             frameButtonOffset (c);
         for (j = strlen (screen_info->params->button_layout) - 1; j >= i; j--)
         {
@@ -858,19 +1274,19 @@ frameDrawWin (Client * c)
             }
             else if (button >= 0)
             {
-                if (x - screen_info->buttons[button][state].width - screen_info->params->button_spacing > left)
+                if (x - c->theme->buttons[button][state].width - c->theme->button_spacing > left)
                 {
                     my_pixmap = clientGetButtonPixmap (c, button, clientGetButtonState (c, button, state));
                     if (!xfwmPixmapNone(my_pixmap))
                     {
                         xfwmWindowSetBG (&c->buttons[button], my_pixmap);
                     }
-                    x = x - screen_info->buttons[button][state].width -
-                        screen_info->params->button_spacing;
+                    x = x - c->theme->buttons[button][state].width -
+                        c->theme->button_spacing;
                     xfwmWindowShow (&c->buttons[button], x,
-                        ((frameDecorationTop(screen_info) - screen_info->buttons[button][state].height + 1) / 2) - frameBorderTop (c),
-                        screen_info->buttons[button][state].width,
-                        screen_info->buttons[button][state].height, TRUE);
+                        ((frameTitleHeight (c) - c->theme->buttons[button][state].height + 1) / 2) - frameBorderTop (c),
+                        c->theme->buttons[button][state].width,
+                        c->theme->buttons[button][state].height, TRUE);
                     button_x[button] = x;
                 }
                 else
@@ -879,42 +1295,43 @@ frameDrawWin (Client * c)
                 }
             }
         }
-        left = left - 2 * screen_info->params->button_spacing;
+        left = left - 2 * c->theme->button_spacing;
         right = x;
 
         top_width = frameWidth (c) - frameTopLeftWidth (c, state) - frameTopRightWidth (c, state);
         bottom_width = frameWidth (c) -
-            screen_info->corners[CORNER_BOTTOM_LEFT][state].width -
-            screen_info->corners[CORNER_BOTTOM_RIGHT][state].width;
+            c->theme->corners[CORNER_BOTTOM_LEFT][state].width -
+            c->theme->corners[CORNER_BOTTOM_RIGHT][state].width;
         left_height = frameHeight (c) - frameTop (c) -
-            screen_info->corners[CORNER_BOTTOM_LEFT][state].height;
+            c->theme->corners[CORNER_BOTTOM_LEFT][state].height;
         right_height = frameHeight (c) - frameTop (c) -
-            screen_info->corners[CORNER_BOTTOM_RIGHT][state].height;
+            c->theme->corners[CORNER_BOTTOM_RIGHT][state].height;
 
         xfwmPixmapInit (screen_info, &frame_pix.pm_title);
-        xfwmPixmapInit (screen_info, &frame_pix.pm_sides[SIDE_TOP]);
-        xfwmPixmapInit (screen_info, &frame_pix.pm_sides[SIDE_BOTTOM]);
-        xfwmPixmapInit (screen_info, &frame_pix.pm_sides[SIDE_LEFT]);
-        xfwmPixmapInit (screen_info, &frame_pix.pm_sides[SIDE_RIGHT]);
+        xfwmPixmapInit (screen_info, &frame_pix.pm_top);
+        frame_pix.pm_sides[SIDE_TOP] = &frame_pix.pm_top;
+        frame_pix.pm_sides[SIDE_BOTTOM] = NULL;
+        frame_pix.pm_sides[SIDE_LEFT] = NULL;
+        frame_pix.pm_sides[SIDE_RIGHT] = NULL;
 
         /* The title is always visible */
-        frameCreateTitlePixmap (c, state, left, right, &frame_pix.pm_title, &frame_pix.pm_sides[SIDE_TOP]);
+        frameCreateTitlePixmap (c, state, left, right, &frame_pix.pm_title, &frame_pix.pm_top);
         xfwmWindowSetBG (&c->title, &frame_pix.pm_title);
         xfwmWindowShow (&c->title,
             frameTopLeftWidth (c, state), 0 - frameBorderTop (c), top_width,
-            frameDecorationTop(screen_info), (requires_clearing | width_changed));
+            frameTitleHeight (c), (requires_clearing | width_changed));
 
         /* Corners are never resized, we need to update them separately */
         if (requires_clearing)
         {
             xfwmWindowSetBG (&c->corners[CORNER_TOP_LEFT],
-                &screen_info->corners[CORNER_TOP_LEFT][state]);
+                &c->theme->corners[CORNER_TOP_LEFT][state]);
             xfwmWindowSetBG (&c->corners[CORNER_TOP_RIGHT],
-                &screen_info->corners[CORNER_TOP_RIGHT][state]);
+                &c->theme->corners[CORNER_TOP_RIGHT][state]);
             xfwmWindowSetBG (&c->corners[CORNER_BOTTOM_LEFT],
-                &screen_info->corners[CORNER_BOTTOM_LEFT][state]);
+                &c->theme->corners[CORNER_BOTTOM_LEFT][state]);
             xfwmWindowSetBG (&c->corners[CORNER_BOTTOM_RIGHT],
-                &screen_info->corners[CORNER_BOTTOM_RIGHT][state]);
+                &c->theme->corners[CORNER_BOTTOM_RIGHT][state]);
         }
 
         if (FLAG_TEST_ALL (c->flags, CLIENT_FLAG_MAXIMIZED)
@@ -938,46 +1355,37 @@ frameDrawWin (Client * c)
             }
             else
             {
-                xfwmPixmapCreate (screen_info, &frame_pix.pm_sides[SIDE_LEFT],
-                    frameLeft (c), left_height);
-                xfwmPixmapFill (&screen_info->sides[SIDE_LEFT][state],
-                    &frame_pix.pm_sides[SIDE_LEFT],
-                    0, 0, frameLeft (c), left_height);
+                frame_pix.pm_sides[SIDE_LEFT] =
+                    frameGetSidePixmap (screen_info, c->theme, SIDE_LEFT, state, frameLeft (c), left_height);
                 xfwmWindowSetBG (&c->sides[SIDE_LEFT],
-                    &frame_pix.pm_sides[SIDE_LEFT]);
+                    frame_pix.pm_sides[SIDE_LEFT]);
                 xfwmWindowShow (&c->sides[SIDE_LEFT], 0, frameTop (c),
                     frameLeft (c), left_height, (requires_clearing | height_changed));
 
-                xfwmPixmapCreate (screen_info, &frame_pix.pm_sides[SIDE_RIGHT],
-                    frameRight (c), right_height);
-                xfwmPixmapFill (&screen_info->sides[SIDE_RIGHT][state],
-                    &frame_pix.pm_sides[SIDE_RIGHT],
-                    0, 0, frameRight (c), right_height);
+                frame_pix.pm_sides[SIDE_RIGHT] =
+                    frameGetSidePixmap (screen_info, c->theme, SIDE_RIGHT, state, frameRight (c), right_height);
                 xfwmWindowSetBG (&c->sides[SIDE_RIGHT],
-                    &frame_pix.pm_sides[SIDE_RIGHT]);
+                    frame_pix.pm_sides[SIDE_RIGHT]);
                 xfwmWindowShow (&c->sides[SIDE_RIGHT],
                     frameWidth (c) - frameRight (c), frameTop (c), frameRight (c),
                     right_height, (requires_clearing | height_changed));
             }
 
-            xfwmPixmapCreate (screen_info, &frame_pix.pm_sides[SIDE_BOTTOM],
-                bottom_width, frameBottom (c));
-            xfwmPixmapFill (&screen_info->sides[SIDE_BOTTOM][state],
-                &frame_pix.pm_sides[SIDE_BOTTOM],
-                0, 0, bottom_width, frameBottom (c));
+            frame_pix.pm_sides[SIDE_BOTTOM] =
+                frameGetSidePixmap (screen_info, c->theme, SIDE_BOTTOM, state, bottom_width, frameBottom (c));
             xfwmWindowSetBG (&c->sides[SIDE_BOTTOM],
-                &frame_pix.pm_sides[SIDE_BOTTOM]);
+                frame_pix.pm_sides[SIDE_BOTTOM]);
             xfwmWindowShow (&c->sides[SIDE_BOTTOM],
-                screen_info->corners[CORNER_BOTTOM_LEFT][state].width,
+                c->theme->corners[CORNER_BOTTOM_LEFT][state].width,
                 frameHeight (c) - frameBottom (c), bottom_width, frameBottom (c),
                 (requires_clearing | width_changed));
 
-            if (!xfwmPixmapNone(&frame_pix.pm_sides[SIDE_TOP]))
+            if (!xfwmPixmapNone(&frame_pix.pm_top))
             {
-                xfwmWindowSetBG (&c->sides[SIDE_TOP], &frame_pix.pm_sides[SIDE_TOP]);
+                xfwmWindowSetBG (&c->sides[SIDE_TOP], &frame_pix.pm_top);
                 xfwmWindowShow (&c->sides[SIDE_TOP],
-                    screen_info->corners[CORNER_TOP_LEFT][state].width,
-                    0, top_width, frame_pix.pm_sides[SIDE_TOP].height,
+                    c->theme->corners[CORNER_TOP_LEFT][state].width,
+                    0, top_width, frame_pix.pm_top.height,
                     (requires_clearing | width_changed));
             }
             else
@@ -987,38 +1395,35 @@ frameDrawWin (Client * c)
 
             xfwmWindowShow (&c->corners[CORNER_TOP_LEFT], 0, 0,
                 frameTopLeftWidth (c, state),
-                screen_info->corners[CORNER_TOP_LEFT][state].height,
+                c->theme->corners[CORNER_TOP_LEFT][state].height,
                 requires_clearing);
 
             xfwmWindowShow (&c->corners[CORNER_TOP_RIGHT],
                 frameWidth (c) - frameTopRightWidth (c, state),
                 0, frameTopRightWidth (c, state),
-                screen_info->corners[CORNER_TOP_RIGHT][state].height,
+                c->theme->corners[CORNER_TOP_RIGHT][state].height,
                 requires_clearing);
 
             xfwmWindowShow (&c->corners[CORNER_BOTTOM_LEFT], 0,
                 frameHeight (c) -
-                screen_info->corners[CORNER_BOTTOM_LEFT][state].height,
-                screen_info->corners[CORNER_BOTTOM_LEFT][state].width,
-                screen_info->corners[CORNER_BOTTOM_LEFT][state].height,
+                c->theme->corners[CORNER_BOTTOM_LEFT][state].height,
+                c->theme->corners[CORNER_BOTTOM_LEFT][state].width,
+                c->theme->corners[CORNER_BOTTOM_LEFT][state].height,
                 requires_clearing);
 
             xfwmWindowShow (&c->corners[CORNER_BOTTOM_RIGHT],
                 frameWidth (c) -
-                screen_info->corners[CORNER_BOTTOM_RIGHT][state].width,
+                c->theme->corners[CORNER_BOTTOM_RIGHT][state].width,
                 frameHeight (c) -
-                screen_info->corners[CORNER_BOTTOM_RIGHT][state].height,
-                screen_info->corners[CORNER_BOTTOM_RIGHT][state].width,
-                screen_info->corners[CORNER_BOTTOM_RIGHT][state].height,
+                c->theme->corners[CORNER_BOTTOM_RIGHT][state].height,
+                c->theme->corners[CORNER_BOTTOM_RIGHT][state].width,
+                c->theme->corners[CORNER_BOTTOM_RIGHT][state].height,
                 requires_clearing);
         }
         frameSetShape (c, state, &frame_pix, button_x);
 
         xfwmPixmapFree (&frame_pix.pm_title);
-        xfwmPixmapFree (&frame_pix.pm_sides[SIDE_TOP]);
-        xfwmPixmapFree (&frame_pix.pm_sides[SIDE_BOTTOM]);
-        xfwmPixmapFree (&frame_pix.pm_sides[SIDE_LEFT]);
-        xfwmPixmapFree (&frame_pix.pm_sides[SIDE_RIGHT]);
+        xfwmPixmapFree (&frame_pix.pm_top);
     }
     else
     {
@@ -1051,6 +1456,102 @@ frameDrawWin (Client * c)
     }
 
     myDisplayErrorTrapPopIgnored (display_info);
+    xAccountEnd (display_info);
+}
+
+/*
+ * Button state changes (prelight, pressed) only need the button itself
+ * to be redrawn, provided nothing else changed in the frame since it was
+ * last drawn in full.
+ */
+static gboolean
+frameDrawButtons (Client * c, guint parts)
+{
+    ScreenInfo *screen_info;
+    DisplayInfo *display_info;
+    FrameShapeKey key;
+    xfwmPixmap *my_pixmap;
+    xfwmPixmap *previous;
+    xfwmWindow *win;
+    int button_x[BUTTON_COUNT];
+    gboolean reshape;
+    gboolean cacheable;
+    gint state;
+    guint i;
+
+    screen_info = c->screen_info;
+    display_info = screen_info->display_info;
+    state = frameGetState (c);
+
+    if (!CLIENT_HAS_FRAME (c)
+        || ((state == ACTIVE) != (FLAG_TEST (c->xfwm_flags, XFWM_FLAG_DRAW_ACTIVE) != 0))
+        || FLAG_TEST (c->xfwm_flags, XFWM_FLAG_FIRST_MAP | XFWM_FLAG_NEEDS_REDRAW)
+        || (c->frame_cache_width != c->width)
+        || (c->frame_cache_height != c->height))
+    {
+        return FALSE;
+    }
+
+    TRACE ("client \"%s\" (0x%lx) buttons 0x%x", c->name, c->window, parts);
+    c->frame_dirty = 0;
+    reshape = FALSE;
+
+    myDisplayErrorTrapPush (display_info);
+    for (i = 0; i < BUTTON_COUNT; i++)
+    {
+        win = &c->buttons[i];
+        button_x[i] = win->x;
+        if (!(parts & FRAME_PART_BUTTON (i)) || !xfwmWindowVisible (win))
+        {
+            continue;
+        }
+
+        my_pixmap = clientGetButtonPixmap (c, i, clientGetButtonState (c, i, state));
+        if (xfwmPixmapNone (my_pixmap))
+        {
+            continue;
+        }
+        xfwmWindowSetBG (win, my_pixmap);
+        XClearWindow (display_info->dpy, MYWINDOW_XWINDOW (c->buttons[i]));
+
+        if (!display_info->have_shape)
+        {
+            continue;
+        }
+        /* The frame shape records the pixmap each button was shaped with */
+        previous = NULL;
+        if (c->frame_shape_key.valid && (c->frame_shape_key.scale == c->theme->scale)
+            && (c->frame_shape_key.button_pixmap[i] >= 0))
+        {
+            previous = &c->theme->buttons[i][c->frame_shape_key.button_pixmap[i]];
+        }
+        if (previous == NULL || previous->mask != my_pixmap->mask)
+        {
+            XShapeCombineMask (display_info->dpy, MYWINDOW_XWINDOW (c->buttons[i]),
+                               ShapeBounding, 0, 0, my_pixmap->mask, ShapeSet);
+            reshape = TRUE;
+        }
+    }
+
+    if (reshape)
+    {
+        /*
+         * Title parts may be transparent beneath the buttons, so the old
+         * button shape cannot simply be taken out of the frame shape. The
+         * frame shape is put together again from the shapes of its parts,
+         * which are all current, or taken from the cache.
+         */
+        cacheable = frameGetShapeKey (c, state, button_x, &key);
+        frameCombineShape (c, state, TRUE, button_x, &key, cacheable);
+    }
+    else if (c->frame_shape_key.valid)
+    {
+        /* Same masks, only the pixmaps the shape was made of changed */
+        frameGetShapeKey (c, state, button_x, &c->frame_shape_key);
+    }
+    myDisplayErrorTrapPopIgnored (display_info);
+
+    return TRUE;
 }
 
 static gboolean
@@ -1062,8 +1563,12 @@ update_frame_idle_cb (gpointer data)
     g_return_val_if_fail (c, FALSE);
     TRACE ("client \"%s\" (0x%lx)", c->name, c->window);
 
-    frameDrawWin (c);
     c->frame_timeout_id = 0;
+    if ((c->frame_dirty & ~FRAME_PART_BUTTONS)
+        || !frameDrawButtons (c, c->frame_dirty))
+    {
+        frameDrawWin (c);
+    }
 
     return FALSE;
 }
@@ -1074,7 +1579,7 @@ frameDecorationLeft (ScreenInfo *screen_info)
     TRACE ("entering");
 
     g_return_val_if_fail (screen_info != NULL, 0);
-    return screen_info->sides[SIDE_LEFT][ACTIVE].width;
+    return myScreenGetThemeParts (screen_info, screen_info->default_scale)->sides[SIDE_LEFT][ACTIVE].width;
 }
 
 int
@@ -1083,7 +1588,7 @@ frameDecorationRight (ScreenInfo *screen_info)
     TRACE ("entering");
 
     g_return_val_if_fail (screen_info != NULL, 0);
-    return screen_info->sides[SIDE_RIGHT][ACTIVE].width;
+    return myScreenGetThemeParts (screen_info, screen_info->default_scale)->sides[SIDE_RIGHT][ACTIVE].width;
 }
 
 int
@@ -1092,7 +1597,7 @@ frameDecorationTop (ScreenInfo *screen_info)
     TRACE ("entering");
 
     g_return_val_if_fail (screen_info != NULL, 0);
-    return screen_info->title[TITLE_3][ACTIVE].height;
+    return myScreenGetThemeParts (screen_info, screen_info->default_scale)->title[TITLE_3][ACTIVE].height;
 }
 
 int
@@ -1101,7 +1606,7 @@ frameDecorationBottom (ScreenInfo *screen_info)
     TRACE ("entering");
 
     g_return_val_if_fail (screen_info != NULL, 0);
-    return screen_info->sides[SIDE_BOTTOM][ACTIVE].height;
+    return myScreenGetThemeParts (screen_info, screen_info->default_scale)->sides[SIDE_BOTTOM][ACTIVE].height;
 }
 
 int
@@ -1115,7 +1620,7 @@ frameLeft (Client * c)
         && (!FLAG_TEST_ALL (c->flags, CLIENT_FLAG_MAXIMIZED)
             || !(c->screen_info->params->borderless_maximize)))
     {
-        return c->screen_info->sides[SIDE_LEFT][ACTIVE].width;
+        return c->theme->sides[SIDE_LEFT][ACTIVE].width;
     }
     return 0;
 }
@@ -1131,7 +1636,7 @@ frameRight (Client * c)
         && (!FLAG_TEST_ALL (c->flags, CLIENT_FLAG_MAXIMIZED)
             || !(c->screen_info->params->borderless_maximize)))
     {
-        return c->screen_info->sides[SIDE_RIGHT][ACTIVE].width;
+        return c->theme->sides[SIDE_RIGHT][ACTIVE].width;
     }
     return 0;
 }
@@ -1144,7 +1649,7 @@ frameTop (Client * c)
 
     if (CLIENT_HAS_FRAME (c))
     {
-        return frameDecorationTop(c->screen_info) - frameBorderTop (c);
+        return frameTitleHeight (c) - frameBorderTop (c);
     }
     return 0;
 }
@@ -1160,7 +1665,7 @@ frameBottom (Client * c)
         && (!FLAG_TEST_ALL (c->flags, CLIENT_FLAG_MAXIMIZED)
             || !(c->screen_info->params->borderless_maximize)))
     {
-        return c->screen_info->sides[SIDE_BOTTOM][ACTIVE].height;
+        return c->theme->sides[SIDE_BOTTOM][ACTIVE].height;
     }
     return 0;
 }
@@ -1369,15 +1874,26 @@ frameQueueDraw (Client * c, gboolean clear_all)
     g_return_if_fail (c);
     TRACE ("client \"%s\" (0x%lx)", c->name, c->window);
 
+    if (clear_all)
+    {
+        FLAG_SET (c->xfwm_flags, XFWM_FLAG_NEEDS_REDRAW);
+    }
+    frameQueueDrawParts (c, FRAME_PART_ALL);
+}
+
+void
+frameQueueDrawParts (Client * c, guint parts)
+{
+    g_return_if_fail (c);
+    TRACE ("client \"%s\" (0x%lx) parts 0x%x", c->name, c->window, parts);
+
+    c->frame_dirty |= parts;
+
     /* Reschedule update */
     if (c->frame_timeout_id)
     {
         frameClearQueueDraw (c);
     }
-    if (clear_all)
-    {
-        FLAG_SET (c->xfwm_flags, XFWM_FLAG_NEEDS_REDRAW);
-    }
     /* Otherwise leave previous schedule */
     if (c->frame_timeout_id == 0)
     {
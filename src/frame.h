@@ -32,6 +32,14 @@
 #include "mypixmap.h"
 #include "client.h"
 
+/* Parts of the frame pending a redraw, see frameQueueDrawParts() */
+#define FRAME_PART_TITLE         (1 << 0)
+#define FRAME_PART_SIDE(s)       (1 << (1 + (s)))
+#define FRAME_PART_CORNER(n)     (1 << (1 + SIDE_COUNT + (n)))
+#define FRAME_PART_BUTTON(b)     (1 << (1 + SIDE_COUNT + CORNER_COUNT + (b)))
+#define FRAME_PART_BUTTONS       (((1 << BUTTON_COUNT) - 1) << (1 + SIDE_COUNT + CORNER_COUNT))
+#define FRAME_PART_ALL           (~0U)
+
 int                      frameDecorationLeft                    (ScreenInfo *);
 int                      frameDecorationRight                   (ScreenInfo *);
 int                      frameDecorationTop                     (ScreenInfo *);
@@ -53,9 +61,13 @@ int                      frameExtentY                           (Client *);
 int                      frameExtentWidth                       (Client *);
 int                      frameExtentHeight                      (Client *);
 void                     frameSetShapeInput                     (Client *);
+void                     frameClearTitleCache                   (Client *);
+void                     frameFreeParts                         (ScreenInfo *);
 void                     frameClearQueueDraw                    (Client *);
 void                     frameQueueDraw                         (Client *,
                                                                  gboolean);
+void                     frameQueueDrawParts                    (Client *,
+                                                                 guint);
 void                     frameDraw                              (Client *,
                                                                  gboolean);
 
@@ -466,6 +466,14 @@ setNetSupportedHint (DisplayInfo *display_info, Window root, Window check_win)
 #ifdef HAVE_LIBSTARTUP_NOTIFICATION
     atoms[i++] = display_info->atoms[NET_STARTUP_ID];
 #endif
+#ifdef HAVE_XSYNC
+    if (display_info->have_xsync)
+    {
+        /* Sent by the compositor, or right away when not compositing */
+        atoms[i++] = display_info->atoms[NET_WM_FRAME_DRAWN];
+        atoms[i++] = display_info->atoms[NET_WM_FRAME_TIMINGS];
+    }
+#endif /* HAVE_XSYNC */
     g_assert (i < ATOM_COUNT);
     data[0] = check_win;
     XChangeProperty (display_info->dpy, root, display_info->atoms[NET_SUPPORTED],
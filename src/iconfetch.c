@@ -0,0 +1,240 @@
+/*      $Id$
+
+        This program is free software; you can redistribute it and/or modify
+        it under the terms of the GNU General Public License as published by
+        the Free Software Foundation; either version 2, or (at your option)
+        any later version.
+
+        This program is distributed in the hope that it will be useful,
+        but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+        GNU General Public License for more details.
+
+        You should have received a copy of the GNU General Public License
+        along with this program; if not, write to the Free Software
+        Foundation, Inc., Inc., 51 Franklin Street, Fifth Floor, Boston,
+        MA 02110-1301, USA.
+
+
+        xfwm4    - (c) 2002-2022 Olivier Fourdan
+
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdlib.h>
+
+#include <X11/Xlib.h>
+#include <xcb/xcb.h>
+#include <glib.h>
+#include <gdk-pixbuf/gdk-pixbuf.h>
+#include <libxfce4util/libxfce4util.h>
+
+#include "display.h"
+#include "client.h"
+#include "icons.h"
+#include "iconfetch.h"
+
+/*
+ * _NET_WM_ICON can be several megabytes for applications shipping large
+ * icons, so it is read and unpacked on a worker thread using a separate
+ * XCB connection, which reports errors with the reply rather than through
+ * the process wide Xlib error handler. The icon set is then handed over
+ * to the client from the main loop.
+ *
+ * Each request gets a serial, recorded in the client. Clearing the icon
+ * cache of the client resets it and a newer request replaces it, so
+ * results that are stale by the time they come in, or meant for a client
+ * since gone, are simply dropped. The icons of the client stay in place
+ * until the new set is handed over.
+ */
+
+typedef struct _IconFetchJob IconFetchJob;
+struct _IconFetchJob
+{
+    DisplayInfo *display_info;
+    Window window;
+    guint serial;
+    GPtrArray *icon_set;
+};
+
+static xcb_connection_t *fetch_connection = NULL;
+static GThreadPool *fetch_pool = NULL;
+static xcb_atom_t fetch_atom = XCB_ATOM_NONE;
+static guint fetch_serial = 0;
+
+static void
+iconFetchFree (gpointer data)
+{
+    IconFetchJob *job;
+
+    job = (IconFetchJob *) data;
+    if (job->icon_set)
+    {
+        g_ptr_array_free (job->icon_set, TRUE);
+    }
+    g_free (job);
+}
+
+static gboolean
+iconFetchDone (gpointer data)
+{
+    IconFetchJob *job;
+    Client *c;
+
+    job = (IconFetchJob *) data;
+    c = myDisplayGetClientFromWindow (job->display_info, job->window, SEARCH_WINDOW);
+    if ((c == NULL) || (c->icon_fetch_serial != job->serial))
+    {
+        TRACE ("dropping icon fetched for window 0x%lx", job->window);
+        return FALSE;
+    }
+
+    TRACE ("client \"%s\" (0x%lx) got %u icons", c->name, c->window, job->icon_set->len);
+
+    /* Drop the stand-in icons given out meanwhile */
+    clearAppIconCache (c);
+    c->icon_set = job->icon_set;
+    job->icon_set = NULL;
+    clientUpdateIcon (c);
+
+    return FALSE;
+}
+
+static void
+iconFetchWorker (gpointer data, gpointer user_data)
+{
+    IconFetchJob *job;
+    xcb_get_property_cookie_t cookie;
+    xcb_get_property_reply_t *reply;
+    xcb_generic_error_t *error;
+
+    job = (IconFetchJob *) data;
+
+    error = NULL;
+    cookie = xcb_get_property (fetch_connection, FALSE, job->window, fetch_atom,
+                               XCB_ATOM_CARDINAL, 0, G_MAXUINT32);
+    reply = xcb_get_property_reply (fetch_connection, cookie, &error);
+
+    if ((reply) && (reply->type == XCB_ATOM_CARDINAL) && (reply->format == 32))
+    {
+        job->icon_set = getIconSetFromData (xcb_get_property_value (reply),
+                                            xcb_get_property_value_length (reply) / 4);
+    }
+    else
+    {
+        job->icon_set = getIconSetFromData (NULL, 0);
+    }
+    free (reply);
+    free (error);
+
+    g_idle_add_full (G_PRIORITY_DEFAULT, iconFetchDone, job, iconFetchFree);
+}
+
+gboolean
+iconFetchInit (DisplayInfo *display_info)
+{
+    GError *error;
+
+    g_return_val_if_fail (display_info != NULL, FALSE);
+    g_return_val_if_fail (fetch_connection == NULL, FALSE);
+
+    fetch_connection = xcb_connect (DisplayString (display_info->dpy), NULL);
+    if (xcb_connection_has_error (fetch_connection))
+    {
+        g_warning ("Cannot open a connection to fetch icons, reading them synchronously");
+        xcb_disconnect (fetch_connection);
+        fetch_connection = NULL;
+        return FALSE;
+    }
+
+    /* One thread, so that requests are served in order */
+    error = NULL;
+    fetch_pool = g_thread_pool_new (iconFetchWorker, NULL, 1, FALSE, &error);
+    if (!fetch_pool)
+    {
+        g_warning ("Cannot start the icon fetching thread: %s", error->message);
+        g_error_free (error);
+        xcb_disconnect (fetch_connection);
+        fetch_connection = NULL;
+        return FALSE;
+    }
+
+    /* Atoms are the same for all connections */
+    fetch_atom = display_info->atoms[NET_WM_ICON];
+
+    return TRUE;
+}
+
+static void
+iconFetchPush (Client *c)
+{
+    IconFetchJob *job;
+
+    /* Never 0, which stands for no fetch in progress */
+    if (++fetch_serial == 0)
+    {
+        fetch_serial++;
+    }
+    c->icon_fetch_serial = fetch_serial;
+
+    TRACE ("client \"%s\" (0x%lx) serial %u", c->name, c->window, fetch_serial);
+
+    job = g_new0 (IconFetchJob, 1);
+    job->display_info = c->screen_info->display_info;
+    job->window = c->window;
+    job->serial = fetch_serial;
+    g_thread_pool_push (fetch_pool, job, NULL);
+}
+
+gboolean
+iconFetchRequest (Client *c)
+{
+    g_return_val_if_fail (c != NULL, FALSE);
+
+    if (fetch_pool == NULL)
+    {
+        return FALSE;
+    }
+
+    if (c->icon_fetch_serial == 0)
+    {
+        iconFetchPush (c);
+    }
+
+    return TRUE;
+}
+
+/* Like iconFetchRequest(), superseding a request still on its way */
+gboolean
+iconFetchRefresh (Client *c)
+{
+    g_return_val_if_fail (c != NULL, FALSE);
+
+    if (fetch_pool == NULL)
+    {
+        return FALSE;
+    }
+
+    iconFetchPush (c);
+
+    return TRUE;
+}
+
+void
+iconFetchClose (void)
+{
+    if (fetch_pool)
+    {
+        /* Let the current request complete, drop the queued ones */
+        g_thread_pool_free (fetch_pool, TRUE, TRUE);
+        fetch_pool = NULL;
+    }
+    if (fetch_connection)
+    {
+        xcb_disconnect (fetch_connection);
+        fetch_connection = NULL;
+    }
+}
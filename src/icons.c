@@ -43,6 +43,7 @@
 #include "client.h"
 #include "compositor.h"
 #include "hints.h"
+#include "iconfetch.h"
 
 static void
 downsize_ratio (guint *width, guint *height, guint dest_w, guint dest_h)
@@ -103,195 +104,140 @@ default_icon_at_size (GdkScreen *screen, guint width, guint height)
 }
 
 
-static gboolean
-find_largest_sizes (gulong * data, gulong nitems, guint *width, guint *height)
-{
-    guint w, h;
+/*
+ * The _NET_WM_ICON images of a client are unpacked once, along with the
+ * icons handed out at each size, and kept until the icon properties of
+ * the client change, see invalidateAppIcon().
+ */
+#define ICON_CACHE_KEY(w, h) GUINT_TO_POINTER (((w) << 16) | ((h) & 0xffff))
 
-    *width = 0;
-    *height = 0;
+static void
+argbdata_to_pixdata (const guint32 * argb_data, guint len, guint32 * pixdata)
+{
+    guint32 argb;
+    guint i;
 
-    while (nitems > 0)
+    /* Branch free, one word per pixel, so that the compiler vectorises it */
+    for (i = 0; i < len; i++)
     {
-        if (nitems < 3)
-        {
-            return FALSE;       /* no space for w, h */
-        }
-
-        w = data[0];
-        h = data[1];
-
-        if (nitems < (gulong) ((w * h) + 2))
-        {
-            return FALSE;       /* not enough data */
-        }
-
-        *width = MAX (w, *width);
-        *height = MAX (h, *height);
-
-        data += (w * h) + 2;
-        nitems -= (w * h) + 2;
+        argb = argb_data[i];
+#if G_BYTE_ORDER == G_LITTLE_ENDIAN
+        pixdata[i] = (argb & 0xff00ff00) | ((argb >> 16) & 0xff) | ((argb & 0xff) << 16);
+#else
+        pixdata[i] = (argb << 8) | (argb >> 24);
+#endif
     }
-
-    return TRUE;
 }
 
-static gboolean
-find_best_size (gulong * data, gulong nitems, gint ideal_width, gint ideal_height,
-                guint *width, guint *height, gulong ** start)
+/*
+ * Unpack the images of a _NET_WM_ICON property, given as 32 bit words.
+ * Only allocates pixbufs, so it can be used off the main thread.
+ */
+GPtrArray *
+getIconSetFromData (const guint32 *data, gsize nitems)
 {
-    gulong *best_start;
-    guint ideal_size;
-    guint w, h, best_size, this_size;
-    guint best_w, best_h, max_width, max_height;
+    GPtrArray *icon_set;
+    GdkPixbuf *pixbuf;
+    const guint32 *p;
+    gsize w, h;
+    guchar *pixels;
+    gint rowstride;
+    gsize y;
 
-    *width = 0;
-    *height = 0;
-    *start = NULL;
+    icon_set = g_ptr_array_new_with_free_func (g_object_unref);
 
-    if (!find_largest_sizes (data, nitems, &max_width, &max_height))
-    {
-        return FALSE;
-    }
-
-    if (ideal_width < 0)
-    {
-        ideal_width = max_width;
-    }
-    if (ideal_height < 0)
+    p = data;
+    while (p && (nitems >= 3))
     {
-        ideal_height = max_height;
-    }
-
-    best_w = 0;
-    best_h = 0;
-    best_start = NULL;
-
-    while (nitems > 0)
-    {
-        gboolean replace;
-
-        replace = FALSE;
-
-        if (nitems < 3)
-        {
-            return FALSE;       /* no space for w, h */
-        }
+        w = p[0];
+        h = p[1];
 
-        w = data[0];
-        h = data[1];
-
-        if (nitems < (gulong) ((w * h) + 2))
+        if ((w == 0) || (h == 0) || (w > G_MAXUINT16) || (h > G_MAXUINT16) ||
+            (nitems - 2 < w * h))
         {
             break;              /* not enough data */
         }
 
-        if (best_start == NULL)
-        {
-            replace = TRUE;
-        }
-        else
+        pixbuf = gdk_pixbuf_new (GDK_COLORSPACE_RGB, TRUE, 8, w, h);
+        if (pixbuf)
         {
-            /* work with averages */
-            ideal_size = (ideal_width + ideal_height) / 2;
-            best_size = (best_w + best_h) / 2;
-            this_size = (w + h) / 2;
-
-            if ((best_size < ideal_size) && (this_size >= ideal_size))
+            /* Rows of a 32 bit pixbuf are word aligned */
+            pixels = gdk_pixbuf_get_pixels (pixbuf);
+            rowstride = gdk_pixbuf_get_rowstride (pixbuf);
+            for (y = 0; y < h; y++)
             {
-                /* larger than desired is always better than smaller */
-                replace = TRUE;
-            }
-            else if ((best_size < ideal_size) && (this_size > best_size))
-            {
-                /* if we have too small, pick anything bigger */
-                replace = TRUE;
-            }
-            else if ((best_size > ideal_size) && (this_size >= ideal_size) && (this_size < best_size))
-            {
-                /* if we have too large, pick anything smaller but still >= the ideal */
-                replace = TRUE;
+                argbdata_to_pixdata (p + 2 + y * w, w, (guint32 *) (pixels + y * rowstride));
             }
+            g_ptr_array_add (icon_set, pixbuf);
         }
 
-        if (replace)
-        {
-            best_start = data + 2;
-            best_w = w;
-            best_h = h;
-        }
-
-        data += (w * h) + 2;
+        p += (w * h) + 2;
         nitems -= (w * h) + 2;
     }
 
-    if (best_start)
-    {
-        *start = best_start;
-        *width = best_w;
-        *height = best_h;
-        return TRUE;
-    }
-
-    return FALSE;
-}
-
-static void
-argbdata_to_pixdata (gulong * argb_data, guint len, guchar ** pixdata)
-{
-    guchar *p;
-    guint argb;
-    guint rgba;
-    guint i;
-
-    *pixdata = g_new0 (guchar, len * 4);
-    p = *pixdata;
-
-    i = 0;
-    while (i < len)
-    {
-        argb = argb_data[i];
-        rgba = (argb << 8) | (argb >> 24);
-
-        *p = rgba >> 24; ++p;
-        *p = (rgba >> 16) & 0xff; ++p;
-        *p = (rgba >> 8) & 0xff; ++p;
-        *p = rgba & 0xff; ++p;
-
-        ++i;
-    }
+    return icon_set;
 }
 
-static gboolean
-read_rgb_icon (DisplayInfo *display_info, Window window, guint ideal_width, guint ideal_height,
-               guint *width, guint *height, guchar ** pixdata)
+static GPtrArray *
+read_rgb_icon_set (DisplayInfo *display_info, Window window)
 {
+    GPtrArray *icon_set;
     gulong nitems;
     gulong *data;
-    gulong *best;
-    guint w, h;
+    guint32 *words;
+    gulong i;
 
     data = NULL;
 
     if (!getRGBIconData (display_info, window, &data, &nitems))
     {
-        return FALSE;
+        return getIconSetFromData (NULL, 0);
     }
 
-    if (!find_best_size (data, nitems, ideal_width, ideal_height, &w, &h, &best))
+    /* Xlib returns format 32 data as longs, pack it into words in place */
+    words = (guint32 *) data;
+    for (i = 0; i < nitems; i++)
     {
-        XFree (data);
-        return FALSE;
+        words[i] = (guint32) data[i];
     }
+    icon_set = getIconSetFromData (words, nitems);
+    XFree (data);
+
+    return icon_set;
+}
 
-    *width = w;
-    *height = h;
+static GdkPixbuf *
+find_best_icon (GPtrArray *icon_set, guint ideal_width, guint ideal_height)
+{
+    GdkPixbuf *best;
+    GdkPixbuf *pixbuf;
+    guint ideal_size, best_size, this_size;
+    guint i;
 
-    argbdata_to_pixdata (best, w * h, pixdata);
+    best = NULL;
+    best_size = 0;
+    /* work with averages */
+    ideal_size = (ideal_width + ideal_height) / 2;
 
-    XFree (data);
+    for (i = 0; i < icon_set->len; i++)
+    {
+        pixbuf = g_ptr_array_index (icon_set, i);
+        this_size = (gdk_pixbuf_get_width (pixbuf) + gdk_pixbuf_get_height (pixbuf)) / 2;
+
+        if ((best == NULL) ||
+            /* larger than desired is always better than smaller */
+            ((best_size < ideal_size) && (this_size >= ideal_size)) ||
+            /* if we have too small, pick anything bigger */
+            ((best_size < ideal_size) && (this_size > best_size)) ||
+            /* if we have too large, pick anything smaller but still >= the ideal */
+            ((best_size > ideal_size) && (this_size >= ideal_size) && (this_size < best_size)))
+        {
+            best = pixbuf;
+            best_size = this_size;
+        }
+    }
 
-    return TRUE;
+    return best;
 }
 
 static void
@@ -457,59 +403,45 @@ try_pixmap_and_mask (ScreenInfo *screen_info, Pixmap src_pixmap, Pixmap src_mask
     return NULL;
 }
 
-static void
-free_pixels (guchar * pixels, gpointer data)
-{
-    g_free (pixels);
-}
-
 static GdkPixbuf *
-scaled_from_pixdata (guchar * pixdata, guint w, guint h, guint dest_w, guint dest_h)
+scaled_from_icon (GdkPixbuf *src, guint dest_w, guint dest_h)
 {
-    GdkPixbuf *src;
-    GdkPixbuf *dest;
-
-    src = gdk_pixbuf_new_from_data (pixdata, GDK_COLORSPACE_RGB, TRUE, 8, w, h, w * 4, free_pixels, NULL);
+    guint w, h;
 
-    if (G_UNLIKELY (src == NULL))
-    {
-        return NULL;
-    }
+    w = (guint) gdk_pixbuf_get_width (src);
+    h = (guint) gdk_pixbuf_get_height (src);
 
     if (w != dest_w || h != dest_h)
     {
         downsize_ratio (&w, &h, dest_w, dest_h);
-        dest = gdk_pixbuf_scale_simple (src, w, h, GDK_INTERP_BILINEAR);
-        g_object_unref (G_OBJECT (src));
-    }
-    else
-    {
-        dest = src;
+        return gdk_pixbuf_scale_simple (src, w, h, GDK_INTERP_BILINEAR);
     }
 
-    return dest;
+    return g_object_ref (src);
 }
 
-GdkPixbuf *
-getAppIcon (Client *c, guint width, guint height)
+static GdkPixbuf *
+load_app_icon (Client *c, guint width, guint height)
 {
     ScreenInfo *screen_info;
     XWMHints *hints;
+    GdkPixbuf *best;
     Pixmap pixmap;
     Pixmap mask;
-    guchar *pixdata;
-    guint w, h;
 
-    g_return_val_if_fail (c != NULL, NULL);
-
-    pixdata = NULL;
     pixmap = None;
     mask = None;
 
     screen_info = c->screen_info;
-    if (read_rgb_icon (screen_info->display_info, c->window, width, height, &w, &h, &pixdata))
+    if ((c->icon_set == NULL) && !iconFetchRequest (c))
+    {
+        c->icon_set = read_rgb_icon_set (screen_info->display_info, c->window);
+    }
+
+    best = c->icon_set ? find_best_icon (c->icon_set, width, height) : NULL;
+    if (best)
     {
-        return scaled_from_pixdata (pixdata, w, h, width, height);
+        return scaled_from_icon (best, width, height);
     }
 
     myDisplayErrorTrapPush (screen_info->display_info);
@@ -565,6 +497,85 @@ getAppIcon (Client *c, guint width, guint height)
     return default_icon_at_size (screen_info->gscr, width, height);
 }
 
+GdkPixbuf *
+getAppIcon (Client *c, guint width, guint height)
+{
+    GdkPixbuf *icon;
+
+    g_return_val_if_fail (c != NULL, NULL);
+
+    if (c->icon_cache == NULL)
+    {
+        c->icon_cache = g_hash_table_new_full (g_direct_hash, g_direct_equal,
+                                               NULL, g_object_unref);
+    }
+
+    icon = g_hash_table_lookup (c->icon_cache, ICON_CACHE_KEY (width, height));
+    if (icon == NULL)
+    {
+        icon = load_app_icon (c, width, height);
+        if ((icon == NULL) || (c->icon_set == NULL))
+        {
+            /* Stand-in until _NET_WM_ICON comes in, see iconfetch.c */
+            return icon;
+        }
+        g_hash_table_insert (c->icon_cache, ICON_CACHE_KEY (width, height), icon);
+    }
+
+    /* Shared with the cache, callers must not draw on it */
+    return g_object_ref (icon);
+}
+
+void
+clearAppIconCache (Client *c)
+{
+    g_return_if_fail (c != NULL);
+
+    TRACE ("client \"%s\" (0x%lx)", c->name, c->window);
+
+    /* Results of a fetch in progress are stale now */
+    c->icon_fetch_serial = 0;
+    if (c->icon_set)
+    {
+        g_ptr_array_free (c->icon_set, TRUE);
+        c->icon_set = NULL;
+    }
+    if (c->icon_cache)
+    {
+        g_hash_table_destroy (c->icon_cache);
+        c->icon_cache = NULL;
+    }
+}
+
+/*
+ * The icon properties of the client changed. With refetch, _NET_WM_ICON
+ * changed and the current icons are kept until the new set comes in,
+ * rather than going through the stand-in icons meanwhile. Otherwise only
+ * the icons taken from the other properties may differ.
+ */
+void
+invalidateAppIcon (Client *c, gboolean refetch)
+{
+    g_return_if_fail (c != NULL);
+
+    TRACE ("client \"%s\" (0x%lx)", c->name, c->window);
+
+    if (!refetch)
+    {
+        if (c->icon_cache)
+        {
+            g_hash_table_destroy (c->icon_cache);
+            c->icon_cache = NULL;
+        }
+        return;
+    }
+
+    if ((c->icon_set == NULL) || !iconFetchRefresh (c))
+    {
+        clearAppIconCache (c);
+    }
+}
+
 GdkPixbuf *
 getClientIcon (Client *c, guint width, guint height)
 {
@@ -41,5 +41,10 @@ GdkPixbuf               *getAppIcon                             (Client *,
 GdkPixbuf               *getClientIcon                          (Client *,
                                                                  guint,
                                                                  guint);
+GPtrArray               *getIconSetFromData                     (const guint32 *,
+                                                                 gsize);
+void                     clearAppIconCache                      (Client *);
+void                     invalidateAppIcon                      (Client *,
+                                                                 gboolean);
 
 #endif /* INC_ICONS_H */
@@ -64,6 +64,10 @@
 #include "startup_notification.h"
 #include "compositor.h"
 #include "spinning_cursor.h"
+#include "eventtrace.h"
+#include "eventrecord.h"
+#include "iconfetch.h"
+#include "xaccount.h"
 
 static GMainLoop *xfwm_main_loop = NULL;
 
@@ -164,9 +168,15 @@ handleSignal (int sig)
                 gtk_main_quit ();
                 display_info->quit = TRUE;
                 break;
-            case SIGHUP:
-                /* Walk thru */
             case SIGUSR1:
+                /* When tracing, dump the statistics instead */
+                if (eventTraceIsEnabled () || xAccountIsEnabled ())
+                {
+                    display_info->dump_trace = TRUE;
+                    break;
+                }
+                /* Walk thru */
+            case SIGHUP:
                 display_info->reload = TRUE;
                 break;
             default:
@@ -207,6 +217,10 @@ cleanUp (void)
     g_return_if_fail (display_info);
 
     eventFilterClose (display_info->xfilter);
+    eventTraceClose (display_info);
+    xAccountClose ();
+    eventRecordStop ();
+    iconFetchClose ();
     for (screens = display_info->screens; screens; screens = g_slist_next (screens))
     {
         ScreenInfo *screen_info_n = (ScreenInfo *) screens->data;
@@ -538,6 +552,8 @@ initialize (gboolean replace_wm)
 #endif /* HAVE_COMPOSITOR */
   
     initModifiers (display_info->dpy);
+    xAccountInitDisplay (display_info);
+    iconFetchInit (display_info);
 
     setupHandler (TRUE);
 
@@ -662,6 +678,13 @@ main (int argc, char **argv)
     gboolean version = FALSE;
     gboolean replace_wm = FALSE;
     gboolean opt_wayland = FALSE;
+    gboolean trace_events = FALSE;
+    gboolean trace_requests = FALSE;
+    gchar *trace_file = NULL;
+    gchar *requests_file = NULL;
+    gchar *record_file = NULL;
+    gchar *replay_file = NULL;
+    gboolean replay_quit = FALSE;
     int status;
     GOptionContext *context;
     GError *error = NULL;
@@ -689,6 +712,20 @@ main (int argc, char **argv)
           &opt_wayland,
           N_("Run as a Wayland compositor"),
           NULL,},
+        { "trace-events", 0, 0, G_OPTION_ARG_NONE,
+          &trace_events, N_("Trace event handlers, dump statistics on SIGUSR1"), NULL },
+        { "trace-file", 0, 0, G_OPTION_ARG_FILENAME,
+          &trace_file, N_("Write the event trace to a Chrome trace file"), N_("FILE") },
+        { "trace-requests", 0, 0, G_OPTION_ARG_NONE,
+          &trace_requests, N_("Count X requests and round-trips, dump statistics on SIGUSR1"), NULL },
+        { "trace-requests-file", 0, 0, G_OPTION_ARG_FILENAME,
+          &requests_file, N_("Also write the X requests statistics to a file"), N_("FILE") },
+        { "record-events", 0, 0, G_OPTION_ARG_FILENAME,
+          &record_file, N_("Record the X events received to a file"), N_("FILE") },
+        { "replay-events", 0, 0, G_OPTION_ARG_FILENAME,
+          &replay_file, N_("Replay the X events recorded in a file"), N_("FILE") },
+        { "quit-after-replay", 0, 0, G_OPTION_ARG_NONE,
+          &replay_quit, N_("Exit once the recorded events are replayed"), NULL },
         { "version", 'V', 0, G_OPTION_ARG_NONE,
           &version, N_("Print version information and exit"), NULL },
 #ifdef DEBUG
@@ -750,6 +787,23 @@ main (int argc, char **argv)
   
     xfwmSetIsWaylandCompositor (opt_wayland);
 
+    if (trace_events || trace_file)
+    {
+        eventTraceInit (trace_file);
+        g_free (trace_file);
+    }
+    /* Replaying reports the requests and round-trips it took */
+    if (trace_requests || requests_file || replay_file)
+    {
+        xAccountInit (requests_file);
+        g_free (requests_file);
+    }
+    if (record_file)
+    {
+        eventRecordStart (record_file);
+        g_free (record_file);
+    }
+
 #ifdef DEBUG
     setupLog (debug);
 #endif /* DEBUG */
@@ -799,6 +853,11 @@ main (int argc, char **argv)
             break;
         case 0:
         case 1:
+            if (replay_file)
+            {
+                eventReplayStart (myDisplayGetDefault (), replay_file, replay_quit);
+                g_free (replay_file);
+            }
             /* enter GTK main loop */
             gtk_main ();
             break;
@@ -37,6 +37,8 @@
 #include <gdk/gdkx.h>
 #include <gtk/gtk.h>
 
+#include <common/xfwm-common.h>
+
 #include "client.h"
 #include "compositor.h"
 #include "focus.h"
@@ -47,11 +49,13 @@
 #include "poswin.h"
 #include "screen.h"
 #include "settings.h"
+#include "spatial.h"
 #include "transients.h"
 #include "event_filter.h"
 #include "wireframe.h"
 #include "workspaces.h"
 #include "xsync.h"
+#include "xaccount.h"
 
 #define MOVERESIZE_POINTER_EVENT_MASK \
     PointerMotionMask | \
@@ -63,6 +67,12 @@
     KeyPressMask
 
 #define TILE_DISTANCE 10
+/* Largest extrapolation of the pointer position, in pixels */
+#define MOVE_PREDICT_MAX 100
+/* Pointer velocity is reset after that long without motion, in usec */
+#define MOVE_PREDICT_RESET (100 * 1000)
+/* Interval between actual moves of the window with fast_move, in usec */
+#define FAST_MOVE_INTERVAL (100 * 1000)
 #define BORDER_TILE_LENGTH_RELATIVE 5
 #define use_xor_move(screen_info) (screen_info->params->box_move && !compositorIsActive (screen_info))
 #define use_xor_resize(screen_info) (screen_info->params->box_resize && !compositorIsActive (screen_info))
@@ -91,6 +101,19 @@ struct _MoveResizeData
     gint oldw, oldh;
     gint handle;
     Poswin *poswin;
+    /* Resize pacing */
+    gboolean configure_pending;
+    guint configure_timeout_id;
+    gint64 last_configure;
+    gint64 frame_interval;
+    /* Move coalescing and prediction */
+    XfwmEventMotion motion;
+    gint64 motion_time;
+    gdouble velocity_x, velocity_y;
+    gboolean motion_predicted;
+    /* Compositor side move */
+    gboolean translated;
+    gint64 last_xmove;
 };
 
 static int
@@ -378,15 +401,24 @@ clientFindClosestEdgeX (Client *c, int edge_pos)
 
     Client *c2;
     ScreenInfo *screen_info;
-    guint i;
+    GdkRectangle area;
+    GList *candidates, *list;
     int snap_width, closest;
 
     screen_info = c->screen_info;
     snap_width = screen_info->params->snap_width;
     closest = edge_pos + snap_width + 2; /* This only needs to be out of the snap range to work. -Cliff */
 
-    for (c2 = screen_info->clients, i = 0; i < screen_info->client_count; c2 = c2->next, i++)
+    /* Only edges within the snapping range along our own height may matter */
+    area.x = edge_pos - snap_width;
+    area.width = 2 * snap_width;
+    area.y = c->y - frameExtentTop (c) - frameExtentBottom (c) - 2;
+    area.height = c->height + 2 * (frameExtentTop (c) + frameExtentBottom (c) + 2);
+    candidates = spatialIndexQueryRect (screen_info, &area);
+
+    for (list = candidates; list; list = g_list_next (list))
     {
+        c2 = (Client *) list->data;
         if (FLAG_TEST (c2->xfwm_flags, XFWM_FLAG_VISIBLE)  && (c2 != c) &&
             (((screen_info->params->snap_to_windows) && (c2->win_layer == c->win_layer))
              || ((screen_info->params->snap_to_border)
@@ -407,6 +439,7 @@ clientFindClosestEdgeX (Client *c, int edge_pos)
             }
         }
     }
+    g_list_free (candidates);
 
     if (abs (closest - edge_pos) > snap_width)
     {
@@ -425,15 +458,23 @@ clientFindClosestEdgeY (Client *c, int edge_pos)
 
     Client *c2;
     ScreenInfo *screen_info;
-    guint i;
+    GdkRectangle area;
+    GList *candidates, *list;
     int snap_width, closest;
 
     screen_info = c->screen_info;
     snap_width = screen_info->params->snap_width;
     closest = edge_pos + snap_width + 1; /* This only needs to be out of the snap range to work. -Cliff */
 
-    for (c2 = screen_info->clients, i = 0; i < screen_info->client_count; c2 = c2->next, i++)
+    area.x = c->x - frameExtentLeft (c) - frameExtentRight (c) - 2;
+    area.width = c->width + 2 * (frameExtentLeft (c) + frameExtentRight (c) + 2);
+    area.y = edge_pos - snap_width;
+    area.height = 2 * snap_width;
+    candidates = spatialIndexQueryRect (screen_info, &area);
+
+    for (list = candidates; list; list = g_list_next (list))
     {
+        c2 = (Client *) list->data;
         if (FLAG_TEST (c2->xfwm_flags, XFWM_FLAG_VISIBLE)  && (c2 != c) &&
             (((screen_info->params->snap_to_windows) && (c2->win_layer == c->win_layer))
              || ((screen_info->params->snap_to_border)
@@ -454,6 +495,7 @@ clientFindClosestEdgeY (Client *c, int edge_pos)
             }
         }
     }
+    g_list_free (candidates);
 
     if (abs (closest - edge_pos) > snap_width)
     {
@@ -866,6 +908,254 @@ clientMoveTile (Client *c, XfwmEventMotion *event)
     return FALSE;
 }
 
+static gboolean clientMoveTimeout (gpointer data);
+
+static void
+clientCancelPendingConfigure (MoveResizeData *passdata)
+{
+    if (passdata->configure_timeout_id)
+    {
+        g_source_remove (passdata->configure_timeout_id);
+        passdata->configure_timeout_id = 0;
+    }
+    passdata->configure_pending = FALSE;
+}
+
+/*
+ * Pointer motion is coalesced, so that the window is moved at most once
+ * per refresh of the monitor, to the latest position of the pointer.
+ * Optionally, the position is extrapolated from the pointer velocity to
+ * the time the move shows on screen, so the window lags less behind the
+ * pointer. The actual pointer position is applied when the move ends.
+ */
+static void
+clientMoveApply (MoveResizeData *passdata, gboolean predict)
+{
+    ScreenInfo *screen_info;
+    DisplayInfo *display_info;
+    XfwmEventMotion motion;
+    XWindowChanges wc;
+    Client *c;
+    int prev_x, prev_y;
+    int dx, dy;
+
+    c = passdata->c;
+    screen_info = c->screen_info;
+    display_info = screen_info->display_info;
+    prev_x = c->x;
+    prev_y = c->y;
+    motion = passdata->motion;
+
+    dx = dy = 0;
+    if (predict && screen_info->params->predict_move)
+    {
+        dx = (int) CLAMP (passdata->velocity_x * passdata->frame_interval, -MOVE_PREDICT_MAX, MOVE_PREDICT_MAX);
+        dy = (int) CLAMP (passdata->velocity_y * passdata->frame_interval, -MOVE_PREDICT_MAX, MOVE_PREDICT_MAX);
+    }
+    passdata->motion_predicted = (dx != 0 || dy != 0);
+    passdata->configure_pending = FALSE;
+    passdata->last_configure = g_get_monotonic_time ();
+
+    if (!passdata->grab && use_xor_move(screen_info))
+    {
+        myDisplayGrabServer (display_info);
+        passdata->grab = TRUE;
+        clientDrawOutline (c);
+    }
+    if (use_xor_move(screen_info))
+    {
+        clientDrawOutline (c);
+    }
+    if ((screen_info->workspace_count > 1) && !(passdata->is_transient))
+    {
+        clientMoveWarp (c, screen_info,
+                        &motion.x_root,
+                        &motion.y_root,
+                        motion.time);
+        if ((motion.x_root != passdata->motion.x_root) ||
+            (motion.y_root != passdata->motion.y_root))
+        {
+            /* The pointer was warped, start over from there */
+            passdata->motion = motion;
+            passdata->velocity_x = 0.0;
+            passdata->velocity_y = 0.0;
+            dx = dy = 0;
+        }
+    }
+
+    if (FLAG_TEST (c->flags, CLIENT_FLAG_RESTORE_SIZE_POS))
+    {
+        gboolean size_changed;
+
+        size_changed = clientToggleMaximized (c, c->flags & CLIENT_FLAG_MAXIMIZED, FALSE);
+        if (clientRestoreSizePos (c))
+        {
+            size_changed = TRUE;
+        }
+        if (size_changed)
+        {
+            passdata->move_resized = TRUE;
+            clientUntile (c);
+            if (!screen_info->params->box_move)
+            {
+                clientSetNetState (c);
+            }
+
+            /* to keep the distance from the edges of the window proportional. */
+            passdata->ox = c->x;
+            passdata->mx = frameExtentX (c) + passdata->pxratio * frameExtentWidth (c);
+            passdata->oy = c->y;
+            passdata->my = frameExtentY (c) + passdata->pyratio * frameExtentHeight (c);
+
+            passdata->configure_flags = CFG_FORCE_REDRAW;
+        }
+    }
+
+    c->x = passdata->ox + (motion.x_root + dx - passdata->mx);
+    c->y = passdata->oy + (motion.y_root + dy - passdata->my);
+
+    clientSnapPosition (c, prev_x, prev_y);
+    if (clientMoveTile (c, &motion))
+    {
+        passdata->configure_flags = CFG_FORCE_REDRAW;
+        passdata->move_resized = TRUE;
+    }
+    else
+    {
+        clientConstrainPos(c, FALSE);
+    }
+    /* The window may not be configured below, keep the index in sync */
+    spatialIndexUpdate (c);
+
+#ifdef SHOW_POSITION
+    if (passdata->poswin)
+    {
+        poswinSetPosition (passdata->poswin, c);
+    }
+#endif /* SHOW_POSITION */
+    if (screen_info->params->box_move)
+    {
+        if (passdata->wireframe)
+        {
+            wireframeUpdate  (c, passdata->wireframe);
+        }
+        else
+        {
+            clientDrawOutline (c);
+        }
+    }
+    else
+    {
+        int changes = CWX | CWY;
+
+        /*
+         * With fast_move, the compositor moves the window in its scene
+         * and the window itself follows at a lower rate, so that slow
+         * clients do not have to keep up with every ConfigureNotify.
+         */
+        if (screen_info->params->fast_move &&
+            compositorTranslateWindow (display_info, c->frame, frameX (c), frameY (c)))
+        {
+            gint64 since_xmove;
+
+            passdata->translated = TRUE;
+            /* Crossing to a monitor with another scale resizes the frame, do it now */
+            if (clientUpdateTheme (c))
+            {
+                passdata->move_resized = TRUE;
+                passdata->configure_flags = CFG_FORCE_REDRAW;
+            }
+            since_xmove = passdata->last_configure - passdata->last_xmove;
+            if (!passdata->move_resized && (passdata->configure_flags == NO_CFG_FLAG) &&
+                (since_xmove < FAST_MOVE_INTERVAL))
+            {
+                /* Make sure the X window catches up if the pointer stops here */
+                if (!passdata->configure_timeout_id)
+                {
+                    passdata->configure_pending = TRUE;
+                    passdata->configure_timeout_id =
+                        g_timeout_add_full (G_PRIORITY_HIGH,
+                                            (guint) ((FAST_MOVE_INTERVAL - since_xmove + 999) / 1000),
+                                            clientMoveTimeout, passdata, NULL);
+                }
+                return;
+            }
+        }
+        passdata->last_xmove = passdata->last_configure;
+
+        if (passdata->move_resized)
+        {
+            wc.width = c->width;
+            wc.height = c->height;
+            changes |= CWWidth | CWHeight;
+            passdata->move_resized = FALSE;
+        }
+
+        wc.x = c->x;
+        wc.y = c->y;
+        clientConfigure (c, &wc, changes, passdata->configure_flags);
+        /* Configure applied, clear the flags */
+        passdata->configure_flags = NO_CFG_FLAG;
+    }
+}
+
+static gboolean
+clientMoveTimeout (gpointer data)
+{
+    MoveResizeData *passdata;
+
+    passdata = (MoveResizeData *) data;
+    passdata->configure_timeout_id = 0;
+    if (passdata->configure_pending)
+    {
+        clientMoveApply (passdata, TRUE);
+    }
+
+    return FALSE;
+}
+
+static void
+clientMoveQueueMotion (MoveResizeData *passdata, XfwmEventMotion *motion)
+{
+    gint64 now, elapsed, delay;
+
+    /* Pointer velocity in pixels per microsecond, smoothed */
+    now = g_get_monotonic_time ();
+    elapsed = now - passdata->motion_time;
+    if ((passdata->motion_time == 0) || (elapsed > MOVE_PREDICT_RESET))
+    {
+        passdata->velocity_x = 0.0;
+        passdata->velocity_y = 0.0;
+    }
+    else if (elapsed > 0)
+    {
+        passdata->velocity_x = (passdata->velocity_x +
+                                (gdouble) (motion->x_root - passdata->motion.x_root) / elapsed) / 2.0;
+        passdata->velocity_y = (passdata->velocity_y +
+                                (gdouble) (motion->y_root - passdata->motion.y_root) / elapsed) / 2.0;
+    }
+    passdata->motion_time = now;
+    passdata->motion = *motion;
+    passdata->configure_pending = TRUE;
+
+    if (passdata->configure_timeout_id)
+    {
+        return;
+    }
+
+    delay = passdata->last_configure + passdata->frame_interval - now;
+    if (delay <= 0)
+    {
+        clientMoveApply (passdata, TRUE);
+    }
+    else
+    {
+        passdata->configure_timeout_id =
+            g_timeout_add_full (G_PRIORITY_HIGH, (guint) ((delay + 999) / 1000),
+                                clientMoveTimeout, passdata, NULL);
+    }
+}
+
 static eventFilterStatus
 clientMoveEventFilter (XfwmEvent *event, gpointer data)
 {
@@ -875,16 +1165,12 @@ clientMoveEventFilter (XfwmEvent *event, gpointer data)
     MoveResizeData *passdata = (MoveResizeData *) data;
     Client *c = NULL;
     gboolean moving;
-    XWindowChanges wc;
-    int prev_x, prev_y;
     unsigned long cancel_maximize_flags;
     unsigned long cancel_restore_size_flags;
 
     TRACE ("entering");
 
     c = passdata->c;
-    prev_x=c->x;
-    prev_y=c->y;
     screen_info = c->screen_info;
     display_info = screen_info->display_info;
 
@@ -933,6 +1219,9 @@ clientMoveEventFilter (XfwmEvent *event, gpointer data)
         {
             moving = FALSE;
             passdata->released = passdata->use_keys;
+            /* Drop any motion not applied yet */
+            clientCancelPendingConfigure (passdata);
+            passdata->motion_predicted = FALSE;
 
             if (screen_info->params->box_move)
             {
@@ -1010,101 +1299,7 @@ clientMoveEventFilter (XfwmEvent *event, gpointer data)
             myDisplayUpdateCurrentTime (display_info, event);
         }
 
-        if (!passdata->grab && use_xor_move(screen_info))
-        {
-            myDisplayGrabServer (display_info);
-            passdata->grab = TRUE;
-            clientDrawOutline (c);
-        }
-        if (use_xor_move(screen_info))
-        {
-            clientDrawOutline (c);
-        }
-        if ((screen_info->workspace_count > 1) && !(passdata->is_transient))
-        {
-            clientMoveWarp (c, screen_info,
-                            &event->motion.x_root,
-                            &event->motion.y_root,
-                            event->motion.time);
-        }
-
-        if (FLAG_TEST (c->flags, CLIENT_FLAG_RESTORE_SIZE_POS))
-        {
-            gboolean size_changed;
-
-            size_changed = clientToggleMaximized (c, c->flags & CLIENT_FLAG_MAXIMIZED, FALSE);
-            if (clientRestoreSizePos (c))
-            {
-                size_changed = TRUE;
-            }
-            if (size_changed)
-            {
-                passdata->move_resized = TRUE;
-                clientUntile (c);
-                if (!screen_info->params->box_move)
-                {
-                    clientSetNetState (c);
-                }
-
-                /* to keep the distance from the edges of the window proportional. */
-                passdata->ox = c->x;
-                passdata->mx = frameExtentX (c) + passdata->pxratio * frameExtentWidth (c);
-                passdata->oy = c->y;
-                passdata->my = frameExtentY (c) + passdata->pyratio * frameExtentHeight (c);
-
-                passdata->configure_flags = CFG_FORCE_REDRAW;
-            }
-        }
-
-        c->x = passdata->ox + (event->motion.x_root - passdata->mx);
-        c->y = passdata->oy + (event->motion.y_root - passdata->my);
-
-        clientSnapPosition (c, prev_x, prev_y);
-        if (clientMoveTile (c, &event->motion))
-        {
-            passdata->configure_flags = CFG_FORCE_REDRAW;
-            passdata->move_resized = TRUE;
-        }
-        else
-        {
-            clientConstrainPos(c, FALSE);
-        }
-
-#ifdef SHOW_POSITION
-        if (passdata->poswin)
-        {
-            poswinSetPosition (passdata->poswin, c);
-        }
-#endif /* SHOW_POSITION */
-        if (screen_info->params->box_move)
-        {
-            if (passdata->wireframe)
-            {
-                wireframeUpdate  (c, passdata->wireframe);
-            }
-            else
-            {
-                clientDrawOutline (c);
-            }
-        }
-        else
-        {
-            int changes = CWX | CWY;
-
-            if (passdata->move_resized)
-            {
-                wc.width = c->width;
-                wc.height = c->height;
-                changes |= CWWidth | CWHeight;
-                passdata->move_resized = FALSE;
-            }
-
-            wc.x = c->x;
-            wc.y = c->y;
-            clientConfigure (c, &wc, changes, passdata->configure_flags);
-            /* Configure applied, clear the flags */
-            passdata->configure_flags = NO_CFG_FLAG;
-        }
+        clientMoveQueueMotion (passdata, &event->motion);
     }
     else if ((event->meta.xevent->type == UnmapNotify) && (event->meta.window == c->window))
     {
@@ -1130,6 +1325,13 @@ clientMoveEventFilter (XfwmEvent *event, gpointer data)
     if (!moving)
     {
         TRACE ("event loop now finished");
+        if (!passdata->client_gone &&
+            (passdata->configure_pending || passdata->motion_predicted))
+        {
+            /* Land on the actual pointer position */
+            clientCancelPendingConfigure (passdata);
+            clientMoveApply (passdata, FALSE);
+        }
         clientSaveSizePos (c);
         gtk_main_quit ();
     }
@@ -1183,6 +1385,16 @@ clientMove (Client * c, XfwmEventButton *event)
     passdata.is_transient = clientIsValidTransientOrModal (c);
     passdata.move_resized = FALSE;
     passdata.wireframe = NULL;
+    passdata.configure_pending = FALSE;
+    passdata.configure_timeout_id = 0;
+    passdata.last_configure = 0;
+    passdata.frame_interval = G_USEC_PER_SEC / MAX (xfwm_get_primary_refresh_rate (screen_info->gscr), 1);
+    passdata.motion_time = 0;
+    passdata.velocity_x = 0.0;
+    passdata.velocity_y = 0.0;
+    passdata.motion_predicted = FALSE;
+    passdata.translated = FALSE;
+    passdata.last_xmove = 0;
 
     clientSaveSizePos (c);
 
@@ -1216,6 +1428,7 @@ clientMove (Client * c, XfwmEventButton *event)
         return;
     }
 
+    xAccountBegin (display_info, "move");
     if (screen_info->params->box_move && compositorIsActive (screen_info))
     {
         passdata.wireframe = wireframeCreate (c);
@@ -1250,6 +1463,7 @@ clientMove (Client * c, XfwmEventButton *event)
     eventFilterPush (display_info->xfilter, clientMoveEventFilter, &passdata);
     gtk_main ();
     eventFilterPop (display_info->xfilter);
+    clientCancelPendingConfigure (&passdata);
     TRACE ("leaving move loop");
     if (passdata.client_gone)
     {
@@ -1267,6 +1481,11 @@ clientMove (Client * c, XfwmEventButton *event)
 
     clientSetNetState (c);
 
+    if (passdata.translated)
+    {
+        compositorTranslateWindowDone (display_info, c->frame, frameX (c), frameY (c));
+    }
+
     wc.x = c->x;
     wc.y = c->y;
     if (passdata.move_resized)
@@ -1310,6 +1529,7 @@ move_cleanup:
     {
         myDisplayUngrabServer (display_info);
     }
+    xAccountEnd (display_info);
 }
 
 static gboolean
@@ -1340,34 +1560,122 @@ clientChangeHandle (MoveResizeData *passdata, XfwmEvent *event, int handle)
     return (grab);
 }
 
+/*
+ * Interactive resizes are paced so that the client is not sent more
+ * configure requests than it can handle: clients supporting the sync
+ * request protocol get a new size only once they have replied to the
+ * previous one, and no client gets more than one size per refresh of
+ * the monitor, or per sync reply time as measured for slow clients.
+ * Meanwhile, the pointer motion only updates the pending size, which
+ * gets applied as soon as the client is ready for it.
+ */
+static gint64
+clientResizeInterval (MoveResizeData *passdata)
+{
+#ifdef HAVE_XSYNC
+    Client *c;
+
+    c = passdata->c;
+    if (FLAG_TEST (c->flags, CLIENT_FLAG_XSYNC_ENABLED) && (c->xsync_counter))
+    {
+        return MAX (passdata->frame_interval, c->xsync_latency);
+    }
+#endif /* HAVE_XSYNC */
+    return passdata->frame_interval;
+}
+
 static void
-clientResizeConfigure (Client *c, int pw, int ph)
+clientResizeFlush (MoveResizeData *passdata)
 {
-    ScreenInfo *screen_info;
     DisplayInfo *display_info;
+    Client *c;
 
-    screen_info = c->screen_info;
-    display_info = screen_info->display_info;
+    c = passdata->c;
+    display_info = c->screen_info->display_info;
 
-    if (pw == c->width && ph == c->height)
+#ifdef HAVE_XSYNC
+    if ((display_info->have_xsync) &&
+        (FLAG_TEST (c->flags, CLIENT_FLAG_XSYNC_ENABLED)) &&
+        (c->xsync_counter))
     {
-        /* Not a resize */
-        return;
+        clientXSyncRequest (c);
+    }
+#endif /* HAVE_XSYNC */
+    clientReconfigure (c, NO_CFG_FLAG);
+
+    passdata->configure_pending = FALSE;
+    passdata->last_configure = g_get_monotonic_time ();
+}
+
+static gboolean
+clientResizeTimeout (gpointer data)
+{
+    MoveResizeData *passdata;
+
+    passdata = (MoveResizeData *) data;
+    if (!passdata->configure_pending)
+    {
+        passdata->configure_timeout_id = 0;
+        return FALSE;
     }
 #ifdef HAVE_XSYNC
-    if (!FLAG_TEST (c->flags, CLIENT_FLAG_XSYNC_WAITING))
+    if (FLAG_TEST (passdata->c->flags, CLIENT_FLAG_XSYNC_WAITING))
     {
-        if ((display_info->have_xsync) &&
-            (FLAG_TEST (c->flags, CLIENT_FLAG_XSYNC_ENABLED)) &&
-            (c->xsync_counter))
-        {
-            clientXSyncRequest (c);
-        }
+        /* Check again later, the sync request may time out */
+        return TRUE;
+    }
 #endif /* HAVE_XSYNC */
-        clientReconfigure (c, NO_CFG_FLAG);
+
+    passdata->configure_timeout_id = 0;
+    clientResizeFlush (passdata);
+
+    return FALSE;
+}
+
+static void
+clientResizeSchedule (MoveResizeData *passdata)
+{
+    gint64 delay;
+
+    if (!passdata->configure_pending || passdata->configure_timeout_id)
+    {
+        return;
+    }
 #ifdef HAVE_XSYNC
+    if (FLAG_TEST (passdata->c->flags, CLIENT_FLAG_XSYNC_WAITING))
+    {
+        /* Applied when the client replies */
+        return;
     }
 #endif /* HAVE_XSYNC */
+
+    delay = passdata->last_configure + clientResizeInterval (passdata) - g_get_monotonic_time ();
+    if (delay <= 0)
+    {
+        clientResizeFlush (passdata);
+    }
+    else
+    {
+        passdata->configure_timeout_id =
+            g_timeout_add_full (G_PRIORITY_HIGH, (guint) ((delay + 999) / 1000),
+                                clientResizeTimeout, passdata, NULL);
+    }
+}
+
+static void
+clientResizeConfigure (MoveResizeData *passdata, int pw, int ph)
+{
+    Client *c;
+
+    c = passdata->c;
+    if (pw == c->width && ph == c->height)
+    {
+        /* Not a resize */
+        return;
+    }
+
+    passdata->configure_pending = TRUE;
+    clientResizeSchedule (passdata);
 }
 
 static eventFilterStatus
@@ -1528,7 +1836,7 @@ clientResizeEventFilter (XfwmEvent *event, gpointer data)
             }
             else
             {
-                clientResizeConfigure (c, prev_width, prev_height);
+                clientResizeConfigure (passdata, prev_width, prev_height);
             }
         }
         else if (passdata->use_keys)
@@ -1622,6 +1930,7 @@ clientResizeEventFilter (XfwmEvent *event, gpointer data)
         {
             c->y =  bottom_edge - c->height;
         }
+        spatialIndexUpdate (c);
 
         if (passdata->poswin)
         {
@@ -1640,7 +1949,7 @@ clientResizeEventFilter (XfwmEvent *event, gpointer data)
         }
         else
         {
-            clientResizeConfigure (c, prev_width, prev_height);
+            clientResizeConfigure (passdata, prev_width, prev_height);
         }
     }
     else if (event->meta.type == XFWM_EVENT_BUTTON && !event->button.pressed)
@@ -1650,6 +1959,17 @@ clientResizeEventFilter (XfwmEvent *event, gpointer data)
                               passdata->button == AnyButton ||
                               passdata->button == event->button.button);
     }
+#ifdef HAVE_XSYNC
+    else if ((display_info->have_xsync) &&
+             (event->meta.xevent->type == (display_info->xsync_event_base + XSyncAlarmNotify)) &&
+             (((XSyncAlarmNotifyEvent *) event->meta.xevent)->alarm == c->xsync_alarm) &&
+             (c->xsync_alarm != None))
+    {
+        /* The client is done with the previous size, send the pending one */
+        clientXSyncUpdateValue (c, ((XSyncAlarmNotifyEvent *) event->meta.xevent)->counter_value);
+        clientResizeSchedule (passdata);
+    }
+#endif /* HAVE_XSYNC */
     else if ((event->meta.xevent->type == UnmapNotify) && (event->meta.window == c->window))
     {
         resizing = FALSE;
@@ -1733,6 +2053,10 @@ clientResize (Client * c, int handle, XfwmEventButton *event)
     passdata.button = AnyButton;
     passdata.handle = handle;
     passdata.wireframe = NULL;
+    passdata.configure_pending = FALSE;
+    passdata.configure_timeout_id = 0;
+    passdata.last_configure = 0;
+    passdata.frame_interval = G_USEC_PER_SEC / MAX (xfwm_get_primary_refresh_rate (screen_info->gscr), 1);
     w_orig = c->width;
     h_orig = c->height;
 
@@ -1772,6 +2096,7 @@ clientResize (Client * c, int handle, XfwmEventButton *event)
         return;
     }
 
+    xAccountBegin (display_info, "resize");
     if (screen_info->params->box_resize && compositorIsActive (screen_info))
     {
         passdata.wireframe = wireframeCreate (c);
@@ -1805,6 +2130,8 @@ clientResize (Client * c, int handle, XfwmEventButton *event)
     gtk_main ();
     eventFilterPop (display_info->xfilter);
     TRACE ("leaving resize loop");
+    /* The final size is applied below anyway */
+    clientCancelPendingConfigure (&passdata);
     if (passdata.client_gone)
     {
         goto resize_cleanup;
@@ -1864,4 +2191,5 @@ resize_cleanup:
     {
         myDisplayUngrabServer (display_info);
     }
+    xAccountEnd (display_info);
 }
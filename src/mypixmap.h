@@ -28,6 +28,7 @@
 #include <glib.h>
 #include <cairo/cairo.h>
 #include "screen.h"
+#include "xpmload.h"
 
 #ifdef HAVE_RENDER
 #include <X11/extensions/Xrender.h>
@@ -38,12 +39,8 @@
 
 #define MYPIXMAP_XPIXMAP(p) (p.pixmap)
 
-typedef struct
-{
-    gchar *name;
-    const gchar *value;
-}
-xfwmColorSymbol;
+typedef struct _ThemeCache ThemeCache;
+typedef struct _xfwmPixmapLoader xfwmPixmapLoader;
 
 struct _xfwmPixmap
 {
@@ -58,11 +55,15 @@ struct _xfwmPixmap
 
 gboolean                 xfwmPixmapRenderGdkPixbuf              (xfwmPixmap *,
                                                                  GdkPixbuf *);
-gboolean                 xfwmPixmapLoad                         (ScreenInfo *,
-                                                                 xfwmPixmap *,
-                                                                 const gchar *,
+xfwmPixmapLoader        *xfwmPixmapLoaderNew                    (ScreenInfo *,
                                                                  const gchar *,
-                                                                 xfwmColorSymbol *);
+                                                                 xfwmColorSymbol *,
+                                                                 gint,
+                                                                 ThemeCache *);
+void                     xfwmPixmapLoaderAdd                    (xfwmPixmapLoader *,
+                                                                 xfwmPixmap *,
+                                                                 const gchar *);
+void                     xfwmPixmapLoaderFinish                 (xfwmPixmapLoader *);
 void                     xfwmPixmapCreate                       (ScreenInfo *,
                                                                  xfwmPixmap *,
                                                                  gint,
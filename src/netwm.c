@@ -31,6 +31,7 @@
 #include <gdk/gdk.h>
 #include <gdk/gdkx.h>
 #include <gtk/gtk.h>
+#include <string.h>
 #include <libxfce4util/libxfce4util.h>
 
 #include <common/xfwm-common.h>
@@ -44,6 +45,7 @@
 #include "hints.h"
 #include "misc.h"
 #include "netwm.h"
+#include "placement.h"
 #include "screen.h"
 #include "stacking.h"
 #include "terminate.h"
@@ -137,6 +139,15 @@ clientSetNetState (Client * c)
         data[i++] = display_info->atoms[NET_WM_STATE_FOCUSED];
     }
 
+    /* Workspace switches and the like would set the very same state */
+    if ((c->net_wm_state_len == i) &&
+        (memcmp (c->net_wm_state, data, i * sizeof (Atom)) == 0))
+    {
+        return;
+    }
+    memcpy (c->net_wm_state, data, i * sizeof (Atom));
+    c->net_wm_state_len = i;
+
     myDisplayErrorTrapPush (display_info);
     XChangeProperty (display_info->dpy, c->window,
                      display_info->atoms[NET_WM_STATE], XA_ATOM, 32,
@@ -1048,6 +1059,9 @@ clientGetNetStruts (Client * c)
     display_info = screen_info->display_info;
     struts = NULL;
 
+    /* Whatever the outcome, the cached work areas cannot be trusted anymore */
+    placementInvalidateWorkArea (screen_info);
+
     /* Save old values */
     old_flags = c->flags & (CLIENT_FLAG_HAS_STRUT | CLIENT_FLAG_HAS_STRUT_PARTIAL);
     memcpy (&old_struts, c->struts, sizeof (old_struts));
@@ -1194,6 +1208,14 @@ clientSetNetActions (Client * c)
         atoms[i++] = display_info->atoms[NET_WM_ACTION_STICK];
     }
 
+    if ((c->net_wm_actions_len == i) &&
+        (memcmp (c->net_wm_actions, atoms, i * sizeof (Atom)) == 0))
+    {
+        return;
+    }
+    memcpy (c->net_wm_actions, atoms, i * sizeof (Atom));
+    c->net_wm_actions_len = i;
+
     myDisplayErrorTrapPush (display_info);
     XChangeProperty (clientGetXDisplay (c), c->window, display_info->atoms[NET_WM_ALLOWED_ACTIONS],
                      XA_ATOM, 32, PropModeReplace, (unsigned char *) atoms, i);
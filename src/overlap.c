@@ -0,0 +1,221 @@
+/*      $Id$
+
+        This program is free software; you can redistribute it and/or modify
+        it under the terms of the GNU General Public License as published by
+        the Free Software Foundation; either version 2, or (at your option)
+        any later version.
+
+        This program is distributed in the hope that it will be useful,
+        but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+        GNU General Public License for more details.
+
+        You should have received a copy of the GNU General Public License
+        along with this program; if not, write to the Free Software
+        Foundation, Inc., Inc., 51 Franklin Street, Fifth Floor, Boston,
+        MA 02110-1301, USA.
+
+
+        xfwm4    - (c) 2002-2022 Olivier Fourdan
+
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdlib.h>
+
+#include <glib.h>
+#include <gdk/gdk.h>
+
+#include "overlap.h"
+
+/*
+ * Looks for the position of a width x height rectangle, with its top-left
+ * corner within the given range, with the least overlap with a set of
+ * rectangles. The best position is always on one of the candidate edges,
+ * i.e. the ends of the range, or the rectangle sticking to the right/bottom
+ * or left/top edge of another one, brought back within the range.
+ *
+ * For a given row, the overlap as a function of x is piecewise linear,
+ * with slope changes only where an edge of the placed rectangle meets an
+ * edge of another one. So the overlap at every candidate x is computed in
+ * a single sweep over the sorted slope changes, which makes the whole
+ * search O(n² log n) instead of computing the overlap with every rectangle
+ * at every candidate position.
+ */
+
+typedef struct _OverlapEdge OverlapEdge;
+struct _OverlapEdge
+{
+    gint pos;
+    gint slope;
+};
+
+static inline gint
+segment_overlap (gint x0, gint x1, gint tx0, gint tx1)
+{
+    x0 = MAX (x0, tx0);
+    x1 = MIN (x1, tx1);
+
+    return MAX (0, x1 - x0);
+}
+
+static int
+compare_int (gconstpointer a, gconstpointer b)
+{
+    gint ia = *(const gint *) a;
+    gint ib = *(const gint *) b;
+
+    return (ia > ib) - (ia < ib);
+}
+
+static int
+compare_edge (gconstpointer a, gconstpointer b)
+{
+    return compare_int (&((const OverlapEdge *) a)->pos,
+                        &((const OverlapEdge *) b)->pos);
+}
+
+static guint
+overlapCandidates (gint *candidates, guint n_candidates, gint min, gint max)
+{
+    guint i, n;
+
+    /* Out of range edges are still worth trying as close as possible */
+    for (i = 0; i < n_candidates; i++)
+    {
+        candidates[i] = CLAMP (candidates[i], min, max);
+    }
+    qsort (candidates, n_candidates, sizeof (gint), compare_int);
+
+    n = 0;
+    for (i = 0; i < n_candidates; i++)
+    {
+        if ((n == 0) || (candidates[n - 1] != candidates[i]))
+        {
+            candidates[n++] = candidates[i];
+        }
+    }
+
+    return n;
+}
+
+guint64
+overlapFindLeast (const GdkRectangle *rects, guint n_rects, gint width, gint height,
+                  GdkRectangle *range, gint *best_x, gint *best_y)
+{
+    OverlapEdge *edges;
+    gint *xs, *ys;
+    guint64 best_overlaps, count_overlaps;
+    gint64 slope;
+    guint n_xs, n_ys, n_edges, i, j, k;
+    gint xmin, ymin, xmax, ymax;
+    gint test_x, test_y, prev_x, h;
+
+    g_return_val_if_fail (range != NULL, 0);
+    g_return_val_if_fail (best_x != NULL, 0);
+    g_return_val_if_fail (best_y != NULL, 0);
+
+    xmin = range->x;
+    ymin = range->y;
+    xmax = MAX (xmin, range->x + range->width);
+    ymax = MAX (ymin, range->y + range->height);
+
+    /* Candidate positions on each axis */
+    xs = g_new (gint, 2 * n_rects + 2);
+    ys = g_new (gint, 2 * n_rects + 2);
+    xs[0] = xmin;
+    xs[1] = xmax;
+    ys[0] = ymin;
+    ys[1] = ymax;
+    for (i = 0; i < n_rects; i++)
+    {
+        xs[2 * i + 2] = rects[i].x + rects[i].width;
+        xs[2 * i + 3] = rects[i].x - width;
+        ys[2 * i + 2] = rects[i].y + rects[i].height;
+        ys[2 * i + 3] = rects[i].y - height;
+    }
+    n_xs = overlapCandidates (xs, 2 * n_rects + 2, xmin, xmax);
+    n_ys = overlapCandidates (ys, 2 * n_rects + 2, ymin, ymax);
+
+    /* start with worst-case position at top-left */
+    best_overlaps = G_MAXUINT64;
+    *best_x = xmin;
+    *best_y = ymin;
+
+    edges = g_new (OverlapEdge, 4 * n_rects);
+    for (j = 0; j < n_ys; j++)
+    {
+        test_y = ys[j];
+
+        /* Slope changes of the overlap along x for this row */
+        n_edges = 0;
+        for (i = 0; i < n_rects; i++)
+        {
+            h = segment_overlap (test_y, test_y + height,
+                                 rects[i].y, rects[i].y + rects[i].height);
+            if (h == 0)
+            {
+                continue;
+            }
+            edges[n_edges].pos = rects[i].x - width;
+            edges[n_edges++].slope = h;
+            edges[n_edges].pos = rects[i].x;
+            edges[n_edges++].slope = -h;
+            edges[n_edges].pos = rects[i].x + rects[i].width - width;
+            edges[n_edges++].slope = -h;
+            edges[n_edges].pos = rects[i].x + rects[i].width;
+            edges[n_edges++].slope = h;
+        }
+        qsort (edges, n_edges, sizeof (OverlapEdge), compare_edge);
+
+        /* Sweep along x, accumulating the overlap between candidates */
+        count_overlaps = 0;
+        slope = 0;
+        prev_x = G_MININT;
+        k = 0;
+        for (i = 0; i < n_xs; i++)
+        {
+            test_x = xs[i];
+            while ((k < n_edges) && (edges[k].pos <= test_x))
+            {
+                if (prev_x != G_MININT)
+                {
+                    count_overlaps += slope * (edges[k].pos - prev_x);
+                }
+                prev_x = edges[k].pos;
+                slope += edges[k].slope;
+                k++;
+            }
+            if (prev_x != G_MININT)
+            {
+                count_overlaps += slope * (test_x - prev_x);
+            }
+            prev_x = test_x;
+
+            if (count_overlaps < best_overlaps)
+            {
+                /* found position with less overlap */
+                *best_x = test_x;
+                *best_y = test_y;
+                best_overlaps = count_overlaps;
+
+                if (count_overlaps == 0)
+                {
+                    /* overlap is ideal, stop searching */
+                    goto found_best;
+                }
+            }
+        }
+    }
+
+    found_best:
+
+    g_free (edges);
+    g_free (xs);
+    g_free (ys);
+
+    return best_overlaps;
+}
@@ -39,6 +39,8 @@
 #include "workspaces.h"
 #include "frame.h"
 #include "netwm.h"
+#include "spatial.h"
+#include "overlap.h"
 
 #define USE_CLIENT_STRUTS(c) (FLAG_TEST (c->xfwm_flags, XFWM_FLAG_VISIBLE) && \
                               FLAG_TEST (c->flags, CLIENT_FLAG_HAS_STRUT))
@@ -63,14 +65,6 @@ segment_overlap (int x0, int x1, int tx0, int tx1)
     return (x1 - x0);
 }
 
-static inline unsigned long
-overlap (int x0, int y0, int x1, int y1, int tx0, int ty0, int tx1, int ty1)
-{
-    /* Compute overlapping box */
-    return (segment_overlap (x0, x1, tx0, tx1)
-            * segment_overlap (y0, y1, ty0, ty1));
-}
-
 static void
 set_rectangle (GdkRectangle * rect, gint x, gint y, gint width, gint height)
 {
@@ -140,24 +134,110 @@ strutsToRectangles (Client *c,
     return TRUE;
 }
 
+/*
+ * The clients with struts and the monitors geometry are cached until the
+ * struts, the visibility of a client with struts or the monitors change,
+ * so that placing, maximizing, tiling and constraining windows do not
+ * need to go through all clients or query GDK each time. The work area of
+ * each monitor, that is the monitor minus the struts on it, is computed
+ * on first use and kept along. Struts of the current workspace only are
+ * visible, so a workspace switch rebuilds the cache with the rest.
+ */
+static void
+workAreaUpdate (ScreenInfo *screen_info)
+{
+    GdkRectangle monitor;
+    Client *c;
+    guint i;
+    gint num_monitors;
+
+    if (screen_info->workarea_valid)
+    {
+        return;
+    }
+
+    TRACE ("rebuilding work area cache");
+
+    g_list_free (screen_info->workarea_struts);
+    screen_info->workarea_struts = NULL;
+    for (c = screen_info->clients, i = 0; i < screen_info->client_count; c = c->next, i++)
+    {
+        if (USE_CLIENT_STRUTS (c))
+        {
+            screen_info->workarea_struts = g_list_prepend (screen_info->workarea_struts, c);
+        }
+    }
+    screen_info->workarea_struts = g_list_reverse (screen_info->workarea_struts);
+
+    if (screen_info->workarea_monitors == NULL)
+    {
+        screen_info->workarea_monitors = g_array_new (FALSE, TRUE, sizeof (GdkRectangle));
+    }
+    if (screen_info->workarea_areas == NULL)
+    {
+        screen_info->workarea_areas = g_array_new (FALSE, TRUE, sizeof (GdkRectangle));
+    }
+    g_array_set_size (screen_info->workarea_monitors, 0);
+    g_array_set_size (screen_info->workarea_areas, 0);
+    num_monitors = xfwm_get_n_monitors (screen_info->gscr);
+    for (i = 0; i < (guint) num_monitors; i++)
+    {
+        xfwm_get_monitor_geometry (screen_info->gscr, i, &monitor, TRUE);
+        g_array_append_val (screen_info->workarea_monitors, monitor);
+        /* Not computed yet */
+        monitor.width = -1;
+        g_array_append_val (screen_info->workarea_areas, monitor);
+    }
+
+    screen_info->workarea_valid = TRUE;
+}
+
+void
+placementInvalidateWorkArea (ScreenInfo *screen_info)
+{
+    g_return_if_fail (screen_info != NULL);
+
+    screen_info->workarea_valid = FALSE;
+}
+
+void
+placementFreeWorkArea (ScreenInfo *screen_info)
+{
+    g_return_if_fail (screen_info != NULL);
+
+    g_list_free (screen_info->workarea_struts);
+    screen_info->workarea_struts = NULL;
+    if (screen_info->workarea_monitors)
+    {
+        g_array_free (screen_info->workarea_monitors, TRUE);
+        screen_info->workarea_monitors = NULL;
+    }
+    if (screen_info->workarea_areas)
+    {
+        g_array_free (screen_info->workarea_areas, TRUE);
+        screen_info->workarea_areas = NULL;
+    }
+    screen_info->workarea_valid = FALSE;
+}
+
 static gboolean
 areasOnSameMonitor (ScreenInfo *screen_info,
                     GdkRectangle *area1,
                     GdkRectangle *area2)
 {
-    GdkRectangle monitor;
-    int num_monitors, i;
+    GdkRectangle *monitor;
+    guint i;
 
     g_return_val_if_fail (screen_info != NULL, FALSE);
     g_return_val_if_fail (area1 != NULL, FALSE);
     g_return_val_if_fail (area2 != NULL, FALSE);
 
-    num_monitors = xfwm_get_n_monitors (screen_info->gscr);
-    for (i = 0; i < num_monitors; i++)
+    workAreaUpdate (screen_info);
+    for (i = 0; i < screen_info->workarea_monitors->len; i++)
     {
-        xfwm_get_monitor_geometry (screen_info->gscr, i, &monitor, TRUE);
-        if (gdk_rectangle_intersect (area1, &monitor, NULL) &&
-            gdk_rectangle_intersect (area2, &monitor, NULL))
+        monitor = &g_array_index (screen_info->workarea_monitors, GdkRectangle, i);
+        if (gdk_rectangle_intersect (area1, monitor, NULL) &&
+            gdk_rectangle_intersect (area2, monitor, NULL))
         {
             return TRUE;
         }
@@ -269,21 +349,78 @@ applyClientStrutstoArea (Client *c, GdkRectangle *area)
     }
 }
 
+static gint
+workAreaFindMonitor (ScreenInfo *screen_info, GdkRectangle *area)
+{
+    GdkRectangle *monitor;
+    guint i;
+
+    for (i = 0; i < screen_info->workarea_monitors->len; i++)
+    {
+        monitor = &g_array_index (screen_info->workarea_monitors, GdkRectangle, i);
+        if ((monitor->x == area->x) && (monitor->y == area->y) &&
+            (monitor->width == area->width) && (monitor->height == area->height))
+        {
+            return (gint) i;
+        }
+    }
+
+    return -1;
+}
+
+static void
+workAreaGetMonitor (ScreenInfo *screen_info, gint monitor, GdkRectangle *area)
+{
+    GdkRectangle win, *geometry, *workarea;
+    GList *list;
+    Client *c;
+
+    workarea = &g_array_index (screen_info->workarea_areas, GdkRectangle, monitor);
+    if (workarea->width < 0)
+    {
+        geometry = &g_array_index (screen_info->workarea_monitors, GdkRectangle, monitor);
+        *workarea = *geometry;
+        for (list = screen_info->workarea_struts; list; list = g_list_next (list))
+        {
+            c = (Client *) list->data;
+            set_rectangle (&win,
+                           frameExtentX (c),
+                           frameExtentY (c),
+                           frameExtentWidth (c),
+                           frameExtentHeight (c));
+            if (gdk_rectangle_intersect (&win, geometry, NULL))
+            {
+                applyClientStrutstoArea (c, workarea);
+            }
+        }
+    }
+
+    *area = *workarea;
+}
+
 void
 geometryMaxSpace (ScreenInfo *screen_info, GdkRectangle *area)
 {
     GdkRectangle win;
+    GList *list;
     Client *c;
-    unsigned int i;
+    gint monitor;
 
     TRACE ("entering");
 
-    for (c = screen_info->clients, i = 0; i < screen_info->client_count; c = c->next, i++)
+    workAreaUpdate (screen_info);
+
+    /* The usual case, the whole monitor */
+    monitor = workAreaFindMonitor (screen_info, area);
+    if (monitor >= 0)
     {
-        if (!USE_CLIENT_STRUTS (c))
-        {
-            continue;
-        }
+        workAreaGetMonitor (screen_info, monitor, area);
+        return;
+    }
+
+    for (list = screen_info->workarea_struts; list; list = g_list_next (list))
+    {
+        c = (Client *) list->data;
 
         set_rectangle (&win,
                        frameExtentX (c),
@@ -305,12 +442,45 @@ geometryMaxSpace (ScreenInfo *screen_info, GdkRectangle *area)
     }
 }
 
+static gboolean
+clientOnlyOnMonitor (Client *c, gint monitor)
+{
+    GdkRectangle win, *area, *other;
+    guint i;
+
+    set_rectangle (&win,
+                   frameExtentX (c),
+                   frameExtentY (c),
+                   frameExtentWidth (c),
+                   frameExtentHeight (c));
+
+    area = &g_array_index (c->screen_info->workarea_monitors, GdkRectangle, monitor);
+    if (!gdk_rectangle_intersect (&win, area, NULL))
+    {
+        return FALSE;
+    }
+
+    for (i = 0; i < c->screen_info->workarea_monitors->len; i++)
+    {
+        other = &g_array_index (c->screen_info->workarea_monitors, GdkRectangle, i);
+        if (gdk_rectangle_intersect (&win, other, NULL) &&
+            ((other->x != area->x) || (other->y != area->y) ||
+             (other->width != area->width) || (other->height != area->height)))
+        {
+            return FALSE;
+        }
+    }
+
+    return TRUE;
+}
+
 void
 clientMaxSpace (Client *c, GdkRectangle *area)
 {
     ScreenInfo *screen_info;
+    GList *list;
     Client *c2;
-    guint i;
+    gint monitor;
 
     g_return_if_fail (c != NULL);
     g_return_if_fail (area != NULL);
@@ -318,13 +488,19 @@ clientMaxSpace (Client *c, GdkRectangle *area)
     TRACE ("client \"%s\" (0x%lx) %s", c->name, c->window);
 
     screen_info = c->screen_info;
+    workAreaUpdate (screen_info);
 
-    for (c2 = screen_info->clients, i = 0; i < screen_info->client_count; c2 = c2->next, i++)
+    /* The usual case, the whole monitor the client is on */
+    monitor = workAreaFindMonitor (screen_info, area);
+    if ((monitor >= 0) && clientOnlyOnMonitor (c, monitor))
     {
-        if (!USE_CLIENT_STRUTS (c2))
-        {
-            continue;
-        }
+        workAreaGetMonitor (screen_info, monitor, area);
+        return;
+    }
+
+    for (list = screen_info->workarea_struts; list; list = g_list_next (list))
+    {
+        c2 = (Client *) list->data;
 
         if (!clientsOnSameMonitor (c, c2))
         {
@@ -350,7 +526,7 @@ clientConstrainPos (Client * c, gboolean show_full)
 {
     Client *c2;
     ScreenInfo *screen_info;
-    guint i;
+    GList *list;
     gint cx, cy;
     gint frame_top, frame_left;
     gint title_visible;
@@ -365,6 +541,7 @@ clientConstrainPos (Client * c, gboolean show_full)
         show_full ? "(with show full)" : "(w/out show full)");
 
     screen_info = c->screen_info;
+    workAreaUpdate (screen_info);
 
     /* We use a bunch of local vars to reduce the overhead of calling other functions all the time */
     frame_top = frameExtentTop (c);
@@ -395,8 +572,9 @@ clientConstrainPos (Client * c, gboolean show_full)
     }
     if (show_full)
     {
-        for (c2 = screen_info->clients, i = 0; i < screen_info->client_count; c2 = c2->next, i++)
+        for (list = screen_info->workarea_struts; list; list = g_list_next (list))
         {
+            c2 = (Client *) list->data;
             if ((c2 == c) || !strutsToRectangles (c2, &left, &right, &top, &bottom))
             {
                 continue;
@@ -449,8 +627,9 @@ clientConstrainPos (Client * c, gboolean show_full)
             ret |= CLIENT_CONSTRAINED_TOP;
         }
 
-        for (c2 = screen_info->clients, i = 0; i < screen_info->client_count; c2 = c2->next, i++)
+        for (list = screen_info->workarea_struts; list; list = g_list_next (list))
         {
+            c2 = (Client *) list->data;
             if ((c2 == c) || !strutsToRectangles (c2, &left, &right, &top, &bottom))
             {
                 continue;
@@ -512,8 +691,9 @@ clientConstrainPos (Client * c, gboolean show_full)
         }
 
         /* Struts and other partial struts */
-        for (c2 = screen_info->clients, i = 0; i < screen_info->client_count; c2 = c2->next, i++)
+        for (list = screen_info->workarea_struts; list; list = g_list_next (list))
         {
+            c2 = (Client *) list->data;
             if ((c2 == c) || !strutsToRectangles (c2, &left, &right, &top, &bottom))
             {
                 continue;
@@ -586,12 +766,17 @@ clientConstrainPos (Client * c, gboolean show_full)
 static void
 clientKeepVisible (Client * c, gint n_monitors, GdkRectangle *monitor_rect)
 {
+    ScreenInfo *screen_info;
+    GdkRectangle area, win;
     gboolean centered;
     int diff_x, diff_y;
+    gint monitor;
 
     g_return_if_fail (c != NULL);
     TRACE ("client \"%s\" (0x%lx)", c->name, c->window);
 
+    screen_info = c->screen_info;
+
     centered = FALSE;
     /* We only center dialogs */
     if (c->type & (WINDOW_TYPE_DIALOG))
@@ -618,6 +803,22 @@ clientKeepVisible (Client * c, gint n_monitors, GdkRectangle *monitor_rect)
         c->x = monitor_rect->x + (monitor_rect->width - c->width) / 2;
         c->y = monitor_rect->y + (monitor_rect->height - c->height) / 2;
     }
+
+    /* Within the cached work area of its monitor, there is nothing to constrain */
+    workAreaUpdate (screen_info);
+    area = *monitor_rect;
+    monitor = workAreaFindMonitor (screen_info, &area);
+    if (monitor >= 0)
+    {
+        workAreaGetMonitor (screen_info, monitor, &area);
+        set_rectangle (&win, frameExtentX (c), frameExtentY (c), frameExtentWidth (c), frameExtentHeight (c));
+        if ((win.x >= area.x) && (win.y >= area.y) &&
+            (win.x + win.width <= area.x + area.width) &&
+            (win.y + win.height <= area.y + area.height))
+        {
+            return;
+        }
+    }
     clientConstrainPos (c, TRUE);
 }
 
@@ -651,12 +852,12 @@ smartPlacement (Client * c, int full_x, int full_y, int full_w, int full_h)
 {
     Client *c2;
     ScreenInfo *screen_info;
-    gfloat best_overlaps;
-    guint i;
-    gint test_x, test_y, xmax, ymax, best_x, best_y;
-    gint frame_height, frame_width, frame_left, frame_top;
-    gint c2_x, c2_y;
-    gint xmin, ymin;
+    GdkRectangle area, range;
+    GdkRectangle *rects;
+    GList *candidates, *list;
+    guint n_rects;
+    gint best_x, best_y;
+    gint frame_height, frame_width;
 
     g_return_if_fail (c != NULL);
 
@@ -665,168 +866,48 @@ smartPlacement (Client * c, int full_x, int full_y, int full_w, int full_h)
     screen_info = c->screen_info;
     frame_height = frameExtentHeight (c);
     frame_width = frameExtentWidth (c);
-    frame_left = frameExtentLeft(c);
-    frame_top = frameExtentTop (c);
 
-    /* max coordinates (bottom-right) */
-    xmax = full_x + full_w - c->width - frameExtentRight (c);
-    ymax = full_y + full_h - c->height - frameExtentBottom (c);
+    /* Range of the frame top-left corner, always at least one position */
+    range.x = full_x;
+    range.y = full_y;
+    range.width = MAX (0, full_w - frame_width);
+    range.height = MAX (0, full_h - frame_height);
 
-    /* min coordinates (top-left) */
-    xmin = full_x + frameExtentLeft (c);
-    ymin = full_y + frameExtentTop (c);
+    /* Only the clients on the monitor can possibly overlap */
+    area.x = full_x;
+    area.y = full_y;
+    area.width = full_w;
+    area.height = full_h;
+    candidates = spatialIndexQueryRect (screen_info, &area);
 
-    /* start with worst-case position at top-left */
-    best_overlaps = G_MAXFLOAT;
-    best_x = xmin;
-    best_y = ymin;
+    TRACE ("analyzing %i clients", g_list_length (candidates));
 
-    TRACE ("analyzing %i clients", screen_info->client_count);
-
-    test_y = ymin;
-    do
+    n_rects = 0;
+    rects = g_new (GdkRectangle, g_list_length (candidates));
+    for (list = candidates; list; list = g_list_next (list))
     {
-        gint next_test_y = G_MAXINT;
-        gboolean first_test_x = TRUE;
-
-        TRACE ("testing y position %d", test_y);
-
-        test_x = xmin;
-        do
-        {
-            gfloat count_overlaps = 0.0;
-            gint next_test_x = G_MAXINT;
-            gint c2_next_test_x;
-            gint c2_next_test_y;
-            gint c2_frame_height;
-            gint c2_frame_width;
-
-            TRACE ("testing x position %d", test_x);
-
-            for (c2 = screen_info->clients, i = 0; i < screen_info->client_count; c2 = c2->next, i++)
-            {
-                if ((c2 != c) && (c2->type != WINDOW_DESKTOP)
-                    && (c->win_workspace == c2->win_workspace)
-                    && FLAG_TEST (c2->xfwm_flags, XFWM_FLAG_VISIBLE))
-                {
-                    c2_x = frameExtentX (c2);
-                    c2_frame_width = frameExtentWidth (c2);
-                    if (c2_x >= full_x + full_w
-                        || c2_x + c2_frame_width < full_x)
-                    {
-                        /* skip clients on right-of or left-of monitor */
-                        continue;
-                    }
-
-                    c2_y = frameExtentY (c2);
-                    c2_frame_height = frameExtentHeight (c2);
-                    if (c2_y >= full_y + full_h
-                        || c2_y + c2_frame_height < full_y)
-                    {
-                        /* skip clients on above-of or below-of monitor */
-                        continue;
-                    }
-
-                    count_overlaps += overlap (test_x - frame_left,
-                                               test_y - frame_top,
-                                               test_x - frame_left + frame_width,
-                                               test_y - frame_top + frame_height,
-                                               c2_x,
-                                               c2_y,
-                                               c2_x + c2_frame_width,
-                                               c2_y + c2_frame_height);
-
-                    /* find the next x boundy for the step */
-                    if (test_x > c2_x)
-                    {
-                        /* test location is beyond the x of the window,
-                         * take the window right corner as next target */
-                        c2_x += c2_frame_width;
-                    }
-                    c2_next_test_x = MIN (c2_x, xmax);
-                    if (c2_next_test_x < next_test_x
-                        && c2_next_test_x > test_x)
-                    {
-                        /* set new optimal next x step position */
-                        next_test_x = c2_next_test_x;
-                    }
-
-                    if (first_test_x)
-                    {
-                        /* find the next y boundry step */
-                        if (test_y > c2_y)
-                        {
-                            /* test location is beyond the y of the window,
-                             * take the window bottom corner as next target */
-                            c2_y += c2_frame_height;
-                        }
-                        c2_next_test_y = MIN (c2_y, ymax);
-                        if (c2_next_test_y < next_test_y
-                            && c2_next_test_y > test_y)
-                        {
-                            /* set new optimal next y step position */
-                            next_test_y = c2_next_test_y;
-                        }
-                    }
-                }
-            }
-
-            /* don't look for the next y boundry this x row */
-            first_test_x = FALSE;
-
-            if (count_overlaps < best_overlaps)
-            {
-                /* found position with less overlap */
-                best_x = test_x;
-                best_y = test_y;
-                best_overlaps = count_overlaps;
-
-                if (count_overlaps == 0.0f)
-                {
-                    /* overlap is ideal, stop searching */
-                    TRACE ("found position without overlap");
-                    goto found_best;
-                }
-            }
-
-            if (G_LIKELY (next_test_x != G_MAXINT))
-            {
-                test_x = MAX (next_test_x, next_test_x + frameExtentLeft (c));
-                if (test_x > xmax)
-                {
-                   /* always clamp on the monitor */
-                   test_x = xmax;
-                }
-            }
-            else
-            {
-                test_x++;
-            }
-        }
-        while (test_x <= xmax);
-
-        if (G_LIKELY (next_test_y != G_MAXINT))
+        c2 = (Client *) list->data;
+        if ((c2 != c) && (c2->type != WINDOW_DESKTOP)
+            && (c->win_workspace == c2->win_workspace)
+            && FLAG_TEST (c2->xfwm_flags, XFWM_FLAG_VISIBLE))
         {
-            test_y = MAX (next_test_y, next_test_y + frameExtentTop (c));
-            if (test_y > ymax)
+            set_rectangle (&rects[n_rects],
+                           frameExtentX (c2), frameExtentY (c2),
+                           frameExtentWidth (c2), frameExtentHeight (c2));
+            if (gdk_rectangle_intersect (&rects[n_rects], &area, NULL))
             {
-                /* always clamp on the monitor */
-                test_y = ymax;
+                n_rects++;
             }
         }
-        else
-        {
-            test_y++;
-        }
     }
-    while (test_y <= ymax);
-
-    found_best:
+    g_list_free (candidates);
 
-    TRACE ("overlaps %f at %d,%d (x,y)", best_overlaps, best_x, best_y);
+    overlapFindLeast (rects, n_rects, frame_width, frame_height, &range, &best_x, &best_y);
+    g_free (rects);
+    TRACE ("least overlap at %d,%d (x,y)", best_x, best_y);
 
-    c->x = best_x;
-    c->y = best_y;
+    c->x = best_x + frameExtentLeft (c);
+    c->y = best_y + frameExtentTop (c);
 }
 
 static void
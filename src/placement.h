@@ -54,5 +54,7 @@ unsigned int             clientConstrainPos                     (Client *,
 void                     clientInitPosition                     (Client *);
 void                     clientFill                             (Client *,
                                                                  int);
+void                     placementInvalidateWorkArea            (ScreenInfo *);
+void                     placementFreeWorkArea                  (ScreenInfo *);
 
 #endif /* INC_PLACEMENT_H */
@@ -51,12 +51,22 @@
 #include "misc.h"
 #include "mywindow.h"
 #include "compositor.h"
+#include "placement.h"
 #include "ui_style.h"
+#include "spatial.h"
 
 #ifndef WM_EXITING_TIMEOUT
 #define WM_EXITING_TIMEOUT 15 /*seconds */
 #endif
 
+#ifndef MONITOR_SCALE_DPI
+#define MONITOR_SCALE_DPI 96
+#endif
+
+#ifndef MONITOR_MIN_SIZE_MM
+#define MONITOR_MIN_SIZE_MM 100
+#endif
+
 gboolean
 myScreenCheckWMAtom (ScreenInfo *screen_info, Atom atom)
 {
@@ -167,7 +177,7 @@ myScreenInit (DisplayInfo *display_info, GdkScreen *gscr, unsigned long event_ma
     GdkWindow *event_win;
     PangoLayout *layout;
     long desktop_visible;
-    int i, j;
+    int i, j, k;
 
     g_return_val_if_fail (display_info, NULL);
     
@@ -208,6 +218,8 @@ myScreenInit (DisplayInfo *display_info, GdkScreen *gscr, unsigned long event_ma
     screen_info->depth = DefaultDepth (display_info->dpy, screen_info->screen);
     screen_info->visual = DefaultVisual (display_info->dpy, screen_info->screen);
     screen_info->shape_win = (Window) None;
+    screen_info->frame_parts = NULL;
+    screen_info->frame_shapes = NULL;
     myScreenComputeSize (screen_info);
 
     if (!xfwmIsWaylandCompositor ())
@@ -245,6 +257,8 @@ myScreenInit (DisplayInfo *display_info, GdkScreen *gscr, unsigned long event_ma
     screen_info->workspace_names_items = 0;
 
     screen_info->windows_stack = NULL;
+    screen_info->stack_cache = NULL;
+    screen_info->stack_cache_size = 0;
     screen_info->last_raise = NULL;
     screen_info->windows = NULL;
     screen_info->clients = NULL;
@@ -303,35 +317,44 @@ myScreenInit (DisplayInfo *display_info, GdkScreen *gscr, unsigned long event_ma
                     TRUE);
 
     screen_info->font_desc = NULL;
-    screen_info->pango_attr_list = NULL;
     screen_info->box_gc = None;
 
-    for (i = 0; i < SIDE_COUNT; i++)
+    for (k = 0; k < THEME_SCALE_MAX; k++)
     {
-        xfwmPixmapInit (screen_info, &screen_info->sides[i][ACTIVE]);
-        xfwmPixmapInit (screen_info, &screen_info->sides[i][INACTIVE]);
-    }
-    for (i = 0; i < CORNER_COUNT; i++)
-    {
-        xfwmPixmapInit (screen_info, &screen_info->corners[i][ACTIVE]);
-        xfwmPixmapInit (screen_info, &screen_info->corners[i][INACTIVE]);
-    }
-    for (i = 0; i < BUTTON_COUNT; i++)
-    {
-        for (j = 0; j < STATE_COUNT; j++)
+        ThemeParts *theme = &screen_info->theme_parts[k];
+
+        theme->scale = k + 1;
+        theme->pango_attr_list = NULL;
+        for (i = 0; i < SIDE_COUNT; i++)
         {
-            xfwmPixmapInit (screen_info, &screen_info->buttons[i][j]);
+            xfwmPixmapInit (screen_info, &theme->sides[i][ACTIVE]);
+            xfwmPixmapInit (screen_info, &theme->sides[i][INACTIVE]);
+        }
+        for (i = 0; i < CORNER_COUNT; i++)
+        {
+            xfwmPixmapInit (screen_info, &theme->corners[i][ACTIVE]);
+            xfwmPixmapInit (screen_info, &theme->corners[i][INACTIVE]);
+        }
+        for (i = 0; i < BUTTON_COUNT; i++)
+        {
+            for (j = 0; j < STATE_COUNT; j++)
+            {
+                xfwmPixmapInit (screen_info, &theme->buttons[i][j]);
+            }
+        }
+        for (i = 0; i < TITLE_COUNT; i++)
+        {
+            xfwmPixmapInit (screen_info, &theme->title[i][ACTIVE]);
+            xfwmPixmapInit (screen_info, &theme->title[i][INACTIVE]);
+            xfwmPixmapInit (screen_info, &theme->top[i][ACTIVE]);
+            xfwmPixmapInit (screen_info, &theme->top[i][INACTIVE]);
         }
     }
-    for (i = 0; i < TITLE_COUNT; i++)
-    {
-        xfwmPixmapInit (screen_info, &screen_info->title[i][ACTIVE]);
-        xfwmPixmapInit (screen_info, &screen_info->title[i][INACTIVE]);
-        xfwmPixmapInit (screen_info, &screen_info->top[i][ACTIVE]);
-        xfwmPixmapInit (screen_info, &screen_info->top[i][INACTIVE]);
-    }
+    screen_info->theme_scales = 0;
+    screen_info->default_scale = 1;
 
     screen_info->monitors_index = NULL;
+    screen_info->monitors_scale = NULL;
     myScreenInvalidateMonitorCache (screen_info);
     myScreenRebuildMonitorIndex (screen_info);
     }
@@ -343,12 +366,24 @@ ScreenInfo *
 myScreenClose (ScreenInfo *screen_info)
 {
     DisplayInfo *display_info;
+    int i;
 
     g_return_val_if_fail (screen_info, NULL);
     TRACE ("entering");
 
     display_info = screen_info->display_info;
 
+    if (screen_info->workspace_switch_id)
+    {
+        g_source_remove (screen_info->workspace_switch_id);
+        screen_info->workspace_switch_id = 0;
+    }
+    if (screen_info->workspace_switch_timeout_id)
+    {
+        g_source_remove (screen_info->workspace_switch_timeout_id);
+        screen_info->workspace_switch_timeout_id = 0;
+    }
+
     clientUnframeAll (screen_info);
     compositorUnmanageScreen (screen_info);
     closeSettings (screen_info);
@@ -381,6 +416,13 @@ myScreenClose (ScreenInfo *screen_info)
     g_list_free (screen_info->windows_stack);
     screen_info->windows_stack = NULL;
 
+    spatialIndexFree (screen_info);
+    placementFreeWorkArea (screen_info);
+
+    g_free (screen_info->stack_cache);
+    screen_info->stack_cache = NULL;
+    screen_info->stack_cache_size = 0;
+
     g_list_free (screen_info->windows);
     screen_info->windows = NULL;
 
@@ -390,9 +432,15 @@ myScreenClose (ScreenInfo *screen_info)
         screen_info->monitors_index = NULL;
     }
 
-    if (screen_info->pango_attr_list)
+    if (screen_info->monitors_scale)
+    {
+        g_array_free (screen_info->monitors_scale, TRUE);
+        screen_info->monitors_scale = NULL;
+    }
+
+    for (i = 0; i < THEME_SCALE_MAX; i++)
     {
-        pango_attr_list_unref (screen_info->pango_attr_list);
+        g_clear_pointer (&screen_info->theme_parts[i].pango_attr_list, pango_attr_list_unref);
     }
 
     return (screen_info);
@@ -673,6 +721,11 @@ myScreenComputeSize (ScreenInfo *screen_info)
     screen_info->height = height;
     TRACE ("width=%i, height=%i", width, height);
 
+    if (changed)
+    {
+        spatialIndexResize (screen_info);
+    }
+
     return changed;
 }
 
@@ -760,9 +813,137 @@ myScreenRebuildMonitorIndex (ScreenInfo *screen_info)
     TRACE ("physical monitor reported.: %i", num_monitors);
     TRACE ("logical views found.......: %i", screen_info->num_monitors);
 
+    myScreenUpdateMonitorScales (screen_info);
+
     return (screen_info->num_monitors != previous_num_monitors);
 }
 
+/*
+   The scale of a monitor follows its resolution, taken from the physical
+   size reported by RandR for the output, or from the Xft resolution when
+   the size is unknown. It is never less than the scale GDK uses.
+ */
+static gint
+myScreenComputeMonitorScale (ScreenInfo *screen_info, gint monitor_num)
+{
+    GdkDisplay *display;
+    GdkMonitor *monitor;
+    GdkRectangle geometry;
+    GValue value = G_VALUE_INIT;
+    gint scale, dpi, width_mm, height_mm;
+
+    display = gdk_screen_get_display (screen_info->gscr);
+    monitor = gdk_display_get_monitor (display, monitor_num);
+    if (monitor == NULL)
+    {
+        return 1;
+    }
+
+    scale = MAX (gdk_monitor_get_scale_factor (monitor), 1);
+    width_mm = gdk_monitor_get_width_mm (monitor);
+    height_mm = gdk_monitor_get_height_mm (monitor);
+    dpi = 0;
+
+    /* Some outputs report no size, or their aspect ratio as size */
+    if ((width_mm >= MONITOR_MIN_SIZE_MM) && (height_mm > 0) &&
+        !((width_mm == 160) && ((height_mm == 90) || (height_mm == 100))))
+    {
+        xfwm_get_monitor_geometry (screen_info->gscr, monitor_num, &geometry, TRUE);
+        dpi = (gint) (geometry.width * 25.4 / width_mm + 0.5);
+    }
+    else
+    {
+        g_value_init (&value, G_TYPE_INT);
+        if (gdk_screen_get_setting (screen_info->gscr, "gtk-xft-dpi", &value))
+        {
+            /* In 1024th of dots per inch, GDK divides it by its own scale */
+            if (g_value_get_int (&value) > 0)
+            {
+                dpi = g_value_get_int (&value) * scale / 1024;
+            }
+        }
+        g_value_unset (&value);
+    }
+    TRACE ("monitor %i: %ix%i mm, %i dpi", monitor_num, width_mm, height_mm, dpi);
+
+    scale = MAX (scale, (dpi + MONITOR_SCALE_DPI / 4) / MONITOR_SCALE_DPI);
+
+    return CLAMP (scale, 1, THEME_SCALE_MAX);
+}
+
+void
+myScreenUpdateMonitorScales (ScreenInfo *screen_info)
+{
+    gint i, scale;
+
+    g_return_if_fail (screen_info != NULL);
+    g_return_if_fail (screen_info->monitors_index != NULL);
+
+    if (screen_info->monitors_scale)
+    {
+        g_array_free (screen_info->monitors_scale, TRUE);
+    }
+    screen_info->monitors_scale = g_array_new (FALSE, TRUE, sizeof (gint));
+
+    for (i = 0; i < (gint) screen_info->monitors_index->len; i++)
+    {
+        scale = myScreenComputeMonitorScale (screen_info, myScreenGetMonitorIndex (screen_info, i));
+        g_array_append_val (screen_info->monitors_scale, scale);
+    }
+
+    /* The cached monitor has its scale cached as well */
+    myScreenInvalidateMonitorCache (screen_info);
+}
+
+/* Mask of the scales of the monitors, bit 0 for scale 1 */
+guint
+myScreenGetMonitorScales (ScreenInfo *screen_info)
+{
+    guint scales;
+    gint i;
+
+    g_return_val_if_fail (screen_info != NULL, 1);
+    g_return_val_if_fail (screen_info->monitors_scale != NULL, 1);
+
+    scales = 0;
+    for (i = 0; i < (gint) screen_info->monitors_scale->len; i++)
+    {
+        scales |= 1 << (g_array_index (screen_info->monitors_scale, gint, i) - 1);
+    }
+
+    return (scales ? scales : 1);
+}
+
+gint
+myScreenGetScaleAtPoint (ScreenInfo *screen_info, gint x, gint y)
+{
+    GdkRectangle rect;
+
+    g_return_val_if_fail (screen_info != NULL, 1);
+
+    myScreenFindMonitorAtPoint (screen_info, x, y, &rect);
+
+    return screen_info->cache_scale;
+}
+
+/*
+   The set of theme parts at the given scale, or the default set if none
+   was loaded at that scale
+ */
+ThemeParts *
+myScreenGetThemeParts (ScreenInfo *screen_info, gint scale)
+{
+    g_return_val_if_fail (screen_info != NULL, NULL);
+
+    if ((scale >= 1) && (scale <= THEME_SCALE_MAX) &&
+        (screen_info->theme_scales & (1 << (scale - 1))))
+    {
+        return &screen_info->theme_parts[scale - 1];
+    }
+
+    return &screen_info->theme_parts[screen_info->default_scale - 1];
+}
+
 void
 myScreenInvalidateMonitorCache (ScreenInfo *screen_info)
 {
@@ -773,6 +954,9 @@ myScreenInvalidateMonitorCache (ScreenInfo *screen_info)
     screen_info->cache_monitor.y = -1;
     screen_info->cache_monitor.width = 0;
     screen_info->cache_monitor.height = 0;
+    screen_info->cache_scale = 1;
+
+    placementInvalidateWorkArea (screen_info);
 }
 
 /*
@@ -783,6 +967,7 @@ void
 myScreenFindMonitorAtPoint (ScreenInfo *screen_info, gint x, gint y, GdkRectangle *rect)
 {
     gint dx, dy, center_x, center_y, num_monitors, i;
+    gint nearest_scale = 1;
     guint32 distsquare, min_distsquare;
     GdkRectangle monitor, nearest_monitor = { G_MAXINT, G_MAXINT, 0, 0 };
 
@@ -813,6 +998,7 @@ myScreenFindMonitorAtPoint (ScreenInfo *screen_info, gint x, gint y, GdkRectangl
             (y >= monitor.y) && (y < (monitor.y + monitor.height)))
         {
             screen_info->cache_monitor = monitor;
+            screen_info->cache_scale = g_array_index (screen_info->monitors_scale, gint, i);
             *rect = screen_info->cache_monitor;
             return;
         }
@@ -829,10 +1015,12 @@ myScreenFindMonitorAtPoint (ScreenInfo *screen_info, gint x, gint y, GdkRectangl
         {
             min_distsquare = distsquare;
             nearest_monitor = monitor;
+            nearest_scale = g_array_index (screen_info->monitors_scale, gint, i);
         }
     }
 
     screen_info->cache_monitor = nearest_monitor;
+    screen_info->cache_scale = nearest_scale;
     *rect = screen_info->cache_monitor;
 }
 
@@ -890,15 +1078,22 @@ myScreenUpdateFontAttr (ScreenInfo *screen_info)
 {
     PangoAttribute *attr;
     GtkWidget *widget;
-    gint scale;
-
-    g_clear_pointer (&screen_info->pango_attr_list, pango_attr_list_unref);
+    gint scale, i;
 
     widget = myScreenGetGtkWidget (screen_info);
     scale = gtk_widget_get_scale_factor (widget);
-    screen_info->pango_attr_list = pango_attr_list_new ();
-    attr = pango_attr_scale_new (scale);
-    pango_attr_list_insert (screen_info->pango_attr_list, attr);
+    for (i = 0; i < THEME_SCALE_MAX; i++)
+    {
+        ThemeParts *theme = &screen_info->theme_parts[i];
+
+        g_clear_pointer (&theme->pango_attr_list, pango_attr_list_unref);
+        theme->pango_attr_list = pango_attr_list_new ();
+        attr = pango_attr_scale_new (MAX (scale, theme->scale));
+        pango_attr_list_insert (theme->pango_attr_list, attr);
+    }
+
+    /* Titles rendered so far are stale */
+    screen_info->title_cache_serial++;
 }
 
 gboolean
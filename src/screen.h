@@ -87,6 +87,36 @@ typedef enum
     VBLANK_ERROR,
 } vblankMode;
 
+#ifndef THEME_SCALE_MAX
+#define THEME_SCALE_MAX 4
+#endif
+
+/*
+ * The theme parts and metrics loaded at one scale factor. A screen keeps
+ * one set per scale in use by its monitors, and each frame uses the set
+ * of the monitor it is on, see clientUpdateTheme().
+ */
+struct _ThemeParts
+{
+    gint scale;
+    xfwmPixmap buttons[BUTTON_COUNT][STATE_COUNT];
+    xfwmPixmap corners[CORNER_COUNT][2];
+    xfwmPixmap sides[SIDE_COUNT][2];
+    xfwmPixmap title[TITLE_COUNT][2];
+    xfwmPixmap top[TITLE_COUNT][2];
+    /* Title text attributes, the text follows the scale of the parts */
+    PangoAttrList *pango_attr_list;
+
+    /* themerc metrics, in pixels at this scale */
+    int button_offset;
+    int button_spacing;
+    int frame_border_top;
+    int maximized_offset;
+    int title_horizontal_offset;
+    int title_vertical_offset_active;
+    int title_vertical_offset_inactive;
+};
+
 struct _ScreenInfo
 {
     /* The display this screen belongs to */
@@ -95,6 +125,8 @@ struct _ScreenInfo
     /* Window stacking, per screen */
     GList *windows_stack;
     Client *last_raise;
+    Window *stack_cache;
+    guint stack_cache_size;
     GList *windows;
     Client *clients;
     guint client_count;
@@ -105,18 +137,22 @@ struct _ScreenInfo
     /* Theme pixmaps and other params, per screen */
     GdkRGBA title_colors[2];
     GdkRGBA title_shadow_colors[2];
-    xfwmPixmap buttons[BUTTON_COUNT][STATE_COUNT];
-    xfwmPixmap corners[CORNER_COUNT][2];
-    xfwmPixmap sides[SIDE_COUNT][2];
-    xfwmPixmap title[TITLE_COUNT][2];
-    xfwmPixmap top[TITLE_COUNT][2];
+    ThemeParts theme_parts[THEME_SCALE_MAX];
+    /* Mask of the scales loaded, bit 0 for scale 1 */
+    guint theme_scales;
+    /* Scale used where no frame is involved, that of the primary monitor */
+    gint default_scale;
+    /* Theme parts tiled at the size of frames, shared by all clients */
+    GHashTable *frame_parts;
+    /* Frame bounding shapes, shared by all clients */
+    GHashTable *frame_shapes;
 
     /* Per screen graphic contexts */
     GC box_gc;
 
     /* Title font */
     PangoFontDescription *font_desc;
-    PangoAttrList *pango_attr_list;
+    guint title_cache_serial;
 
     /* Screen data */
     Colormap cmap;
@@ -138,11 +174,29 @@ struct _ScreenInfo
     gint screen;
     guint current_ws;
     guint previous_ws;
+    guint workspace_switch_id;
+    guint workspace_switch_timeout_id;
+    gint64 workspace_switch_start;
+
+    /* Spatial index of the frames */
+    GList **spatial_cells;
+    gint spatial_cols;
+    gint spatial_rows;
+    guint spatial_stamp;
 
     /* Monitor search caching */
     GdkRectangle cache_monitor;
+    gint cache_scale;
     gint num_monitors;
     GArray *monitors_index;
+    /* Scale factor of each monitor of the index */
+    GArray *monitors_scale;
+
+    /* Work area caching, see placement.c */
+    gboolean workarea_valid;
+    GList *workarea_struts;
+    GArray *workarea_monitors;
+    GArray *workarea_areas;
 
     /* Workspace definitions */
     guint workspace_count;
@@ -208,6 +262,10 @@ struct _ScreenInfo
     XRectangle cursorLocation;
     gboolean cursor_is_zoomed;
 
+    XRectangle outline;
+    XRenderColor outline_color;
+    gboolean outline_visible;
+
     guint wins_unredirected;
     gboolean compositor_active;
     gboolean clipChanged;
@@ -215,6 +273,12 @@ struct _ScreenInfo
     gboolean damages_pending;
 
     guint compositor_timeout_id;
+    guint compositor_freeze;
+    gboolean frames_drawn_pending;
+    gboolean frames_timings_pending;
+
+    GQueue saved_pictures;
+    gsize saved_pictures_size;
 
     XTransform transform;
     gboolean zoomed;
@@ -300,6 +364,13 @@ void                     myScreenFindMonitorAtPoint             (ScreenInfo *,
                                                                  gint,
                                                                  gint,
                                                                  GdkRectangle *);
+void                     myScreenUpdateMonitorScales            (ScreenInfo *);
+guint                    myScreenGetMonitorScales               (ScreenInfo *);
+gint                     myScreenGetScaleAtPoint                (ScreenInfo *,
+                                                                 gint,
+                                                                 gint);
+ThemeParts *             myScreenGetThemeParts                  (ScreenInfo *,
+                                                                 gint);
 PangoFontDescription *   myScreenGetFontDescription             (ScreenInfo *);
 void                     myScreenUpdateFontAttr                 (ScreenInfo *);
 void                     myScreenGetXineramaMonitorGeometry     (ScreenInfo *,
@@ -35,6 +35,8 @@
 #include <xfconf/xfconf.h>
 #include <libxfce4kbd-private/xfce-shortcuts-provider.h>
 
+#include <common/xfwm-common.h>
+
 #include "screen.h"
 #include "hints.h"
 #include "parserc.h"
@@ -42,6 +44,8 @@
 #include "focus.h"
 #include "workspaces.h"
 #include "compositor.h"
+#include "frame.h"
+#include "themecache.h"
 #include "ui_style.h"
 
 #define CHANNEL_XFWM            "xfwm4"
@@ -277,6 +281,12 @@ getThemeName (ScreenInfo *screen_info, Settings *rc)
         return theme;
     }
 
+    /* The base theme is scaled on load, see getThemeScale() */
+    if (getBoolValue ("scale_decorations", rc))
+    {
+        return theme;
+    }
+
     if (strcmp (theme, DEFAULT_THEME))
     {
         return theme;
@@ -285,10 +295,45 @@ getThemeName (ScreenInfo *screen_info, Settings *rc)
     return DEFAULT_HDPI_THEME;
 }
 
-static void
-loadTheme (ScreenInfo *screen_info, Settings *rc)
+/* Mask of the scales to load the theme at, bit 0 for scale 1 */
+static guint
+getThemeScales (ScreenInfo *screen_info, Settings *rc)
+{
+    if (!getBoolValue ("scale_decorations", rc))
+    {
+        return 1;
+    }
+
+    return myScreenGetMonitorScales (screen_info);
+}
+
+/* Scale of the primary monitor, for what is not tied to a frame */
+static gint
+getThemeDefaultScale (ScreenInfo *screen_info, guint scales)
 {
+    GdkRectangle rect;
+    gint scale;
+
+    if (scales == 1)
+    {
+        return 1;
+    }
+
+    xfwm_get_primary_monitor_geometry (screen_info->gscr, &rect, TRUE);
+    scale = myScreenGetScaleAtPoint (screen_info, rect.x + rect.width / 2, rect.y + rect.height / 2);
+    if (scales & (1 << (scale - 1)))
+    {
+        return scale;
+    }
 
+    /* Lowest scale in use */
+    return g_bit_nth_lsf (scales, -1) + 1;
+}
+
+static void
+loadThemeParts (ScreenInfo *screen_info, Settings *rc, const gchar *theme,
+                xfwmColorSymbol *colsym, ThemeParts *parts)
+{
     static const char *side_names[] = {
         "left",
         "right",
@@ -323,6 +368,75 @@ loadTheme (ScreenInfo *screen_info, Settings *rc)
         "toggled-pressed"
     };
 
+    gchar imagename[30];
+    xfwmPixmapLoader *loader;
+    ThemeCache *cache;
+    gint scale;
+    guint i, j;
+
+    scale = parts->scale;
+    cache = themeCacheOpen (theme, colsym, scale);
+    loader = xfwmPixmapLoaderNew (screen_info, theme, colsym, scale, cache);
+    for (i = 0; i < SIDE_COUNT; i++)
+    {
+        if (i == SIDE_TOP)
+            continue;  /* There is no top decoration per se. */
+
+        g_snprintf(imagename, sizeof (imagename), "%s-active", side_names[i]);
+        xfwmPixmapLoaderAdd (loader, &parts->sides[i][ACTIVE], imagename);
+
+        g_snprintf(imagename, sizeof (imagename), "%s-inactive", side_names[i]);
+        xfwmPixmapLoaderAdd (loader, &parts->sides[i][INACTIVE], imagename);
+    }
+    for (i = 0; i < CORNER_COUNT; i++)
+    {
+        g_snprintf(imagename, sizeof (imagename), "%s-active", corner_names[i]);
+        xfwmPixmapLoaderAdd (loader, &parts->corners[i][ACTIVE], imagename);
+
+        g_snprintf(imagename, sizeof (imagename), "%s-inactive", corner_names[i]);
+        xfwmPixmapLoaderAdd (loader, &parts->corners[i][INACTIVE], imagename);
+    }
+    for (i = 0; i < BUTTON_COUNT; i++)
+    {
+        for (j = 0; j < STATE_COUNT; j++)
+        {
+            g_snprintf(imagename, sizeof (imagename), "%s-%s", button_names[i], button_state_names[j]);
+            xfwmPixmapLoaderAdd (loader, &parts->buttons[i][j], imagename);
+        }
+    }
+    for (i = 0; i < TITLE_COUNT; i++)
+    {
+        g_snprintf(imagename, sizeof (imagename), "title-%d-active", i + 1);
+        xfwmPixmapLoaderAdd (loader, &parts->title[i][ACTIVE], imagename);
+
+        g_snprintf(imagename, sizeof (imagename), "title-%d-inactive", i + 1);
+        xfwmPixmapLoaderAdd (loader, &parts->title[i][INACTIVE], imagename);
+
+        g_snprintf(imagename, sizeof (imagename), "top-%d-active", i + 1);
+        xfwmPixmapLoaderAdd (loader, &parts->top[i][ACTIVE], imagename);
+
+        g_snprintf(imagename, sizeof (imagename), "top-%d-inactive", i + 1);
+        xfwmPixmapLoaderAdd (loader, &parts->top[i][INACTIVE], imagename);
+    }
+    xfwmPixmapLoaderFinish (loader);
+    themeCacheClose (cache);
+
+    parts->button_spacing = getIntValue ("button_spacing", rc) * scale;
+    parts->button_offset = getIntValue ("button_offset", rc) * scale;
+    parts->frame_border_top = getIntValue ("frame_border_top", rc) * scale;
+    parts->maximized_offset = getIntValue ("maximized_offset", rc) * scale;
+    parts->title_vertical_offset_active =
+        getIntValue ("title_vertical_offset_active", rc) * scale;
+    parts->title_vertical_offset_inactive =
+        getIntValue ("title_vertical_offset_inactive", rc) * scale;
+    parts->title_horizontal_offset =
+        getIntValue ("title_horizontal_offset", rc) * scale;
+}
+
+static void
+loadTheme (ScreenInfo *screen_info, Settings *rc)
+{
+
     static const char *ui_part[] = {
         "fg",
         "fg",
@@ -379,7 +493,6 @@ loadTheme (ScreenInfo *screen_info, Settings *rc)
         NULL
     };
 
-    gchar imagename[30];
     GValue tmp_val = { 0, };
     GValue tmp_val2 = { 0, };
     DisplayInfo *display_info;
@@ -387,6 +500,8 @@ loadTheme (ScreenInfo *screen_info, Settings *rc)
     GtkWidget *widget;
     gchar *theme;
     const gchar *font;
+    guint scales;
+    gint scale;
     guint i, j;
 
     widget = myScreenGetGtkWidget (screen_info);
@@ -405,6 +520,8 @@ loadTheme (ScreenInfo *screen_info, Settings *rc)
     /* Then load xfwm4 theme values */
     theme = getThemeDir (getThemeName (screen_info, rc), THEMERC);
     parseRc (THEMERC, theme, rc);
+    scales = getThemeScales (screen_info, rc);
+    scale = getThemeDefaultScale (screen_info, scales);
 
     /* And finally redo a pass for transitive definitions of colors */
     for (i = 0; i < XPM_COLOR_SYMBOL_SIZE; i++)
@@ -428,14 +545,15 @@ loadTheme (ScreenInfo *screen_info, Settings *rc)
         }
     }
 
+    /* Shadows are drawn by the compositor for all monitors alike */
     screen_info->params->shadow_delta_x =
-        - getIntValue ("shadow_delta_x", rc);
+        - getIntValue ("shadow_delta_x", rc) * scale;
     screen_info->params->shadow_delta_y =
-        - getIntValue ("shadow_delta_y", rc);
+        - getIntValue ("shadow_delta_y", rc) * scale;
     screen_info->params->shadow_delta_width =
-        - getIntValue ("shadow_delta_width", rc);
+        - getIntValue ("shadow_delta_width", rc) * scale;
     screen_info->params->shadow_delta_height =
-        - getIntValue ("shadow_delta_height", rc);
+        - getIntValue ("shadow_delta_height", rc) * scale;
 
     for (i = 0; i < XPM_COLOR_SYMBOL_SIZE; i++)
     {
@@ -468,54 +586,23 @@ loadTheme (ScreenInfo *screen_info, Settings *rc)
     {
         screen_info->font_desc = pango_font_description_from_string (font);
     }
-    myScreenUpdateFontAttr (screen_info);
 
     gdk_rgba_parse (&screen_info->title_colors[ACTIVE], getStringValue ("active_text_color", rc));
     gdk_rgba_parse (&screen_info->title_colors[INACTIVE], getStringValue ("inactive_text_color", rc));
     gdk_rgba_parse (&screen_info->title_shadow_colors[ACTIVE], getStringValue ("active_text_shadow_color", rc));
     gdk_rgba_parse (&screen_info->title_shadow_colors[INACTIVE], getStringValue ("inactive_text_shadow_color", rc));
 
-    for (i = 0; i < SIDE_COUNT; i++)
-    {
-        if (i == SIDE_TOP)
-            continue;  /* There is no top decoration per se. */
-
-        g_snprintf(imagename, sizeof (imagename), "%s-active", side_names[i]);
-        xfwmPixmapLoad (screen_info, &screen_info->sides[i][ACTIVE], theme, imagename, colsym);
-
-        g_snprintf(imagename, sizeof (imagename), "%s-inactive", side_names[i]);
-        xfwmPixmapLoad (screen_info, &screen_info->sides[i][INACTIVE], theme, imagename, colsym);
-    }
-    for (i = 0; i < CORNER_COUNT; i++)
-    {
-        g_snprintf(imagename, sizeof (imagename), "%s-active", corner_names[i]);
-        xfwmPixmapLoad (screen_info, &screen_info->corners[i][ACTIVE], theme, imagename, colsym);
-
-        g_snprintf(imagename, sizeof (imagename), "%s-inactive", corner_names[i]);
-        xfwmPixmapLoad (screen_info, &screen_info->corners[i][INACTIVE], theme, imagename, colsym);
-    }
-    for (i = 0; i < BUTTON_COUNT; i++)
+    /* One set of parts per scale of the monitors */
+    for (i = 0; i < THEME_SCALE_MAX; i++)
     {
-        for (j = 0; j < STATE_COUNT; j++)
+        if (scales & (1 << i))
         {
-            g_snprintf(imagename, sizeof (imagename), "%s-%s", button_names[i], button_state_names[j]);
-            xfwmPixmapLoad (screen_info, &screen_info->buttons[i][j], theme, imagename, colsym);
+            loadThemeParts (screen_info, rc, theme, colsym, &screen_info->theme_parts[i]);
         }
     }
-    for (i = 0; i < TITLE_COUNT; i++)
-    {
-        g_snprintf(imagename, sizeof (imagename), "title-%d-active", i + 1);
-        xfwmPixmapLoad (screen_info, &screen_info->title[i][ACTIVE], theme, imagename, colsym);
-
-        g_snprintf(imagename, sizeof (imagename), "title-%d-inactive", i + 1);
-        xfwmPixmapLoad (screen_info, &screen_info->title[i][INACTIVE], theme, imagename, colsym);
-
-        g_snprintf(imagename, sizeof (imagename), "top-%d-active", i + 1);
-        xfwmPixmapLoad (screen_info, &screen_info->top[i][ACTIVE], theme, imagename, colsym);
-
-        g_snprintf(imagename, sizeof (imagename), "top-%d-inactive", i + 1);
-        xfwmPixmapLoad (screen_info, &screen_info->top[i][INACTIVE], theme, imagename, colsym);
-    }
+    screen_info->theme_scales = scales;
+    screen_info->default_scale = scale;
+    myScreenUpdateFontAttr (screen_info);
 
     screen_info->box_gc = createGC (screen_info, "#FFFFFF", GXxor, NULL, 2, TRUE);
 
@@ -538,16 +625,6 @@ loadTheme (ScreenInfo *screen_info, Settings *rc)
     screen_info->params->title_shadow[INACTIVE] = getTitleShadow (rc, "title_shadow_inactive");
 
     strncpy (screen_info->params->button_layout, getStringValue ("button_layout", rc), BUTTON_STRING_COUNT);
-    screen_info->params->button_spacing = getIntValue ("button_spacing", rc);
-    screen_info->params->button_offset = getIntValue ("button_offset", rc);
-    screen_info->params->frame_border_top = getIntValue ("frame_border_top", rc);
-    screen_info->params->maximized_offset = getIntValue ("maximized_offset", rc);
-    screen_info->params->title_vertical_offset_active =
-        getIntValue ("title_vertical_offset_active", rc);
-    screen_info->params->title_vertical_offset_inactive =
-        getIntValue ("title_vertical_offset_inactive", rc);
-    screen_info->params->title_horizontal_offset =
-        getIntValue ("title_horizontal_offset", rc);
 
     g_free (theme);
 }
@@ -687,6 +764,7 @@ loadSettings (ScreenInfo *screen_info)
         {"double_click_distance", NULL, G_TYPE_INT, TRUE},
         {"double_click_time", NULL, G_TYPE_INT, TRUE},
         {"easy_click", NULL, G_TYPE_STRING, TRUE},
+        {"fast_move", NULL, G_TYPE_BOOLEAN, TRUE},
         {"focus_delay", NULL, G_TYPE_INT, TRUE},
         {"focus_hint", NULL, G_TYPE_BOOLEAN, TRUE},
         {"focus_new", NULL, G_TYPE_BOOLEAN,TRUE},
@@ -705,6 +783,7 @@ loadSettings (ScreenInfo *screen_info)
         {"placement_mode", NULL, G_TYPE_STRING, TRUE},
         {"placement_ratio", NULL, G_TYPE_INT, TRUE},
         {"popup_opacity", NULL, G_TYPE_INT, TRUE},
+        {"predict_move", NULL, G_TYPE_BOOLEAN, TRUE},
         {"prevent_focus_stealing", NULL, G_TYPE_BOOLEAN, TRUE},
         {"raise_delay", NULL, G_TYPE_INT, TRUE},
         {"raise_on_click", NULL, G_TYPE_BOOLEAN, TRUE},
@@ -712,6 +791,7 @@ loadSettings (ScreenInfo *screen_info)
         {"raise_with_any_button", NULL, G_TYPE_BOOLEAN, TRUE},
         {"repeat_urgent_blink", NULL, G_TYPE_BOOLEAN, TRUE},
         {"resize_opacity", NULL, G_TYPE_INT, TRUE},
+        {"scale_decorations", NULL, G_TYPE_BOOLEAN, TRUE},
         {"scroll_workspaces", NULL, G_TYPE_BOOLEAN, TRUE},
         {"shadow_delta_height", NULL, G_TYPE_INT, TRUE},
         {"shadow_delta_width", NULL, G_TYPE_INT, TRUE},
@@ -738,6 +818,7 @@ loadSettings (ScreenInfo *screen_info)
         {"title_vertical_offset_active", NULL, G_TYPE_INT, TRUE},
         {"title_vertical_offset_inactive", NULL, G_TYPE_INT, TRUE},
         {"toggle_workspaces", NULL, G_TYPE_BOOLEAN, TRUE},
+        {"unmapped_cache_size", NULL, G_TYPE_INT, TRUE},
         {"unredirect_overlays", NULL, G_TYPE_BOOLEAN, TRUE},
         {"urgent_blink", NULL, G_TYPE_BOOLEAN, TRUE},
         {"use_compositing", NULL, G_TYPE_BOOLEAN, TRUE},
@@ -789,6 +870,8 @@ loadSettings (ScreenInfo *screen_info)
         CLAMP (getIntValue ("cycle_tabwin_mode", rc), 0, 1);
     screen_info->params->cycle_workspaces =
         getBoolValue ("cycle_workspaces", rc);
+    screen_info->params->fast_move =
+        getBoolValue ("fast_move", rc);
     screen_info->params->focus_hint =
         getBoolValue ("focus_hint", rc);
     screen_info->params->focus_new =
@@ -797,6 +880,8 @@ loadSettings (ScreenInfo *screen_info)
         getBoolValue ("horiz_scroll_opacity", rc);
     screen_info->params->mousewheel_rollup =
         getBoolValue ("mousewheel_rollup", rc);
+    screen_info->params->predict_move =
+        getBoolValue ("predict_move", rc);
     screen_info->params->prevent_focus_stealing =
         getBoolValue ("prevent_focus_stealing", rc);
     screen_info->params->raise_delay =
@@ -847,6 +932,8 @@ loadSettings (ScreenInfo *screen_info)
         getBoolValue ("tile_on_move", rc);
     screen_info->params->toggle_workspaces =
         getBoolValue ("toggle_workspaces", rc);
+    screen_info->params->unmapped_cache_size =
+        CLAMP (getIntValue ("unmapped_cache_size", rc), 0, 4096);
     screen_info->params->unredirect_overlays =
         getBoolValue ("unredirect_overlays", rc);
     screen_info->params->use_compositing =
@@ -864,6 +951,8 @@ loadSettings (ScreenInfo *screen_info)
         getBoolValue ("wrap_windows", rc);
     screen_info->params->wrap_cycle =
         getBoolValue ("wrap_cycle", rc);
+    screen_info->params->scale_decorations =
+        getBoolValue ("scale_decorations", rc);
     screen_info->params->scroll_workspaces =
         getBoolValue ("scroll_workspaces", rc);
     screen_info->params->wrap_resistance =
@@ -926,7 +1015,7 @@ loadSettings (ScreenInfo *screen_info)
 static void
 unloadTheme (ScreenInfo *screen_info)
 {
-    int i, j;
+    int i, j, k;
 
     TRACE ("entering");
 
@@ -936,30 +1025,37 @@ unloadTheme (ScreenInfo *screen_info)
         screen_info->font_desc = NULL;
     }
 
-    for (i = 0; i < SIDE_COUNT; i++)
-    {
-        xfwmPixmapFree (&screen_info->sides[i][ACTIVE]);
-        xfwmPixmapFree (&screen_info->sides[i][INACTIVE]);
-    }
-    for (i = 0; i < CORNER_COUNT; i++)
-    {
-        xfwmPixmapFree (&screen_info->corners[i][ACTIVE]);
-        xfwmPixmapFree (&screen_info->corners[i][INACTIVE]);
-    }
-    for (i = 0; i < BUTTON_COUNT; i++)
+    frameFreeParts (screen_info);
+    for (k = 0; k < THEME_SCALE_MAX; k++)
     {
-        for (j = 0; j < STATE_COUNT; j++)
+        ThemeParts *theme = &screen_info->theme_parts[k];
+
+        for (i = 0; i < SIDE_COUNT; i++)
         {
-            xfwmPixmapFree (&screen_info->buttons[i][j]);
+            xfwmPixmapFree (&theme->sides[i][ACTIVE]);
+            xfwmPixmapFree (&theme->sides[i][INACTIVE]);
+        }
+        for (i = 0; i < CORNER_COUNT; i++)
+        {
+            xfwmPixmapFree (&theme->corners[i][ACTIVE]);
+            xfwmPixmapFree (&theme->corners[i][INACTIVE]);
+        }
+        for (i = 0; i < BUTTON_COUNT; i++)
+        {
+            for (j = 0; j < STATE_COUNT; j++)
+            {
+                xfwmPixmapFree (&theme->buttons[i][j]);
+            }
+        }
+        for (i = 0; i < TITLE_COUNT; i++)
+        {
+            xfwmPixmapFree (&theme->title[i][ACTIVE]);
+            xfwmPixmapFree (&theme->title[i][INACTIVE]);
+            xfwmPixmapFree (&theme->top[i][ACTIVE]);
+            xfwmPixmapFree (&theme->top[i][INACTIVE]);
         }
     }
-    for (i = 0; i < TITLE_COUNT; i++)
-    {
-        xfwmPixmapFree (&screen_info->title[i][ACTIVE]);
-        xfwmPixmapFree (&screen_info->title[i][INACTIVE]);
-        xfwmPixmapFree (&screen_info->top[i][ACTIVE]);
-        xfwmPixmapFree (&screen_info->top[i][INACTIVE]);
-    }
+    screen_info->theme_scales = 0;
     if (screen_info->box_gc != None)
     {
         XFreeGC (myScreenGetXDisplay (screen_info), screen_info->box_gc);
@@ -1186,6 +1282,11 @@ cb_xfwm4_channel_property_changed(XfconfChannel *channel, const gchar *property_
                 {
                     screen_info->params->wrap_resistance = CLAMP (g_value_get_int (value), 5, 100);
                 }
+                else if (!strcmp (name, "unmapped_cache_size"))
+                {
+                    screen_info->params->unmapped_cache_size = CLAMP (g_value_get_int (value), 0, 4096);
+                    compositorTrimSavedPictures (screen_info);
+                }
                 else if (!strcmp (name, "margin_left"))
                 {
                     set_settings_margin (screen_info, STRUTS_LEFT, g_value_get_int (value));
@@ -1274,6 +1375,10 @@ cb_xfwm4_channel_property_changed(XfconfChannel *channel, const gchar *property_
                     screen_info->params->click_to_focus = g_value_get_boolean (value);
                     update_grabs (screen_info);
                 }
+                else if (!strcmp (name, "fast_move"))
+                {
+                    screen_info->params->fast_move = g_value_get_boolean (value);
+                }
                 else if (!strcmp (name, "focus_new"))
                 {
                     screen_info->params->focus_new = g_value_get_boolean (value);
@@ -1374,6 +1479,10 @@ cb_xfwm4_channel_property_changed(XfconfChannel *channel, const gchar *property_
                 {
                     screen_info->params->mousewheel_rollup = g_value_get_boolean (value);
                 }
+                else if (!strcmp (name, "predict_move"))
+                {
+                    screen_info->params->predict_move = g_value_get_boolean (value);
+                }
                 else if (!strcmp (name, "prevent_focus_stealing"))
                 {
                     screen_info->params->prevent_focus_stealing = g_value_get_boolean (value);
@@ -1383,6 +1492,11 @@ cb_xfwm4_channel_property_changed(XfconfChannel *channel, const gchar *property_
                     screen_info->params->raise_with_any_button = g_value_get_boolean (value);
                     update_grabs (screen_info);
                 }
+                else if (!strcmp (name, "scale_decorations"))
+                {
+                    screen_info->params->scale_decorations = g_value_get_boolean (value);
+                    reloadScreenSettings (screen_info, UPDATE_MAXIMIZE | UPDATE_GRAVITY | UPDATE_CACHE);
+                }
                 else if (!strcmp (name, "scroll_workspaces"))
                 {
                     screen_info->params->scroll_workspaces = g_value_get_boolean (value);
@@ -182,16 +182,12 @@ struct _XfwmParams
     gchar button_layout[BUTTON_STRING_COUNT + 1];
     int xfwm_margins[4];
     int activate_action;
-    int button_offset;
-    int button_spacing;
     int cycle_tabwin_mode;
     int double_click_action;
     guint easy_click;
     int focus_delay;
     int frame_opacity;
-    int frame_border_top;
     int inactive_opacity;
-    int maximized_offset;
     int move_opacity;
     int placement_mode;
     int placement_ratio;
@@ -205,8 +201,8 @@ struct _XfwmParams
     int shadow_opacity;
     int snap_width;
     int title_alignment;
-    int title_horizontal_offset;
     int title_shadow[2];
+    int unmapped_cache_size;
     int wrap_resistance;
     gboolean borderless_maximize;
     gboolean titleless_maximize;
@@ -221,16 +217,19 @@ struct _XfwmParams
     gboolean cycle_minimum;
     gboolean cycle_preview;
     gboolean cycle_workspaces;
+    gboolean fast_move;
     gboolean focus_hint;
     gboolean focus_new;
     gboolean full_width_title;
     gboolean horiz_scroll_opacity;
     gboolean mousewheel_rollup;
+    gboolean predict_move;
     gboolean prevent_focus_stealing;
     gboolean raise_on_click;
     gboolean raise_on_focus;
     gboolean raise_with_any_button;
     gboolean repeat_urgent_blink;
+    gboolean scale_decorations;
     gboolean scroll_workspaces;
     gboolean show_app_icon;
     gboolean show_dock_shadow;
@@ -240,8 +239,6 @@ struct _XfwmParams
     gboolean snap_to_border;
     gboolean snap_to_windows;
     gboolean tile_on_move;
-    gboolean title_vertical_offset_active;
-    gboolean title_vertical_offset_inactive;
     gboolean toggle_workspaces;
     gboolean unredirect_overlays;
     gboolean urgent_blink;
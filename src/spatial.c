@@ -0,0 +1,278 @@
+/*      $Id$
+
+        This program is free software; you can redistribute it and/or modify
+        it under the terms of the GNU General Public License as published by
+        the Free Software Foundation; either version 2, or (at your option)
+        any later version.
+
+        This program is distributed in the hope that it will be useful,
+        but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+        GNU General Public License for more details.
+
+        You should have received a copy of the GNU General Public License
+        along with this program; if not, write to the Free Software
+        Foundation, Inc., Inc., 51 Franklin Street, Fifth Floor, Boston,
+        MA 02110-1301, USA.
+
+
+        xfwm4    - (c) 2002-2022 Olivier Fourdan
+
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <glib.h>
+#include <gdk/gdk.h>
+#include <libxfce4util/libxfce4util.h>
+
+#include "screen.h"
+#include "client.h"
+#include "frame.h"
+#include "spatial.h"
+
+/*
+ * The spatial index is a uniform grid laid over the screen, each cell
+ * holding the list of managed clients whose frame intersects it. Frames
+ * partly or fully off screen are clamped to the border cells, so the
+ * index never misses a client, it only returns more candidates than
+ * strictly needed and callers still test the actual geometry.
+ */
+#ifndef SPATIAL_CELL_SIZE
+#define SPATIAL_CELL_SIZE 256
+#endif
+
+static void
+spatialCellRange (ScreenInfo *screen_info, gint x1, gint y1, gint x2, gint y2, GdkRectangle *range)
+{
+    gint col1, row1, col2, row2;
+
+    col1 = CLAMP (x1 / SPATIAL_CELL_SIZE, 0, screen_info->spatial_cols - 1);
+    row1 = CLAMP (y1 / SPATIAL_CELL_SIZE, 0, screen_info->spatial_rows - 1);
+    col2 = CLAMP (x2 / SPATIAL_CELL_SIZE, 0, screen_info->spatial_cols - 1);
+    row2 = CLAMP (y2 / SPATIAL_CELL_SIZE, 0, screen_info->spatial_rows - 1);
+
+    range->x = MIN (col1, col2);
+    range->y = MIN (row1, row2);
+    range->width = ABS (col2 - col1) + 1;
+    range->height = ABS (row2 - row1) + 1;
+}
+
+static void
+spatialClientRange (Client *c, GdkRectangle *range)
+{
+    gint x, y;
+
+    x = frameX (c);
+    y = frameY (c);
+    /* Hit-testing includes the right and bottom edges, account for those */
+    spatialCellRange (c->screen_info, x - 1, y - 1,
+                      x + frameWidth (c) + 1, y + frameHeight (c) + 1, range);
+}
+
+static void
+spatialIndexLink (Client *c, GdkRectangle *range)
+{
+    ScreenInfo *screen_info;
+    gint col, row, index;
+
+    screen_info = c->screen_info;
+    for (row = range->y; row < range->y + range->height; row++)
+    {
+        for (col = range->x; col < range->x + range->width; col++)
+        {
+            index = row * screen_info->spatial_cols + col;
+            screen_info->spatial_cells[index] =
+                g_list_prepend (screen_info->spatial_cells[index], c);
+        }
+    }
+    c->spatial_range = *range;
+}
+
+static void
+spatialIndexUnlink (Client *c)
+{
+    ScreenInfo *screen_info;
+    GdkRectangle *range;
+    gint col, row, index;
+
+    screen_info = c->screen_info;
+    range = &c->spatial_range;
+    for (row = range->y; row < range->y + range->height; row++)
+    {
+        for (col = range->x; col < range->x + range->width; col++)
+        {
+            index = row * screen_info->spatial_cols + col;
+            screen_info->spatial_cells[index] =
+                g_list_remove (screen_info->spatial_cells[index], c);
+        }
+    }
+    range->width = 0;
+    range->height = 0;
+}
+
+void
+spatialIndexFree (ScreenInfo *screen_info)
+{
+    Client *c;
+    guint i;
+
+    g_return_if_fail (screen_info != NULL);
+
+    if (!screen_info->spatial_cells)
+    {
+        return;
+    }
+
+    for (i = 0; i < (guint) (screen_info->spatial_cols * screen_info->spatial_rows); i++)
+    {
+        g_list_free (screen_info->spatial_cells[i]);
+    }
+    g_free (screen_info->spatial_cells);
+    screen_info->spatial_cells = NULL;
+    screen_info->spatial_cols = 0;
+    screen_info->spatial_rows = 0;
+
+    for (c = screen_info->clients, i = 0; i < screen_info->client_count; c = c->next, i++)
+    {
+        c->spatial_range.width = 0;
+        c->spatial_range.height = 0;
+    }
+}
+
+void
+spatialIndexResize (ScreenInfo *screen_info)
+{
+    GdkRectangle range;
+    Client *c;
+    guint i;
+
+    g_return_if_fail (screen_info != NULL);
+    TRACE ("screen size %ix%i", screen_info->width, screen_info->height);
+
+    spatialIndexFree (screen_info);
+
+    screen_info->spatial_cols = MAX (1, (screen_info->width + SPATIAL_CELL_SIZE - 1) / SPATIAL_CELL_SIZE);
+    screen_info->spatial_rows = MAX (1, (screen_info->height + SPATIAL_CELL_SIZE - 1) / SPATIAL_CELL_SIZE);
+    screen_info->spatial_cells = g_new0 (GList *, screen_info->spatial_cols * screen_info->spatial_rows);
+
+    for (c = screen_info->clients, i = 0; i < screen_info->client_count; c = c->next, i++)
+    {
+        if (FLAG_TEST (c->xfwm_flags, XFWM_FLAG_MANAGED))
+        {
+            spatialClientRange (c, &range);
+            spatialIndexLink (c, &range);
+        }
+    }
+}
+
+void
+spatialIndexUpdate (Client *c)
+{
+    GdkRectangle range;
+
+    g_return_if_fail (c != NULL);
+
+    /* Clients enter the index once managed, see clientAddToList() */
+    if (!c->screen_info->spatial_cells || !FLAG_TEST (c->xfwm_flags, XFWM_FLAG_MANAGED))
+    {
+        return;
+    }
+
+    spatialClientRange (c, &range);
+    if ((c->spatial_range.width > 0) &&
+        (range.x == c->spatial_range.x) && (range.y == c->spatial_range.y) &&
+        (range.width == c->spatial_range.width) && (range.height == c->spatial_range.height))
+    {
+        /* Still within the same cells, nothing to do */
+        return;
+    }
+
+    if (c->spatial_range.width > 0)
+    {
+        spatialIndexUnlink (c);
+    }
+    spatialIndexLink (c, &range);
+}
+
+void
+spatialIndexRemove (Client *c)
+{
+    g_return_if_fail (c != NULL);
+
+    if (c->screen_info->spatial_cells && (c->spatial_range.width > 0))
+    {
+        spatialIndexUnlink (c);
+    }
+}
+
+/* Returns the clients which may contain the given point, the list belongs to the index */
+GList *
+spatialIndexQueryPoint (ScreenInfo *screen_info, gint x, gint y)
+{
+    GdkRectangle range;
+
+    g_return_val_if_fail (screen_info != NULL, NULL);
+
+    if (!screen_info->spatial_cells)
+    {
+        return NULL;
+    }
+
+    spatialCellRange (screen_info, x, y, x, y, &range);
+    return screen_info->spatial_cells[range.y * screen_info->spatial_cols + range.x];
+}
+
+/* Returns a new list of the clients which may intersect the given area */
+GList *
+spatialIndexQueryRect (ScreenInfo *screen_info, GdkRectangle *area)
+{
+    GdkRectangle range;
+    GList *result, *list;
+    Client *c;
+    gint col, row;
+
+    g_return_val_if_fail (screen_info != NULL, NULL);
+    g_return_val_if_fail (area != NULL, NULL);
+
+    if (!screen_info->spatial_cells)
+    {
+        return NULL;
+    }
+
+    /* Clients spanning several cells must be reported only once */
+    if (++screen_info->spatial_stamp == 0)
+    {
+        guint i;
+
+        for (c = screen_info->clients, i = 0; i < screen_info->client_count; c = c->next, i++)
+        {
+            c->spatial_stamp = 0;
+        }
+        screen_info->spatial_stamp = 1;
+    }
+    result = NULL;
+
+    spatialCellRange (screen_info, area->x, area->y,
+                      area->x + area->width, area->y + area->height, &range);
+    for (row = range.y; row < range.y + range.height; row++)
+    {
+        for (col = range.x; col < range.x + range.width; col++)
+        {
+            list = screen_info->spatial_cells[row * screen_info->spatial_cols + col];
+            for (; list; list = g_list_next (list))
+            {
+                c = (Client *) list->data;
+                if (c->spatial_stamp != screen_info->spatial_stamp)
+                {
+                    c->spatial_stamp = screen_info->spatial_stamp;
+                    result = g_list_prepend (result, c);
+                }
+            }
+        }
+    }
+
+    return result;
+}
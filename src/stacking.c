@@ -28,6 +28,7 @@
 #include <X11/Xutil.h>
 #include <X11/Xatom.h>
 #include <glib.h>
+#include <string.h>
 #include <libxfce4util/libxfce4util.h>
 
 #include "display.h"
@@ -39,14 +40,134 @@
 #include "transients.h"
 #include "frame.h"
 #include "focus.h"
+#include "spatial.h"
+#include "xaccount.h"
+
+/*
+ * Above this ratio of the stack being out of place, a full XRestackWindows
+ * costs about the same as individual sibling moves and also resyncs the
+ * whole stack, so fall back to it.
+ */
+#define STACK_DIFF_MAX_RATIO 2
 
 static guint raise_timeout = 0;
 
+/*
+ * Compare the previously applied stack with the new one (both top to bottom)
+ * and flag in "keep" the windows which can stay where they are, i.e. the
+ * longest subsequence of the new stack already in the right relative order
+ * in the old one. Returns the number of windows which need to be moved.
+ */
+static guint
+clientComputeStackMoves (Window *old_stack, guint old_size,
+                         Window *new_stack, guint new_size,
+                         gboolean *keep)
+{
+    GHashTable *positions;
+    gint *old_pos;
+    guint *tails;
+    gint *prev;
+    guint len, lo, hi, mid;
+    guint i, moves;
+    gint j;
+
+    positions = g_hash_table_new (g_direct_hash, g_direct_equal);
+    for (i = 0; i < old_size; i++)
+    {
+        g_hash_table_insert (positions, (gpointer) old_stack[i], GUINT_TO_POINTER (i + 1));
+    }
+
+    old_pos = g_new (gint, new_size);
+    for (i = 0; i < new_size; i++)
+    {
+        old_pos[i] = GPOINTER_TO_INT (g_hash_table_lookup (positions, (gpointer) new_stack[i])) - 1;
+        keep[i] = FALSE;
+    }
+    g_hash_table_destroy (positions);
+
+    /* Patience sorting, tails[k] is the index in new_stack ending the best run of length k + 1 */
+    tails = g_new (guint, new_size);
+    prev = g_new (gint, new_size);
+    len = 0;
+    for (i = 0; i < new_size; i++)
+    {
+        if (old_pos[i] < 0)
+        {
+            continue;
+        }
+        lo = 0;
+        hi = len;
+        while (lo < hi)
+        {
+            mid = (lo + hi) / 2;
+            if (old_pos[tails[mid]] < old_pos[i])
+            {
+                lo = mid + 1;
+            }
+            else
+            {
+                hi = mid;
+            }
+        }
+        prev[i] = (lo > 0) ? (gint) tails[lo - 1] : -1;
+        tails[lo] = i;
+        if (lo == len)
+        {
+            len++;
+        }
+    }
+
+    for (j = (len > 0) ? (gint) tails[len - 1] : -1; j >= 0; j = prev[j])
+    {
+        keep[j] = TRUE;
+    }
+    moves = new_size - len;
+
+    g_free (prev);
+    g_free (tails);
+    g_free (old_pos);
+
+    return moves;
+}
+
+/* Keep the stacking position of each client at hand for the spatial lookups */
+static void
+clientStackRenumber (ScreenInfo *screen_info)
+{
+    GList *list;
+    guint i;
+
+    for (list = screen_info->windows_stack, i = 0; list; list = g_list_next (list), i++)
+    {
+        ((Client *) list->data)->stack_index = i;
+    }
+}
+
+static void
+clientStackCacheRemove (ScreenInfo *screen_info, Window w)
+{
+    guint i;
+
+    for (i = 0; i < screen_info->stack_cache_size; i++)
+    {
+        if (screen_info->stack_cache[i] == w)
+        {
+            screen_info->stack_cache_size--;
+            memmove (&screen_info->stack_cache[i], &screen_info->stack_cache[i + 1],
+                     (screen_info->stack_cache_size - i) * sizeof (Window));
+            return;
+        }
+    }
+}
+
 void
 clientApplyStackList (ScreenInfo *screen_info)
 {
     Window *xwinstack;
+    XWindowChanges wc;
+    gboolean *keep;
     guint nwindows;
+    guint moves;
     gint i;
 
     DBG ("applying stack list");
@@ -72,11 +193,47 @@ clientApplyStackList (ScreenInfo *screen_info)
         }
     }
 
+    xAccountBegin (screen_info->display_info, "restack");
     myDisplayErrorTrapPush (screen_info->display_info);
-    XRestackWindows (myScreenGetXDisplay (screen_info), xwinstack, (int) nwindows + 4);
+    moves = G_MAXUINT;
+    keep = NULL;
+    if (screen_info->stack_cache)
+    {
+        keep = g_new (gboolean, nwindows + 4);
+        moves = clientComputeStackMoves (screen_info->stack_cache, screen_info->stack_cache_size,
+                                         xwinstack, nwindows + 4, keep);
+        /* The topmost sidewalk is the anchor, XRestackWindows never moves it either */
+        if (!keep[0])
+        {
+            moves = G_MAXUINT;
+        }
+    }
+
+    if (moves <= (nwindows + 4) / STACK_DIFF_MAX_RATIO)
+    {
+        DBG ("restacking %u of %u windows", moves, nwindows + 4);
+        for (i = 1; i < (gint) nwindows + 4; i++)
+        {
+            if (!keep[i])
+            {
+                wc.sibling = xwinstack[i - 1];
+                wc.stack_mode = Below;
+                XConfigureWindow (myScreenGetXDisplay (screen_info), xwinstack[i],
+                                  CWSibling | CWStackMode, &wc);
+            }
+        }
+    }
+    else
+    {
+        XRestackWindows (myScreenGetXDisplay (screen_info), xwinstack, (int) nwindows + 4);
+    }
     myDisplayErrorTrapPopIgnored (screen_info->display_info);
+    xAccountEnd (screen_info->display_info);
 
-    g_free (xwinstack);
+    g_free (keep);
+    g_free (screen_info->stack_cache);
+    screen_info->stack_cache = xwinstack;
+    screen_info->stack_cache_size = nwindows + 4;
 }
 
 Client *
@@ -262,10 +419,15 @@ clientAtPosition (ScreenInfo *screen_info, int x, int y, GList * exclude_list)
 
     TRACE ("(%i,%i)", x, y);
 
+    /* Only the clients sharing the cell of the point, pick the topmost one */
     c = NULL;
-    for (list = g_list_last (screen_info->windows_stack); list; list = g_list_previous (list))
+    for (list = spatialIndexQueryPoint (screen_info, x, y); list; list = g_list_next (list))
     {
         c2 = (Client *) list->data;
+        if (c && (c2->stack_index < c->stack_index))
+        {
+            continue;
+        }
         if ((frameX (c2) <= x) && (frameX (c2) + frameWidth (c2) >= x)
             && (frameY (c2) <= y) && (frameY (c2) + frameHeight (c2) >= y))
         {
@@ -273,7 +435,6 @@ clientAtPosition (ScreenInfo *screen_info, int x, int y, GList * exclude_list)
                 && !g_list_find (exclude_list, (gconstpointer) c2))
             {
                 c = c2;
-                break;
             }
         }
     }
@@ -418,6 +579,8 @@ clientRaise (Client * c, Window wsibling)
         return;
     }
 
+    xAccountBegin (display_info, "raise");
+
     /* Search for the window that will be just on top of the raised window  */
     client_sibling = NULL;
     if (wsibling)
@@ -454,6 +617,8 @@ clientRaise (Client * c, Window wsibling)
         clientRaiseInternal (c, client_sibling);
     }
 
+    clientStackRenumber (screen_info);
+
     /* Now, screen_info->windows_stack contains the correct window stack
        We still need to tell the X Server to reflect the changes
      */
@@ -472,6 +637,7 @@ clientRaise (Client * c, Window wsibling)
     clientSetNetClientList (screen_info, display_info->atoms[NET_CLIENT_LIST_STACKING], screen_info->windows_stack);
     }
     screen_info->last_raise = c;
+    xAccountEnd (display_info);
 }
 
 void
@@ -559,6 +725,8 @@ clientLower (Client * c, Window wsibling)
         }
     }
 
+    clientStackRenumber (screen_info);
+
     /* Now, screen_info->windows_stack contains the correct window stack
        We still need to tell the X Server to reflect the changes
      */
@@ -628,10 +796,12 @@ clientAddToList (Client * c)
 
     screen_info->windows = g_list_append (screen_info->windows, c);
     screen_info->windows_stack = g_list_append (screen_info->windows_stack, c);
+    c->stack_index = g_list_length (screen_info->windows_stack) - 1;
 
     clientSetNetClientList (screen_info, display_info->atoms[NET_CLIENT_LIST], screen_info->windows);
 
     FLAG_SET (c->xfwm_flags, XFWM_FLAG_MANAGED);
+    spatialIndexUpdate (c);
 }
 
 void
@@ -667,6 +837,10 @@ clientRemoveFromList (Client * c)
 
     screen_info->windows = g_list_remove (screen_info->windows, c);
     screen_info->windows_stack = g_list_remove (screen_info->windows_stack, c);
+    clientStackRenumber (screen_info);
+    /* The frame XID may be reused, forget where it was stacked */
+    clientStackCacheRemove (screen_info, c->frame);
+    spatialIndexRemove (c);
 
     clientSetNetClientList (screen_info, display_info->atoms[NET_CLIENT_LIST], screen_info->windows);
     clientSetNetClientList (screen_info, display_info->atoms[NET_CLIENT_LIST_STACKING], screen_info->windows_stack);
@@ -316,29 +316,70 @@ tabwinSelectWidget (Tabwin *tabwin)
     return tabwinGetSelected (tabwin);
 }
 
-static GtkWidget *
-createWindowIcon (GdkScreen *screen, GdkPixbuf *icon_pixbuf, gint size, gint scale)
+static void
+tabwinEntrySetIcon (TabwinEntry *entry, GdkScreen *screen, GdkPixbuf *icon_pixbuf, gint size, gint scale)
 {
     GtkIconTheme *icon_theme;
-    GtkWidget * icon;
+    GdkPixbuf *default_pixbuf;
     cairo_surface_t *surface;
 
     TRACE ("entering");
 
+    /* Same icon at the same size as the last time, nothing to do */
+    if (icon_pixbuf != NULL && icon_pixbuf == entry->pixbuf &&
+        size == entry->icon_size && scale == entry->icon_scale)
+    {
+        return;
+    }
+
+    default_pixbuf = NULL;
     if (icon_pixbuf == NULL)
     {
         icon_theme = gtk_icon_theme_get_for_screen (screen);
-        icon_pixbuf = gtk_icon_theme_load_icon (icon_theme, "xfwm4-default",
-                                                size * scale, 0, NULL);
+        default_pixbuf = gtk_icon_theme_load_icon (icon_theme, "xfwm4-default",
+                                                   size * scale, 0, NULL);
     }
 
-    icon = gtk_image_new ();
-    surface = gdk_cairo_surface_create_from_pixbuf (icon_pixbuf, scale, NULL);
-    if (surface != NULL) {
-        gtk_image_set_from_surface (GTK_IMAGE (icon), surface);
+    surface = gdk_cairo_surface_create_from_pixbuf (icon_pixbuf ? icon_pixbuf : default_pixbuf,
+                                                    scale, NULL);
+    if (surface != NULL)
+    {
+        gtk_image_set_from_surface (GTK_IMAGE (entry->icon), surface);
         cairo_surface_destroy (surface);
     }
-    return icon;
+    if (default_pixbuf)
+    {
+        g_object_unref (default_pixbuf);
+    }
+
+    if (entry->pixbuf)
+    {
+        g_object_unref (entry->pixbuf);
+    }
+    entry->pixbuf = icon_pixbuf ? g_object_ref (icon_pixbuf) : NULL;
+    entry->icon_size = size;
+    entry->icon_scale = scale;
+}
+
+static void
+tabwinEntryFree (gpointer data)
+{
+    TabwinEntry *entry;
+
+    entry = (TabwinEntry *) data;
+    if (entry == NULL)
+    {
+        return;
+    }
+
+    /* Also takes the button out of the grid it might still be in */
+    gtk_widget_destroy (entry->button);
+    g_object_unref (entry->button);
+    if (entry->pixbuf)
+    {
+        g_object_unref (entry->pixbuf);
+    }
+    g_free (entry);
 }
 
 static int
@@ -374,7 +415,8 @@ getMinMonitorHeight (ScreenInfo *screen_info)
 static gboolean
 cb_window_button_enter (GtkWidget *widget, GdkEvent *event, gpointer user_data)
 {
-    TabwinWidget *tabwin_widget = user_data;
+    /* Buttons move between switcher windows, see tabwinGetEntry() */
+    TabwinWidget *tabwin_widget = (TabwinWidget *) gtk_widget_get_toplevel (widget);
     Client *c;
     GtkWidget *buttonbox, *buttonlabel;
     GList *children;
@@ -422,7 +464,7 @@ cb_window_button_enter (GtkWidget *widget, GdkEvent *event, gpointer user_data)
 static gboolean
 cb_window_button_leave (GtkWidget *widget, GdkEvent *event, gpointer user_data)
 {
-    TabwinWidget *tabwin_widget = user_data;
+    TabwinWidget *tabwin_widget = (TabwinWidget *) gtk_widget_get_toplevel (widget);
     Client *c;
 
     TRACE ("entering");
@@ -457,6 +499,79 @@ cb_window_button_leave (GtkWidget *widget, GdkEvent *event, gpointer user_data)
     return FALSE;
 }
 
+/*
+ * The widgets of a client are created the first time it shows in the
+ * switcher and kept by the client until it goes away, so showing the
+ * switcher again only needs to move them to the new grid.
+ */
+static TabwinEntry *
+tabwinGetEntry (Client *c, guint slot, gint mode)
+{
+    TabwinEntry *entry;
+    GtkWidget *buttonbox;
+
+    g_return_val_if_fail (c != NULL, NULL);
+    TRACE ("client \"%s\" (0x%lx), slot %u", c->name, c->window, slot);
+
+    if (slot >= c->tabwin_entries->len)
+    {
+        g_ptr_array_set_size (c->tabwin_entries, slot + 1);
+    }
+    entry = g_ptr_array_index (c->tabwin_entries, slot);
+    if (entry != NULL && entry->mode == mode)
+    {
+        return entry;
+    }
+    if (entry != NULL)
+    {
+        /* The layout changed in between, start over */
+        tabwinEntryFree (entry);
+    }
+
+    entry = g_new0 (TabwinEntry, 1);
+    entry->mode = mode;
+    entry->button = g_object_ref_sink (gtk_button_new ());
+    gtk_button_set_relief (GTK_BUTTON (entry->button), GTK_RELIEF_NONE);
+    g_object_set_data (G_OBJECT (entry->button), "client-ptr-val", c);
+    g_signal_connect (entry->button, "enter-notify-event",
+                      G_CALLBACK (cb_window_button_enter), NULL);
+    g_signal_connect (entry->button, "leave-notify-event",
+                      G_CALLBACK (cb_window_button_leave), NULL);
+    gtk_widget_add_events (entry->button, GDK_ENTER_NOTIFY_MASK);
+
+    entry->icon = gtk_image_new ();
+    if (mode == STANDARD_ICON_GRID)
+    {
+        buttonbox = gtk_box_new (GTK_ORIENTATION_VERTICAL, 0);
+        entry->label = gtk_label_new ("");
+        gtk_label_set_xalign (GTK_LABEL (entry->label), 0.5);
+        gtk_label_set_yalign (GTK_LABEL (entry->label), 1.0);
+
+        gtk_widget_set_halign (entry->icon, GTK_ALIGN_CENTER);
+        gtk_widget_set_valign (entry->icon, GTK_ALIGN_END);
+        gtk_box_pack_start (GTK_BOX (buttonbox), entry->icon, TRUE, TRUE, 0);
+    }
+    else
+    {
+        buttonbox = gtk_box_new (GTK_ORIENTATION_HORIZONTAL, 6);
+        entry->label = gtk_label_new (c->name);
+        gtk_label_set_xalign (GTK_LABEL (entry->label), 0);
+        gtk_label_set_yalign (GTK_LABEL (entry->label), 0.5);
+
+        gtk_widget_set_halign (entry->icon, GTK_ALIGN_CENTER);
+        gtk_widget_set_valign (entry->icon, GTK_ALIGN_CENTER);
+        gtk_box_pack_start (GTK_BOX (buttonbox), entry->icon, FALSE, FALSE, 0);
+    }
+    gtk_container_add (GTK_CONTAINER (entry->button), buttonbox);
+
+    gtk_label_set_justify (GTK_LABEL (entry->label), GTK_JUSTIFY_CENTER);
+    gtk_label_set_ellipsize (GTK_LABEL (entry->label), PANGO_ELLIPSIZE_END);
+    gtk_box_pack_start (GTK_BOX (buttonbox), entry->label, TRUE, TRUE, 0);
+    g_ptr_array_index (c->tabwin_entries, slot) = entry;
+
+    return entry;
+}
+
 static GtkWidget *
 createWindowlist (ScreenInfo *screen_info, TabwinWidget *tabwin_widget)
 {
@@ -464,13 +579,10 @@ createWindowlist (ScreenInfo *screen_info, TabwinWidget *tabwin_widget)
     GList *client_list;
     GList *icon_list;
     GtkWidget *windowlist;
-    GtkWidget *icon;
     GtkWidget *selected;
-    GtkWidget *window_button;
-    GtkWidget *buttonbox;
-    GtkWidget *buttonlabel;
     GtkWidget *selected_label;
     GdkPixbuf *icon_pixbuf;
+    TabwinEntry *entry;
     gint packpos;
     gint label_width;
     gint size_request;
@@ -502,27 +614,18 @@ createWindowlist (ScreenInfo *screen_info, TabwinWidget *tabwin_widget)
         icon_pixbuf = (GdkPixbuf *) icon_list->data;
         icon_list = g_list_next (icon_list);
 
-        window_button = gtk_button_new ();
-        gtk_button_set_relief (GTK_BUTTON (window_button), GTK_RELIEF_NONE);
-        g_object_set_data (G_OBJECT (window_button), "client-ptr-val", c);
-        g_signal_connect (window_button, "enter-notify-event",
-                          G_CALLBACK (cb_window_button_enter), tabwin_widget);
-        g_signal_connect (window_button, "leave-notify-event",
-                          G_CALLBACK (cb_window_button_leave), tabwin_widget);
-        gtk_widget_add_events (window_button, GDK_ENTER_NOTIFY_MASK);
+        entry = tabwinGetEntry (c, tabwin_widget->slot, screen_info->params->cycle_tabwin_mode);
+        tabwinEntrySetIcon (entry, screen_info->gscr, icon_pixbuf, tabwin->icon_size, tabwin->icon_scale);
+        /* Left over from the last time the switcher was shown */
+        gtk_widget_unset_state_flags (entry->button, GTK_STATE_FLAG_CHECKED | GTK_STATE_FLAG_PRELIGHT);
 
-        icon = createWindowIcon (screen_info->gscr, icon_pixbuf, tabwin->icon_size, tabwin->icon_scale);
         if (screen_info->params->cycle_tabwin_mode == STANDARD_ICON_GRID)
         {
-            gtk_widget_set_size_request (GTK_WIDGET (window_button), size_request, size_request);
-            buttonbox = gtk_box_new (GTK_ORIENTATION_VERTICAL, 0);
-            buttonlabel = gtk_label_new ("");
-            gtk_label_set_xalign (GTK_LABEL (buttonlabel), 0.5);
-            gtk_label_set_yalign (GTK_LABEL (buttonlabel), 1.0);
-
-            gtk_widget_set_halign (icon, GTK_ALIGN_CENTER);
-            gtk_widget_set_valign (icon, GTK_ALIGN_END);
-            gtk_box_pack_start (GTK_BOX (buttonbox), icon, TRUE, TRUE, 0);
+            gtk_widget_set_size_request (GTK_WIDGET (entry->button), size_request, size_request);
+            gtk_label_set_text (GTK_LABEL (entry->label), "");
+            gtk_grid_attach (GTK_GRID (windowlist), GTK_WIDGET (entry->button),
+                             packpos % tabwin->grid_cols, packpos / tabwin->grid_cols,
+                             1, 1);
         }
         else
         {
@@ -530,48 +633,25 @@ createWindowlist (ScreenInfo *screen_info, TabwinWidget *tabwin_widget)
 
             if (tabwin->icon_size < tabwin->label_height)
             {
-                gtk_widget_set_size_request (GTK_WIDGET (window_button),
+                gtk_widget_set_size_request (GTK_WIDGET (entry->button),
                                              label_width, tabwin->label_height + 8);
             }
             else
             {
-                gtk_widget_set_size_request (GTK_WIDGET (window_button),
+                gtk_widget_set_size_request (GTK_WIDGET (entry->button),
                                              label_width, tabwin->icon_size + 8);
             }
-            buttonbox = gtk_box_new (GTK_ORIENTATION_HORIZONTAL, 6);
-            buttonlabel = gtk_label_new (c->name);
-            gtk_label_set_xalign (GTK_LABEL (buttonlabel), 0);
-            gtk_label_set_yalign (GTK_LABEL (buttonlabel), 0.5);
-
-            gtk_widget_set_halign (icon, GTK_ALIGN_CENTER);
-            gtk_widget_set_valign (icon, GTK_ALIGN_CENTER);
-            gtk_box_pack_start (GTK_BOX (buttonbox), icon, FALSE, FALSE, 0);
-        }
-        gtk_container_add (GTK_CONTAINER (window_button), buttonbox);
-
-        gtk_label_set_justify (GTK_LABEL (buttonlabel), GTK_JUSTIFY_CENTER);
-        gtk_label_set_ellipsize (GTK_LABEL (buttonlabel), PANGO_ELLIPSIZE_END);
-        gtk_box_pack_start (GTK_BOX (buttonbox), buttonlabel, TRUE, TRUE, 0);
-
-        if (screen_info->params->cycle_tabwin_mode == STANDARD_ICON_GRID)
-        {
-            gtk_grid_attach (GTK_GRID (windowlist), GTK_WIDGET (window_button),
-                             packpos % tabwin->grid_cols, packpos / tabwin->grid_cols,
-                             1, 1);
-        }
-        else
-        {
-            gtk_grid_attach (GTK_GRID (windowlist), GTK_WIDGET (window_button),
+            gtk_grid_attach (GTK_GRID (windowlist), GTK_WIDGET (entry->button),
                              packpos / tabwin->grid_rows, packpos % tabwin->grid_rows,
                              1, 1);
         }
 
-        tabwin_widget->widgets = g_list_append (tabwin_widget->widgets, window_button);
+        tabwin_widget->widgets = g_list_append (tabwin_widget->widgets, entry->button);
         packpos++;
         if (c == tabwin->selected->data)
         {
-            selected = window_button;
-            selected_label = buttonlabel;
+            selected = entry->button;
+            selected_label = entry->label;
             gtk_widget_grab_focus (selected);
         }
     }
@@ -733,10 +813,16 @@ computeTabwinData (ScreenInfo *screen_info, TabwinWidget *tabwin_widget)
 
         if (screen_info->params->cycle_tabwin_mode == STANDARD_ICON_GRID)
         {
-            if (preview)
+            /*
+             * Previews are slow to get, use the one from the last time
+             * if any, or the application icon, until the actual preview
+             * gets fetched once the switcher is shown.
+             */
+            if (preview && c->tabwin_thumbnail &&
+                gdk_pixbuf_get_width (c->tabwin_thumbnail) == tabwin->icon_size * tabwin->icon_scale &&
+                gdk_pixbuf_get_height (c->tabwin_thumbnail) == tabwin->icon_size * tabwin->icon_scale)
             {
-                icon_pixbuf = getClientIcon (c, tabwin->icon_size * tabwin->icon_scale,
-                                             tabwin->icon_size * tabwin->icon_scale);
+                icon_pixbuf = g_object_ref (c->tabwin_thumbnail);
             }
             else
             {
@@ -752,10 +838,11 @@ computeTabwinData (ScreenInfo *screen_info, TabwinWidget *tabwin_widget)
         }
         tabwin->icon_list = g_list_append(tabwin->icon_list, icon_pixbuf);
     }
+    tabwin->preview = preview && (screen_info->params->cycle_tabwin_mode == STANDARD_ICON_GRID);
 }
 
 static TabwinWidget *
-tabwinCreateWidget (Tabwin *tabwin, ScreenInfo *screen_info, gint monitor_num)
+tabwinCreateWidget (Tabwin *tabwin, ScreenInfo *screen_info, gint monitor_num, guint slot)
 {
     TabwinWidget *tabwin_widget;
     GdkScreen *screen;
@@ -772,6 +859,7 @@ tabwinCreateWidget (Tabwin *tabwin, ScreenInfo *screen_info, gint monitor_num)
     tabwin_widget = g_object_new (tabwin_widget_get_type(), "type", GTK_WINDOW_POPUP, NULL);
 
     tabwin_widget->monitor_num = monitor_num;
+    tabwin_widget->slot = slot;
     tabwin_widget->tabwin = tabwin;
     tabwin_widget->selected = NULL;
     tabwin_widget->selected_callback = 0;
@@ -897,6 +985,70 @@ tabwinChange2Selected (Tabwin *tabwin, GList *selected)
     return tabwinGetSelected (tabwin);
 }
 
+static void
+tabwinSetIcon (Tabwin *tabwin, Client *c, GdkPixbuf *icon_pixbuf)
+{
+    GList *tabwin_list;
+    TabwinWidget *tabwin_widget;
+    TabwinEntry *entry;
+
+    for (tabwin_list = tabwin->tabwin_list; tabwin_list; tabwin_list = g_list_next (tabwin_list))
+    {
+        tabwin_widget = (TabwinWidget *) tabwin_list->data;
+        if (tabwin_widget->slot >= c->tabwin_entries->len)
+        {
+            continue;
+        }
+        entry = g_ptr_array_index (c->tabwin_entries, tabwin_widget->slot);
+        if (entry != NULL)
+        {
+            tabwinEntrySetIcon (entry, c->screen_info->gscr, icon_pixbuf,
+                                tabwin->icon_size, tabwin->icon_scale);
+        }
+    }
+}
+
+static gboolean
+tabwinUpdateThumbnail (gpointer data)
+{
+    Tabwin *tabwin;
+    GdkPixbuf *icon_pixbuf;
+    Client *c;
+    gint size;
+
+    tabwin = (Tabwin *) data;
+    if (tabwin->thumbnail_next == NULL)
+    {
+        tabwin->thumbnail_idle_id = 0;
+        return FALSE;
+    }
+
+    c = (Client *) tabwin->thumbnail_next->data;
+    tabwin->thumbnail_next = g_list_next (tabwin->thumbnail_next);
+    TRACE ("client \"%s\" (0x%lx)", c->name, c->window);
+
+    size = tabwin->icon_size * tabwin->icon_scale;
+    icon_pixbuf = getClientIcon (c, size, size);
+    if (icon_pixbuf)
+    {
+        tabwinSetIcon (tabwin, c, icon_pixbuf);
+        /* Kept for the next time the switcher is shown */
+        if (c->tabwin_thumbnail)
+        {
+            g_object_unref (c->tabwin_thumbnail);
+        }
+        c->tabwin_thumbnail = icon_pixbuf;
+    }
+
+    if (tabwin->thumbnail_next == NULL)
+    {
+        tabwin->thumbnail_idle_id = 0;
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
 Tabwin *
 tabwinCreate (GList **client_list, GList *selected, gboolean display_workspace)
 {
@@ -938,10 +1090,19 @@ tabwinCreate (GList **client_list, GList *selected, gboolean display_workspace)
             continue;
         }
 
-        win = tabwinCreateWidget (tabwin, screen_info, monitor_index);
+        win = tabwinCreateWidget (tabwin, screen_info, monitor_index,
+                                  g_list_length (tabwin->tabwin_list));
         tabwin->tabwin_list  = g_list_append (tabwin->tabwin_list, win);
     }
 
+    if (tabwin->preview)
+    {
+        /* One preview per iteration, so events keep being processed */
+        tabwin->thumbnail_next = *client_list;
+        tabwin->thumbnail_idle_id =
+            g_idle_add_full (G_PRIORITY_DEFAULT_IDLE, tabwinUpdateThumbnail, tabwin, NULL);
+    }
+
     return tabwin;
 }
 
@@ -984,12 +1145,16 @@ tabwinRemoveClient (Tabwin *tabwin, Client *c)
             {
                 tabwinSelectNext (tabwin);
             }
+            if (client_list == tabwin->thumbnail_next)
+            {
+                tabwin->thumbnail_next = g_list_next (client_list);
+            }
             *tabwin->client_list = g_list_delete_link (*tabwin->client_list, client_list);
             break;
         }
     }
 
-    /* Second, remove the icon from all boxes */
+    /* Second, remove the icon from all boxes, the client keeps the widgets */
     for (tabwin_list = tabwin->tabwin_list; tabwin_list; tabwin_list = g_list_next (tabwin_list))
     {
         tabwin_widget = (TabwinWidget *) tabwin_list->data;
@@ -998,8 +1163,14 @@ tabwinRemoveClient (Tabwin *tabwin, Client *c)
             icon = GTK_WIDGET (widgets->data);
             if (((Client *) g_object_get_data (G_OBJECT(icon), "client-ptr-val")) == c)
             {
+                if (tabwin_widget->hovered == icon)
+                {
+                    tabwin_widget->hovered = NULL;
+                }
+                gtk_widget_unset_state_flags (icon, GTK_STATE_FLAG_CHECKED | GTK_STATE_FLAG_PRELIGHT);
                 gtk_container_remove (GTK_CONTAINER (tabwin_widget->container), icon);
                 tabwin_widget->widgets = g_list_delete_link (tabwin_widget->widgets, widgets);
+                break;
             }
         }
     }
@@ -1311,18 +1482,119 @@ tabwinSelectHovered (Tabwin *tabwin)
 void
 tabwinDestroy (Tabwin *tabwin)
 {
-    GList *tabwin_list;
+    GList *tabwin_list, *widgets;
     TabwinWidget *tabwin_widget;
 
     g_return_if_fail (tabwin != NULL);
     TRACE ("entering");
 
+    if (tabwin->thumbnail_idle_id)
+    {
+        g_source_remove (tabwin->thumbnail_idle_id);
+        tabwin->thumbnail_idle_id = 0;
+    }
+
     for (tabwin_list = tabwin->tabwin_list; tabwin_list; tabwin_list = g_list_next (tabwin_list))
     {
         tabwin_widget = (TabwinWidget *) tabwin_list->data;
+        /* Take the buttons out before they get destroyed with the window */
+        for (widgets = tabwin_widget->widgets; widgets; widgets = g_list_next (widgets))
+        {
+            gtk_container_remove (GTK_CONTAINER (tabwin_widget->container),
+                                  GTK_WIDGET (widgets->data));
+        }
         g_list_free (tabwin_widget->widgets);
         gtk_widget_destroy (GTK_WIDGET (tabwin_widget));
     }
     g_list_free_full (tabwin->icon_list, g_object_unref);
     g_list_free (tabwin->tabwin_list);
 }
+
+void
+tabwinClientAdd (Client *c)
+{
+    g_return_if_fail (c != NULL);
+
+    c->tabwin_thumbnail = NULL;
+    /* Filled in the first time the client shows in the switcher */
+    c->tabwin_entries = g_ptr_array_new_with_free_func (tabwinEntryFree);
+}
+
+void
+tabwinClientRemove (Client *c)
+{
+    g_return_if_fail (c != NULL);
+    TRACE ("client \"%s\" (0x%lx)", c->name, c->window);
+
+    if (c->tabwin_thumbnail)
+    {
+        g_object_unref (c->tabwin_thumbnail);
+        c->tabwin_thumbnail = NULL;
+    }
+    if (c->tabwin_entries)
+    {
+        g_ptr_array_free (c->tabwin_entries, TRUE);
+        c->tabwin_entries = NULL;
+    }
+}
+
+void
+tabwinClientUpdateName (Client *c)
+{
+    TabwinEntry *entry;
+    guint i;
+
+    g_return_if_fail (c != NULL);
+    TRACE ("client \"%s\" (0x%lx)", c->name, c->window);
+
+    for (i = 0; c->tabwin_entries && i < c->tabwin_entries->len; i++)
+    {
+        entry = g_ptr_array_index (c->tabwin_entries, i);
+        /* The icon grid shows the name of the selected client only */
+        if (entry != NULL && entry->mode == OVERFLOW_COLUMN_GRID)
+        {
+            gtk_label_set_text (GTK_LABEL (entry->label), c->name);
+        }
+    }
+}
+
+void
+tabwinClientUpdateIcon (Client *c)
+{
+    TabwinEntry *entry;
+    GdkPixbuf *icon_pixbuf;
+    guint i;
+
+    g_return_if_fail (c != NULL);
+    TRACE ("client \"%s\" (0x%lx)", c->name, c->window);
+
+    if (c->tabwin_thumbnail)
+    {
+        g_object_unref (c->tabwin_thumbnail);
+        c->tabwin_thumbnail = NULL;
+    }
+
+    for (i = 0; c->tabwin_entries && i < c->tabwin_entries->len; i++)
+    {
+        entry = g_ptr_array_index (c->tabwin_entries, i);
+        if (entry == NULL || entry->pixbuf == NULL)
+        {
+            continue;
+        }
+        if (gtk_widget_get_parent (entry->button) == NULL)
+        {
+            /* Not shown, picked up the next time the switcher is */
+            g_object_unref (entry->pixbuf);
+            entry->pixbuf = NULL;
+            continue;
+        }
+        icon_pixbuf = getAppIcon (c, entry->icon_size * entry->icon_scale,
+                                  entry->icon_size * entry->icon_scale);
+        tabwinEntrySetIcon (entry, c->screen_info->gscr, icon_pixbuf,
+                            entry->icon_size, entry->icon_scale);
+        if (icon_pixbuf)
+        {
+            g_object_unref (icon_pixbuf);
+        }
+    }
+}
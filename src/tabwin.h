@@ -34,6 +34,7 @@
 typedef struct _Tabwin Tabwin;
 typedef struct _TabwinWidget TabwinWidget;
 typedef struct _TabwinWidgetClass TabwinWidgetClass;
+typedef struct _TabwinEntry TabwinEntry;
 
 typedef enum
 {
@@ -57,6 +58,26 @@ struct _Tabwin
     gint icon_scale;
     gint label_height;
     gboolean display_workspace;
+    gboolean preview;
+    /* Previews are fetched once the switcher is shown */
+    GList *thumbnail_next;
+    guint thumbnail_idle_id;
+};
+
+/*
+ * The widgets of a client in one of the switcher windows. They are
+ * kept by the client across invocations and only moved from one grid
+ * to the next, see tabwinGetEntry().
+ */
+struct _TabwinEntry
+{
+    GtkWidget *button;
+    GtkWidget *icon;
+    GtkWidget *label;
+    GdkPixbuf *pixbuf;
+    gint mode;
+    gint icon_size;
+    gint icon_scale;
 };
 
 struct _TabwinWidget
@@ -76,6 +97,8 @@ struct _TabwinWidget
     gint width;
     gint height;
     gint monitor_num;
+    /* Index of the client entries used by this window */
+    guint slot;
 };
 
 struct _TabwinWidgetClass
@@ -95,5 +118,9 @@ Client                  *tabwinSelectHovered                    (Tabwin *);
 Client                  *tabwinRemoveClient                     (Tabwin *,
                                                                  Client *);
 void                    tabwinDestroy                           (Tabwin *);
+void                    tabwinClientAdd                         (Client *);
+void                    tabwinClientRemove                      (Client *);
+void                    tabwinClientUpdateName                  (Client *);
+void                    tabwinClientUpdateIcon                  (Client *);
 
 #endif /* INC_TABWIN_H */
@@ -0,0 +1,392 @@
+/*      $Id$
+
+        This program is free software; you can redistribute it and/or modify
+        it under the terms of the GNU General Public License as published by
+        the Free Software Foundation; either version 2, or (at your option)
+        any later version.
+
+        This program is distributed in the hope that it will be useful,
+        but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+        GNU General Public License for more details.
+
+        You should have received a copy of the GNU General Public License
+        along with this program; if not, write to the Free Software
+        Foundation, Inc., Inc., 51 Franklin Street, Fifth Floor, Boston,
+        MA 02110-1301, USA.
+
+
+        xfwm4    - (c) 2002-2022 Olivier Fourdan
+
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <string.h>
+#include <sys/stat.h>
+
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <gdk-pixbuf/gdk-pixbuf.h>
+#include <libxfce4util/libxfce4util.h>
+
+#include "mypixmap.h"
+#include "themecache.h"
+
+/*
+ * The theme cache holds the theme images once the XPM color symbols have
+ * been substituted and the other image formats composed on top, so that
+ * a theme can be loaded again without parsing or probing any file.
+ *
+ * There is one cache file per theme directory, made of a header, a table
+ * of entries and the pixel data, in GdkPixbuf layout. The header carries
+ * a key computed from the modification times of the theme directory and
+ * its files and from the color symbol values; when the key does not match,
+ * the theme is loaded the usual way and the cache file is written anew.
+ * Parts missing from the theme are recorded as empty entries so that a
+ * cache hit does not look for them either.
+ *
+ * Themes scaled on load for HiDPI get a cache file per scale factor, so
+ * that the scaled images are computed once as well.
+ */
+
+#define THEME_CACHE_MAGIC    "XFWMTHC"
+#define THEME_CACHE_VERSION  1
+#define THEME_CACHE_NAME_LEN 32
+
+typedef struct _ThemeCacheHeader ThemeCacheHeader;
+struct _ThemeCacheHeader
+{
+    gchar magic[8];
+    guint32 version;
+    guint32 count;
+    gchar key[48];
+};
+
+typedef struct _ThemeCacheEntry ThemeCacheEntry;
+struct _ThemeCacheEntry
+{
+    gchar name[THEME_CACHE_NAME_LEN];
+    guint32 width;
+    guint32 height;
+    guint32 rowstride;
+    guint32 has_alpha;
+    guint32 offset;
+    guint32 size;
+};
+
+struct _ThemeCache
+{
+    gchar *filename;
+    gchar *key;
+    /* Cache hit */
+    GMappedFile *mapped;
+    GHashTable *entries;
+    /* Cache miss */
+    GArray *table;
+    GByteArray *data;
+};
+
+static gchar *
+themeCacheGetKey (const gchar *dir, xfwmColorSymbol *cs, gint scale)
+{
+    GChecksum *checksum;
+    GStatBuf st;
+    const gchar *name;
+    gchar *filename;
+    gchar *key;
+    GDir *gdir;
+    gint64 mtime;
+    guint i;
+
+    if (g_stat (dir, &st) != 0)
+    {
+        return NULL;
+    }
+    mtime = st.st_mtime;
+
+    /* Files edited in place do not change the directory mtime */
+    gdir = g_dir_open (dir, 0, NULL);
+    if (gdir)
+    {
+        while ((name = g_dir_read_name (gdir)))
+        {
+            filename = g_build_filename (dir, name, NULL);
+            if (g_stat (filename, &st) == 0)
+            {
+                mtime = MAX (mtime, (gint64) st.st_mtime);
+            }
+            g_free (filename);
+        }
+        g_dir_close (gdir);
+    }
+
+    checksum = g_checksum_new (G_CHECKSUM_SHA1);
+    g_checksum_update (checksum, (const guchar *) dir, -1);
+    g_checksum_update (checksum, (const guchar *) &mtime, sizeof (mtime));
+    g_checksum_update (checksum, (const guchar *) &scale, sizeof (scale));
+    for (i = 0; cs && cs[i].name; i++)
+    {
+        g_checksum_update (checksum, (const guchar *) cs[i].name, -1);
+        g_checksum_update (checksum, (const guchar *) "=", 1);
+        g_checksum_update (checksum, (const guchar *) (cs[i].value ? cs[i].value : ""), -1);
+        g_checksum_update (checksum, (const guchar *) ";", 1);
+    }
+    key = g_strdup (g_checksum_get_string (checksum));
+    g_checksum_free (checksum);
+
+    return key;
+}
+
+static gboolean
+themeCacheMap (ThemeCache *cache)
+{
+    ThemeCacheHeader header;
+    ThemeCacheEntry *entry;
+    const gchar *contents;
+    gsize length, table_end;
+    guint32 i;
+
+    cache->mapped = g_mapped_file_new (cache->filename, FALSE, NULL);
+    if (!cache->mapped)
+    {
+        return FALSE;
+    }
+
+    contents = g_mapped_file_get_contents (cache->mapped);
+    length = g_mapped_file_get_length (cache->mapped);
+    if (length < sizeof (header))
+    {
+        return FALSE;
+    }
+
+    memcpy (&header, contents, sizeof (header));
+    if ((strncmp (header.magic, THEME_CACHE_MAGIC, sizeof (header.magic)) != 0) ||
+        (header.version != THEME_CACHE_VERSION) ||
+        (strncmp (header.key, cache->key, sizeof (header.key)) != 0))
+    {
+        return FALSE;
+    }
+
+    table_end = sizeof (header) + (gsize) header.count * sizeof (ThemeCacheEntry);
+    if (table_end > length)
+    {
+        return FALSE;
+    }
+
+    /* The header size keeps the table aligned */
+    entry = (ThemeCacheEntry *) (contents + sizeof (header));
+    for (i = 0; i < header.count; i++, entry++)
+    {
+        if ((entry->name[THEME_CACHE_NAME_LEN - 1] != '\0') ||
+            ((gsize) entry->offset + entry->size > length) ||
+            ((gsize) entry->rowstride * entry->height > entry->size) ||
+            (entry->rowstride < entry->width * (entry->has_alpha ? 4 : 3)))
+        {
+            g_hash_table_remove_all (cache->entries);
+            return FALSE;
+        }
+        g_hash_table_insert (cache->entries, entry->name, entry);
+    }
+
+    return TRUE;
+}
+
+ThemeCache *
+themeCacheOpen (const gchar *dir, xfwmColorSymbol *cs, gint scale)
+{
+    ThemeCache *cache;
+    gchar *cachedir;
+    gchar *checksum;
+    gchar *basename;
+
+    g_return_val_if_fail (dir != NULL, NULL);
+
+    cache = g_new0 (ThemeCache, 1);
+    cache->key = themeCacheGetKey (dir, cs, scale);
+    if (!cache->key)
+    {
+        g_free (cache);
+        return NULL;
+    }
+
+    cachedir = xfce_resource_save_location (XFCE_RESOURCE_CACHE, "xfwm4/themes", TRUE);
+    if (!cachedir)
+    {
+        g_free (cache->key);
+        g_free (cache);
+        return NULL;
+    }
+    checksum = g_compute_checksum_for_string (G_CHECKSUM_MD5, dir, -1);
+    basename = g_strdup_printf ("%s-%dx", checksum, scale);
+    cache->filename = g_build_filename (cachedir, basename, NULL);
+    g_free (basename);
+    g_free (checksum);
+    g_free (cachedir);
+
+    cache->entries = g_hash_table_new (g_str_hash, g_str_equal);
+    if (themeCacheMap (cache))
+    {
+        TRACE ("theme cache hit for %s", dir);
+        return cache;
+    }
+
+    TRACE ("theme cache miss for %s", dir);
+    if (cache->mapped)
+    {
+        g_mapped_file_unref (cache->mapped);
+        cache->mapped = NULL;
+    }
+    cache->table = g_array_new (FALSE, TRUE, sizeof (ThemeCacheEntry));
+    cache->data = g_byte_array_new ();
+
+    return cache;
+}
+
+gboolean
+themeCacheIsValid (ThemeCache *cache)
+{
+    return (cache != NULL) && (cache->mapped != NULL);
+}
+
+gboolean
+themeCacheLookup (ThemeCache *cache, const gchar *file, GdkPixbuf **pixbuf)
+{
+    ThemeCacheEntry *entry;
+    const gchar *contents;
+
+    g_return_val_if_fail (pixbuf != NULL, FALSE);
+
+    *pixbuf = NULL;
+    if (!themeCacheIsValid (cache))
+    {
+        return FALSE;
+    }
+
+    entry = g_hash_table_lookup (cache->entries, file);
+    if (!entry)
+    {
+        return FALSE;
+    }
+
+    if ((entry->width > 0) && (entry->height > 0))
+    {
+        /* The pixbuf keeps the mapping alive for as long as it needs it */
+        contents = g_mapped_file_get_contents (cache->mapped);
+        *pixbuf = gdk_pixbuf_new_from_data ((const guchar *) contents + entry->offset,
+                                            GDK_COLORSPACE_RGB, entry->has_alpha, 8,
+                                            entry->width, entry->height, entry->rowstride,
+                                            (GdkPixbufDestroyNotify) g_mapped_file_unref,
+                                            g_mapped_file_ref (cache->mapped));
+    }
+
+    return TRUE;
+}
+
+void
+themeCacheAdd (ThemeCache *cache, const gchar *file, GdkPixbuf *pixbuf)
+{
+    ThemeCacheEntry entry;
+    const guchar *pixels;
+    static const guchar padding[4] = { 0, };
+    guint row_size;
+    gint y;
+
+    if ((cache == NULL) || (cache->table == NULL))
+    {
+        return;
+    }
+
+    memset (&entry, 0, sizeof (entry));
+    g_strlcpy (entry.name, file, sizeof (entry.name));
+
+    if ((pixbuf) &&
+        (gdk_pixbuf_get_colorspace (pixbuf) == GDK_COLORSPACE_RGB) &&
+        (gdk_pixbuf_get_bits_per_sample (pixbuf) == 8))
+    {
+        entry.width = gdk_pixbuf_get_width (pixbuf);
+        entry.height = gdk_pixbuf_get_height (pixbuf);
+        entry.has_alpha = gdk_pixbuf_get_has_alpha (pixbuf);
+        row_size = entry.width * gdk_pixbuf_get_n_channels (pixbuf);
+        entry.rowstride = (row_size + 3) & ~3;
+        entry.offset = cache->data->len;
+        entry.size = entry.rowstride * entry.height;
+
+        /* The last row of a pixbuf may not be padded to the rowstride */
+        pixels = gdk_pixbuf_get_pixels (pixbuf);
+        for (y = 0; y < (gint) entry.height; y++)
+        {
+            g_byte_array_append (cache->data,
+                                 pixels + y * gdk_pixbuf_get_rowstride (pixbuf),
+                                 row_size);
+            g_byte_array_append (cache->data, padding, entry.rowstride - row_size);
+        }
+    }
+
+    g_array_append_val (cache->table, entry);
+}
+
+static void
+themeCacheWrite (ThemeCache *cache)
+{
+    ThemeCacheHeader header;
+    ThemeCacheEntry *entry;
+    GByteArray *contents;
+    GError *error;
+    gsize data_offset;
+    guint i;
+
+    memset (&header, 0, sizeof (header));
+    g_strlcpy (header.magic, THEME_CACHE_MAGIC, sizeof (header.magic));
+    g_strlcpy (header.key, cache->key, sizeof (header.key));
+    header.version = THEME_CACHE_VERSION;
+    header.count = cache->table->len;
+
+    data_offset = sizeof (header) + cache->table->len * sizeof (ThemeCacheEntry);
+    for (i = 0; i < cache->table->len; i++)
+    {
+        entry = &g_array_index (cache->table, ThemeCacheEntry, i);
+        entry->offset += data_offset;
+    }
+
+    contents = g_byte_array_sized_new (data_offset + cache->data->len);
+    g_byte_array_append (contents, (const guint8 *) &header, sizeof (header));
+    g_byte_array_append (contents, (const guint8 *) cache->table->data,
+                         cache->table->len * sizeof (ThemeCacheEntry));
+    g_byte_array_append (contents, cache->data->data, cache->data->len);
+
+    error = NULL;
+    if (!g_file_set_contents (cache->filename, (const gchar *) contents->data,
+                              contents->len, &error))
+    {
+        g_warning ("Cannot write theme cache: %s", error->message);
+        g_error_free (error);
+    }
+    g_byte_array_free (contents, TRUE);
+}
+
+void
+themeCacheClose (ThemeCache *cache)
+{
+    if (cache == NULL)
+    {
+        return;
+    }
+
+    if (cache->table)
+    {
+        themeCacheWrite (cache);
+        g_array_free (cache->table, TRUE);
+        g_byte_array_free (cache->data, TRUE);
+    }
+    if (cache->mapped)
+    {
+        g_mapped_file_unref (cache->mapped);
+    }
+    g_hash_table_destroy (cache->entries);
+    g_free (cache->filename);
+    g_free (cache->key);
+    g_free (cache);
+}
@@ -44,10 +44,6 @@
 #define OUTLINE_WIDTH 5
 #endif
 
-#ifndef OUTLINE_WIDTH_CAIRO
-#define OUTLINE_WIDTH_CAIRO 2
-#endif
-
 static void
 wireframeDrawXlib (WireFrame *wireframe, int width, int height)
 {
@@ -117,43 +113,6 @@ wireframeDrawXlib (WireFrame *wireframe, int width, int height)
     }
 }
 
-static void
-wireframeDrawCairo (WireFrame *wireframe, int width, int height)
-{
-    ScreenInfo *screen_info = wireframe->screen_info;
-
-    XMoveResizeWindow (myScreenGetXDisplay (screen_info), wireframe->xwindow,
-                       wireframe->x, wireframe->y, width, height);
-    if (!wireframe->mapped)
-    {
-        XMapWindow (myScreenGetXDisplay (screen_info), wireframe->xwindow);
-        wireframe->mapped = TRUE;
-    }
-    if ((width == wireframe->width) && (height == wireframe->height))
-    {
-        /* Moving only */
-        return;
-    }
-    wireframe->width = width;
-    wireframe->height = height;
-
-    cairo_xlib_surface_set_size(wireframe->surface, wireframe->width, wireframe->height);
-    XClearWindow (myScreenGetXDisplay (screen_info), wireframe->xwindow);
-    cairo_set_source_rgba (wireframe->cr, wireframe->red, wireframe->green, wireframe->blue, wireframe->alpha);
-    cairo_paint (wireframe->cr);
-
-    cairo_set_source_rgba (wireframe->cr, wireframe->red, wireframe->green, wireframe->blue, 1.0);
-    cairo_rectangle (wireframe->cr,
-                     OUTLINE_WIDTH_CAIRO / 2, OUTLINE_WIDTH_CAIRO / 2,
-                     wireframe->width - OUTLINE_WIDTH_CAIRO,
-                     wireframe->height - OUTLINE_WIDTH_CAIRO);
-    cairo_stroke (wireframe->cr);
-    /* Force a resize of the compositor window to avoid flickering */
-    compositorResizeWindow (screen_info->display_info, wireframe->xwindow,
-                            wireframe->x, wireframe->y,
-                            wireframe->width, wireframe->height);
-}
-
 void
 wireframeUpdate (Client *c, WireFrame *wireframe)
 {
@@ -167,14 +126,15 @@ wireframeUpdate (Client *c, WireFrame *wireframe)
     wireframe->y = frameExtentY (c);
 
     screen_info = wireframe->screen_info;
-    if (compositorIsActive (screen_info))
-    {
-         wireframeDrawCairo (wireframe, frameExtentWidth (c), frameExtentHeight (c));
-    }
-    else
+    if (wireframe->xwindow == None)
     {
-         wireframeDrawXlib (wireframe, frameExtentWidth (c), frameExtentHeight (c));
+        /* Drawn by the compositor, only the outline gets repainted */
+        compositorSetOutline (screen_info, wireframe->x, wireframe->y,
+                              frameExtentWidth (c), frameExtentHeight (c));
+        return;
     }
+
+    wireframeDrawXlib (wireframe, frameExtentWidth (c), frameExtentHeight (c));
     XFlush (myScreenGetXDisplay (screen_info));
 }
 
@@ -185,9 +145,11 @@ wireframeInitColor (WireFrame *wireframe)
 
     if (getUIStyleColor (myScreenGetGtkWidget (wireframe->screen_info), "bg", "selected", &rgba))
     {
-        wireframe->red = rgba.red;
-        wireframe->green = rgba.green;
-        wireframe->blue = rgba.blue;
+        compositorSetOutlineColor (wireframe->screen_info, rgba.red, rgba.green, rgba.blue);
+    }
+    else
+    {
+        compositorSetOutlineColor (wireframe->screen_info, 0.0, 0.0, 0.0);
     }
 }
 
@@ -208,9 +170,6 @@ wireframeCreate (Client *c)
     ScreenInfo *screen_info;
     WireFrame *wireframe;
     XSetWindowAttributes attrs;
-    XVisualInfo xvisual_info;
-    Visual *xvisual;
-    int depth;
 
     g_return_val_if_fail (c != NULL, None);
 
@@ -219,32 +178,22 @@ wireframeCreate (Client *c)
     screen_info = c->screen_info;
     wireframe = g_new0 (WireFrame, 1);
     wireframe->screen_info = screen_info;
+    wireframe->xwindow = None;
     wireframe->mapped = FALSE;
     wireframe->width = 0;
     wireframe->height = 0;
-    wireframe->cr = NULL;
-    wireframe->surface = NULL;
-    wireframe->alpha = (compositorIsActive (screen_info) ? 0.5 : 1.0);
 
-    if (compositorIsActive (screen_info) &&
-        XMatchVisualInfo (myScreenGetXDisplay (screen_info), screen_info->screen,
-                          32, TrueColor, &xvisual_info))
-    {
-        xvisual = xvisual_info.visual;
-        depth = xvisual_info.depth;
-        wireframe->xcolormap = XCreateColormap (myScreenGetXDisplay (screen_info),
-                                                screen_info->xroot,
-                                                xvisual, AllocNone);
-    }
-    else
+    if (compositorIsActive (screen_info))
     {
-        xvisual = screen_info->visual;
-        depth = screen_info->depth;
-        wireframe->xcolormap = screen_info->cmap;
+        /* No window needed, the compositor draws the outline */
+        wireframeInitColor (wireframe);
+        wireframeUpdate (c, wireframe);
+
+        return (wireframe);
     }
 
     attrs.override_redirect = True;
-    attrs.colormap = wireframe->xcolormap;
+    attrs.colormap = screen_info->cmap;
     attrs.background_pixel = BlackPixel (myScreenGetXDisplay (screen_info),
                                          screen_info->screen);
     attrs.border_pixel = BlackPixel (myScreenGetXDisplay (screen_info),
@@ -252,22 +201,10 @@ wireframeCreate (Client *c)
     wireframe->xwindow = XCreateWindow (myScreenGetXDisplay (screen_info), screen_info->xroot,
                                         frameExtentX (c), frameExtentY (c),
                                         frameExtentWidth (c), frameExtentHeight (c),
-                                        0, depth, InputOutput, xvisual,
+                                        0, screen_info->depth, InputOutput, screen_info->visual,
                                         CWOverrideRedirect | CWColormap | CWBackPixel | CWBorderPixel,
                                         &attrs);
 
-    if (compositorIsActive (screen_info))
-    {
-        /* Cairo */
-        wireframeInitColor (wireframe);
-        wireframe->surface = cairo_xlib_surface_create (myScreenGetXDisplay (screen_info),
-                                                        wireframe->xwindow, xvisual,
-                                                        frameExtentWidth (c), frameExtentHeight (c));
-        wireframe->cr = cairo_create (wireframe->surface);
-        cairo_set_line_width (wireframe->cr, OUTLINE_WIDTH_CAIRO);
-        cairo_set_line_join (wireframe->cr, CAIRO_LINE_JOIN_MITER);
-    }
-
     wireframeSetHints (wireframe);
     wireframeUpdate (c, wireframe);
 
@@ -283,19 +220,14 @@ wireframeDelete (WireFrame *wireframe)
     TRACE ("entering");
 
     screen_info = wireframe->screen_info;
-    XUnmapWindow (myScreenGetXDisplay (screen_info), wireframe->xwindow);
-    if (wireframe->cr)
-    {
-        cairo_destroy (wireframe->cr);
-    }
-    if (wireframe->surface)
-    {
-        cairo_surface_destroy (wireframe->surface);
-    }
-    if (wireframe->xcolormap != screen_info->cmap)
+    if (wireframe->xwindow == None)
     {
-        XFreeColormap (myScreenGetXDisplay (screen_info), wireframe->xcolormap);
+        compositorHideOutline (screen_info);
+        g_free (wireframe);
+        return;
     }
+
+    XUnmapWindow (myScreenGetXDisplay (screen_info), wireframe->xwindow);
     XDestroyWindow (myScreenGetXDisplay (screen_info), wireframe->xwindow);
     g_free (wireframe);
 }
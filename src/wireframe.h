@@ -29,8 +29,6 @@
 #endif
 
 #include <X11/Xlib.h>
-#include <cairo.h>
-#include <cairo-xlib.h>
 #include "screen.h"
 #include "client.h"
 
@@ -44,13 +42,6 @@ struct _WireFrame
     int y;
     int width;
     int height;
-    Colormap xcolormap;
-    cairo_surface_t *surface;
-    cairo_t *cr;
-    gdouble red;
-    gdouble green;
-    gdouble blue;
-    gdouble alpha;
 };
 
 void                     wireframeUpdate                        (Client *,
@@ -48,6 +48,10 @@
 #include "frame.h"
 #include "stacking.h"
 #include "hints.h"
+#include "compositor.h"
+#include "eventtrace.h"
+#include "placement.h"
+#include "xaccount.h"
 
 static void
 workspaceGetPosition (ScreenInfo *screen_info, int n, int * row, int * col)
@@ -239,6 +243,57 @@ workspaceMove (ScreenInfo *screen_info, gint rowmod, gint colmod, Client * c, gu
     return (screen_info->current_ws != previous_ws);
 }
 
+static void
+workspaceSwitchThaw (ScreenInfo *screen_info, gboolean forced)
+{
+    if (screen_info->workspace_switch_id)
+    {
+        g_source_remove (screen_info->workspace_switch_id);
+        screen_info->workspace_switch_id = 0;
+    }
+    if (screen_info->workspace_switch_timeout_id)
+    {
+        g_source_remove (screen_info->workspace_switch_timeout_id);
+        screen_info->workspace_switch_timeout_id = 0;
+    }
+
+    compositorThaw (screen_info);
+
+    TRACE ("workspace switch to %u took %.3f ms%s", screen_info->current_ws,
+           (g_get_monotonic_time () - screen_info->workspace_switch_start) / 1000.0,
+           forced ? " (thaw forced)" : "");
+    eventTraceSpan (forced ? "workspaceSwitchForced" : "workspaceSwitch",
+                    screen_info->workspace_switch_start);
+}
+
+static gboolean
+workspaceSwitchDone (gpointer data)
+{
+    ScreenInfo *screen_info;
+
+    screen_info = (ScreenInfo *) data;
+    screen_info->workspace_switch_id = 0;
+
+    /* All the map and unmap notifications are processed by now */
+    workspaceSwitchThaw (screen_info, FALSE);
+
+    return FALSE;
+}
+
+static gboolean
+workspaceSwitchTimeout (gpointer data)
+{
+    ScreenInfo *screen_info;
+
+    screen_info = (ScreenInfo *) data;
+    screen_info->workspace_switch_timeout_id = 0;
+
+    /* The idle is starved by a busy main loop, do not stay frozen */
+    workspaceSwitchThaw (screen_info, TRUE);
+
+    return FALSE;
+}
+
 void
 workspaceSwitch (ScreenInfo *screen_info, gint new_ws, Client * c2, gboolean update_focus, guint32 timestamp)
 {
@@ -281,6 +336,24 @@ workspaceSwitch (ScreenInfo *screen_info, gint new_ws, Client * c2, gboolean upd
         return;
     }
 
+    xAccountBegin (display_info, "workspace switch");
+
+    /*
+     * Do not let the compositor paint the screen with only some of the
+     * windows mapped or unmapped, it is thawed once the main loop has
+     * processed all the resulting notifications, or after a short while
+     * at most.
+     */
+    if (screen_info->workspace_switch_id == 0)
+    {
+        screen_info->workspace_switch_start = g_get_monotonic_time ();
+        compositorFreeze (screen_info);
+        screen_info->workspace_switch_id =
+            g_idle_add_full (G_PRIORITY_DEFAULT_IDLE, workspaceSwitchDone, screen_info, NULL);
+        screen_info->workspace_switch_timeout_id =
+            g_timeout_add (WORKSPACE_SWITCH_TIMEOUT, workspaceSwitchTimeout, screen_info);
+    }
+
     screen_info->previous_ws = screen_info->current_ws;
     screen_info->current_ws = new_ws;
 
@@ -401,6 +474,15 @@ workspaceSwitch (ScreenInfo *screen_info, gint new_ws, Client * c2, gboolean upd
             clientFocusTop (screen_info, WIN_LAYER_FULLSCREEN, timestamp);
         }
     }
+
+    /*
+     * Single flush, so the notifications are queued before the thaw. The
+     * map and unmap requests of the passes above are still in the Xlib
+     * buffer at this point, the error traps around them do not sync. The
+     * round-trip is accounted to the "workspace switch" scope.
+     */
+    XSync (display_info->dpy, FALSE);
+    xAccountEnd (display_info);
 }
 
 void
@@ -538,6 +620,9 @@ workspaceUpdateArea (ScreenInfo *screen_info)
 
     TRACE ("entering");
 
+    /* Called whenever a client with struts is shown or hidden */
+    placementInvalidateWorkArea (screen_info);
+
     display_info = screen_info->display_info;
     prev_top = screen_info->margins[STRUTS_TOP];
     prev_left = screen_info->margins[STRUTS_LEFT];
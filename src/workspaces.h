@@ -38,6 +38,11 @@
 #include "placement.h"
 #include "client.h"
 
+/* Longest the compositor stays frozen when the main loop is kept busy */
+#ifndef WORKSPACE_SWITCH_TIMEOUT
+#define WORKSPACE_SWITCH_TIMEOUT        100  /* ms */
+#endif
+
 gboolean                workspaceMove                           (ScreenInfo *,
                                                                  int,
                                                                  int,
@@ -0,0 +1,404 @@
+/*      $Id$
+
+        This program is free software; you can redistribute it and/or modify
+        it under the terms of the GNU General Public License as published by
+        the Free Software Foundation; either version 2, or (at your option)
+        any later version.
+
+        This program is distributed in the hope that it will be useful,
+        but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+        GNU General Public License for more details.
+
+        You should have received a copy of the GNU General Public License
+        along with this program; if not, write to the Free Software
+        Foundation, Inc., Inc., 51 Franklin Street, Fifth Floor, Boston,
+        MA 02110-1301, USA.
+
+
+        xfwm4    - (c) 2002-2022 Olivier Fourdan
+
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <string.h>
+
+#include <X11/Xlib.h>
+#include <glib.h>
+#include <libxfce4util/libxfce4util.h>
+
+#include "display.h"
+
+#include "xaccount.h"
+
+/*
+ * Requests and round-trips are counted on the connection itself, using
+ * the Xlib after function which runs once each request is issued. A
+ * request is known to have been a round-trip when the server already
+ * processed it by the time the request returns, i.e. Xlib waited for
+ * its reply.
+ *
+ * Operations are whatever runs between xAccountBegin() and xAccountEnd().
+ * Operations may nest, in which case the outer operation accounts for
+ * the inner one as well. Each round-trip is attributed to the innermost
+ * operation running when it is made, or to "other" outside of any.
+ */
+
+#define XACCOUNT_MAX_SUBSYSTEMS  32
+#define XACCOUNT_MAX_DEPTH       8
+#define XACCOUNT_OTHER           0
+
+typedef struct _XAccountStats XAccountStats;
+struct _XAccountStats
+{
+    const gchar *operation;
+    guint subsystem;
+    guint64 count;
+    guint64 requests;
+    guint64 max_requests;
+    guint64 round_trips;
+    guint64 max_round_trips;
+    guint64 subsystems[XACCOUNT_MAX_SUBSYSTEMS];
+};
+
+typedef struct _XAccountFrame XAccountFrame;
+struct _XAccountFrame
+{
+    XAccountStats *stats;
+    guint64 requests;
+    guint64 round_trips;
+    guint64 subsystems[XACCOUNT_MAX_SUBSYSTEMS];
+};
+
+static gboolean account_enabled = FALSE;
+static gchar *account_dump_file = NULL;
+static Display *account_dpy = NULL;
+static int (*account_previous_after) (Display *) = NULL;
+static gulong account_last_request = 0;
+static GHashTable *account_operations = NULL;
+static const gchar *account_names[XACCOUNT_MAX_SUBSYSTEMS];
+static guint account_nb_subsystems = 0;
+static guint64 account_requests = 0;
+static guint64 account_round_trips = 0;
+static guint64 account_subsystems[XACCOUNT_MAX_SUBSYSTEMS];
+static XAccountFrame account_frames[XACCOUNT_MAX_DEPTH];
+static gint account_depth = 0;
+
+static guint
+xAccountLookupSubsystem (const gchar *name)
+{
+    guint i;
+
+    for (i = 0; i < account_nb_subsystems; i++)
+    {
+        if (g_strcmp0 (account_names[i], name) == 0)
+        {
+            return i;
+        }
+    }
+    if (account_nb_subsystems == XACCOUNT_MAX_SUBSYSTEMS)
+    {
+        /* Out of slots */
+        return XACCOUNT_OTHER;
+    }
+    account_names[account_nb_subsystems] = name;
+
+    return account_nb_subsystems++;
+}
+
+static int
+xAccountAfterFunction (Display *dpy)
+{
+    gulong request, processed;
+    guint subsystem;
+
+    request = NextRequest (dpy) - 1;
+    processed = LastKnownRequestProcessed (dpy);
+
+    if (request != account_last_request)
+    {
+        account_requests += request - account_last_request;
+        account_last_request = request;
+
+        /* Replies (and errors) carry the sequence of the request they answer */
+        if (processed == request)
+        {
+            subsystem = XACCOUNT_OTHER;
+            if (account_depth > 0)
+            {
+                subsystem = account_frames[MIN (account_depth, XACCOUNT_MAX_DEPTH) - 1].stats->subsystem;
+            }
+            account_round_trips++;
+            account_subsystems[subsystem]++;
+        }
+    }
+    if (account_previous_after)
+    {
+        return (*account_previous_after) (dpy);
+    }
+
+    return 0;
+}
+
+gboolean
+xAccountInit (const gchar *dump_file)
+{
+    g_return_val_if_fail (account_operations == NULL, FALSE);
+
+    account_operations = g_hash_table_new_full (g_str_hash, g_str_equal, NULL, g_free);
+    account_nb_subsystems = 0;
+    xAccountLookupSubsystem ("other");
+    account_dump_file = g_strdup (dump_file);
+    account_enabled = TRUE;
+
+    return TRUE;
+}
+
+void
+xAccountInitDisplay (DisplayInfo *display_info)
+{
+    if (G_LIKELY (!account_enabled))
+    {
+        return;
+    }
+
+    g_return_if_fail (display_info != NULL);
+    g_return_if_fail (account_dpy == NULL);
+
+    account_dpy = display_info->dpy;
+    account_last_request = NextRequest (account_dpy) - 1;
+    account_previous_after = XSetAfterFunction (account_dpy, xAccountAfterFunction);
+}
+
+gboolean
+xAccountIsEnabled (void)
+{
+    return account_enabled;
+}
+
+guint64
+xAccountGetRequests (void)
+{
+    return account_requests;
+}
+
+guint64
+xAccountGetRoundTrips (void)
+{
+    return account_round_trips;
+}
+
+void
+xAccountBegin (DisplayInfo *display_info, const gchar *operation)
+{
+    XAccountFrame *frame;
+    XAccountStats *stats;
+
+    if (G_LIKELY (!account_enabled))
+    {
+        return;
+    }
+
+    g_return_if_fail (display_info != NULL);
+
+    /* Keep counting the depth so that begin and end remain balanced */
+    account_depth++;
+    if (account_depth > XACCOUNT_MAX_DEPTH)
+    {
+        return;
+    }
+
+    stats = g_hash_table_lookup (account_operations, operation);
+    if (!stats)
+    {
+        stats = g_new0 (XAccountStats, 1);
+        stats->operation = operation;
+        stats->subsystem = xAccountLookupSubsystem (operation);
+        g_hash_table_insert (account_operations, (gpointer) operation, stats);
+    }
+
+    frame = &account_frames[account_depth - 1];
+    frame->stats = stats;
+    frame->requests = account_requests;
+    frame->round_trips = account_round_trips;
+    memcpy (frame->subsystems, account_subsystems, sizeof (account_subsystems));
+}
+
+void
+xAccountEnd (DisplayInfo *display_info)
+{
+    XAccountFrame *frame;
+    XAccountStats *stats;
+    guint64 requests, round_trips;
+    guint i;
+
+    if (G_LIKELY (!account_enabled))
+    {
+        return;
+    }
+
+    g_return_if_fail (display_info != NULL);
+    g_return_if_fail (account_depth > 0);
+
+    account_depth--;
+    if (account_depth >= XACCOUNT_MAX_DEPTH)
+    {
+        return;
+    }
+
+    frame = &account_frames[account_depth];
+    stats = frame->stats;
+    requests = account_requests - frame->requests;
+    round_trips = account_round_trips - frame->round_trips;
+
+    stats->count++;
+    stats->requests += requests;
+    stats->max_requests = MAX (stats->max_requests, requests);
+    stats->round_trips += round_trips;
+    stats->max_round_trips = MAX (stats->max_round_trips, round_trips);
+    for (i = 0; i < account_nb_subsystems; i++)
+    {
+        stats->subsystems[i] += account_subsystems[i] - frame->subsystems[i];
+    }
+}
+
+static void
+xAccountDumpFile (void)
+{
+    GHashTableIter iter;
+    XAccountStats *stats;
+    GString *dump;
+    GError *error;
+    gchar *name;
+    guint i;
+
+    /* One record per line, "key=value" fields, for scripts to assert on */
+    dump = g_string_new (NULL);
+    g_string_append_printf (dump, "total requests=%" G_GUINT64_FORMAT
+                            " round_trips=%" G_GUINT64_FORMAT "\n",
+                            account_requests, account_round_trips);
+    for (i = 0; i < account_nb_subsystems; i++)
+    {
+        g_string_append_printf (dump, "subsystem name=%s round_trips=%" G_GUINT64_FORMAT "\n",
+                                account_names[i], account_subsystems[i]);
+    }
+
+    g_hash_table_iter_init (&iter, account_operations);
+    while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &stats))
+    {
+        if (stats->count == 0)
+        {
+            continue;
+        }
+
+        name = g_strdelimit (g_strdup (stats->operation), " =", '-');
+        g_string_append_printf (dump, "operation name=%s count=%" G_GUINT64_FORMAT
+                                " requests=%" G_GUINT64_FORMAT
+                                " max_requests=%" G_GUINT64_FORMAT
+                                " round_trips=%" G_GUINT64_FORMAT
+                                " max_round_trips=%" G_GUINT64_FORMAT "\n",
+                                name, stats->count,
+                                stats->requests, stats->max_requests,
+                                stats->round_trips, stats->max_round_trips);
+        g_free (name);
+    }
+
+    error = NULL;
+    if (!g_file_set_contents (account_dump_file, dump->str, dump->len, &error))
+    {
+        g_warning ("Cannot write X requests statistics: %s", error->message);
+        g_error_free (error);
+    }
+    g_string_free (dump, TRUE);
+}
+
+void
+xAccountDump (void)
+{
+    GHashTableIter iter;
+    XAccountStats *stats;
+    GString *subsystems;
+    guint i;
+
+    if (!account_enabled)
+    {
+        return;
+    }
+
+    if (account_dump_file)
+    {
+        xAccountDumpFile ();
+    }
+
+    g_printerr ("xfwm4 X requests, %" G_GUINT64_FORMAT " in total, "
+                "round-trips, %" G_GUINT64_FORMAT " in total:\n",
+                account_requests, account_round_trips);
+    for (i = 0; i < account_nb_subsystems; i++)
+    {
+        g_printerr ("  %-16s %" G_GUINT64_FORMAT "\n", account_names[i], account_subsystems[i]);
+    }
+
+    g_printerr ("xfwm4 X requests and round-trips per operation:\n");
+    subsystems = g_string_new (NULL);
+    g_hash_table_iter_init (&iter, account_operations);
+    while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &stats))
+    {
+        if (stats->count == 0)
+        {
+            continue;
+        }
+
+        g_string_truncate (subsystems, 0);
+        for (i = 0; i < account_nb_subsystems; i++)
+        {
+            if (stats->subsystems[i])
+            {
+                g_string_append_printf (subsystems, " %s:%" G_GUINT64_FORMAT,
+                                        account_names[i], stats->subsystems[i]);
+            }
+        }
+
+        g_printerr ("  %-16s n=%" G_GUINT64_FORMAT
+                    " requests=%.1f (max %" G_GUINT64_FORMAT ")"
+                    " round-trips=%.1f (max %" G_GUINT64_FORMAT ") |%s\n",
+                    stats->operation, stats->count,
+                    (gdouble) stats->requests / stats->count, stats->max_requests,
+                    (gdouble) stats->round_trips / stats->count, stats->max_round_trips,
+                    subsystems->str);
+    }
+    g_string_free (subsystems, TRUE);
+}
+
+void
+xAccountClose (void)
+{
+    guint i;
+
+    if (!account_enabled)
+    {
+        return;
+    }
+
+    xAccountDump ();
+
+    if (account_dpy)
+    {
+        XSetAfterFunction (account_dpy, account_previous_after);
+        account_dpy = NULL;
+        account_previous_after = NULL;
+    }
+
+    g_hash_table_destroy (account_operations);
+    account_operations = NULL;
+    for (i = 0; i < account_nb_subsystems; i++)
+    {
+        account_names[i] = NULL;
+    }
+    account_nb_subsystems = 0;
+    g_free (account_dump_file);
+    account_dump_file = NULL;
+    account_enabled = FALSE;
+}
@@ -0,0 +1,909 @@
+/*      $Id$
+
+        This program is free software; you can redistribute it and/or modify
+        it under the terms of the GNU General Public License as published by
+        the Free Software Foundation; either version 2, or (at your option)
+        any later version.
+
+        This program is distributed in the hope that it will be useful,
+        but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+        GNU General Public License for more details.
+
+        You should have received a copy of the GNU General Public License
+        along with this program; if not, write to the Free Software
+        Foundation, Inc., Inc., 51 Franklin Street, Fifth Floor, Boston,
+        MA 02110-1301, USA.
+
+
+        Original XPM load routines from gdk-pixbuf:
+
+        Copyright (C) 1999 Mark Crichton
+        Copyright (C) 1999 The Free Software Foundation
+
+        Authors: Mark Crichton <crichton@gimp.org>
+                 Federico Mena-Quintero <federico@gimp.org>
+
+        A specific version of the gdk-pixbuf routines are required to support
+        XPM color substitution used by the themes to apply gtk+ colors.
+
+        oroborus - (c) 2001 Ken Lynch
+        xfwm4    - (c) 2002-2011 Olivier Fourdan
+
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <glib.h>
+#include <gdk-pixbuf/gdk-pixbuf.h>
+#include <libxfce4util/libxfce4util.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "xpmload.h"
+#include "xpm-color-table.h"
+
+#ifndef XPM_COLOR_TABLE_MAX_SEED
+#define XPM_COLOR_TABLE_MAX_SEED 1024
+#endif
+
+#ifndef XPM_COLOR_TABLE_TRIES
+#define XPM_COLOR_TABLE_TRIES 4
+#endif
+
+enum buf_op
+{
+    op_header,
+    op_cmap,
+    op_body
+};
+
+typedef struct
+{
+    gchar *color_string;
+    guint16 red;
+    guint16 green;
+    guint16 blue;
+    gint transparent;
+    guint hash;
+    /* Entry holding the pixel, the last one of duplicate keys */
+    gint pixel_index;
+    guchar pixel[4];
+}
+XPMColor;
+
+typedef struct
+{
+    gint *slots;
+    guint *seeds;
+    guint mask;
+    guint bucket_mask;
+}
+XPMColorTable;
+
+struct file_handle
+{
+    const gchar *pos;
+    const gchar *end;
+    gchar *buffer;
+    gsize buffer_size;
+};
+
+/* The following 2 routines (parse_color, find_color) come from Tk, via the Win32
+ * port of GDK. The licensing terms on these (longer than the functions) is:
+ *
+ * This software is copyrighted by the Regents of the University of
+ * California, Sun Microsystems, Inc., and other parties.  The following
+ * terms apply to all files associated with the software unless explicitly
+ * disclaimed in individual files.
+ *
+ * The authors hereby grant permission to use, copy, modify, distribute,
+ * and license this software and its documentation for any purpose, provided
+ * that existing copyright notices are retained in all copies and that this
+ * notice is included verbatim in any distributions. No written agreement,
+ * license, or royalty fee is required for any of the authorized uses.
+ * Modifications to this software may be copyrighted by their authors
+ * and need not follow the licensing terms described here, provided that
+ * the new terms are clearly indicated on the first page of each file where
+ * they apply.
+ *
+ * IN NO EVENT SHALL THE AUTHORS OR DISTRIBUTORS BE LIABLE TO ANY PARTY
+ * FOR DIRECT, INDIRECT, SPECIAL, INCIDENTAL, OR CONSEQUENTIAL DAMAGES
+ * ARISING OUT OF THE USE OF THIS SOFTWARE, ITS DOCUMENTATION, OR ANY
+ * DERIVATIVES THEREOF, EVEN IF THE AUTHORS HAVE BEEN ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * THE AUTHORS AND DISTRIBUTORS SPECIFICALLY DISCLAIM ANY WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, AND NON-INFRINGEMENT.  THIS SOFTWARE
+ * IS PROVIDED ON AN "AS IS" BASIS, AND THE AUTHORS AND DISTRIBUTORS HAVE
+ * NO OBLIGATION TO PROVIDE MAINTENANCE, SUPPORT, UPDATES, ENHANCEMENTS, OR
+ * MODIFICATIONS.
+ *
+ * GOVERNMENT USE: If you are acquiring this software on behalf of the
+ * U.S. government, the Government shall have only "Restricted Rights"
+ * in the software and related documentation as defined in the Federal
+ * Acquisition Regulations (FARs) in Clause 52.227.19 (c) (2).  If you
+ * are acquiring the software on behalf of the Department of Defense, the
+ * software shall be classified as "Commercial Computer Software" and the
+ * Government shall have only "Restricted Rights" as defined in Clause
+ * 252.227-7013 (c) (1) of DFARs.  Notwithstanding the foregoing, the
+ * authors grant the U.S. Government and others acting in its behalf
+ * permission to use and distribute the software in accordance with the
+ * terms specified in this license.
+ */
+
+static int
+compare_xcolor_entries (const void *a, const void *b)
+{
+    return g_ascii_strcasecmp ((const char *) a,
+                               color_names + ((const XPMColorEntry *) b)->name_offset);
+}
+
+static gboolean
+find_color(const char *name, XPMColor *colorPtr)
+{
+    XPMColorEntry *found;
+
+    found = bsearch (name, xColors, G_N_ELEMENTS (xColors), sizeof (XPMColorEntry),
+                     compare_xcolor_entries);
+    if (found == NULL)
+    {
+        return FALSE;
+    }
+
+    colorPtr->red   = (found->red   * 0xFFFF) / 0xFF;
+    colorPtr->green = (found->green * 0xFFFF) / 0xFF;
+    colorPtr->blue  = (found->blue  * 0xFFFF) / 0xFF;
+
+    return TRUE;
+}
+
+static gboolean
+parse_color (const char *spec, XPMColor   *colorPtr)
+{
+    if (spec[0] == '#')
+    {
+        char fmt[16];
+        int i, red, green, blue;
+
+        if ((i = strlen (spec + 1)) % 3)
+        {
+                return FALSE;
+        }
+        i /= 3;
+
+        g_snprintf (fmt, 16, "%%%dx%%%dx%%%dx", i, i, i);
+
+        if (sscanf (spec + 1, fmt, &red, &green, &blue) != 3)
+        {
+            return FALSE;
+        }
+        if (i == 4)
+        {
+            colorPtr->red   = red;
+            colorPtr->green = green;
+            colorPtr->blue  = blue;
+        }
+        else if (i == 1)
+        {
+            colorPtr->red   = (red   * 0xFFFF) / 0xF;
+            colorPtr->green = (green * 0xFFFF) / 0xF;
+            colorPtr->blue  = (blue  * 0xFFFF) / 0xF;
+        }
+        else if (i == 2)
+        {
+            colorPtr->red   = (red   * 0xFFFF) / 0xFF;
+            colorPtr->green = (green * 0xFFFF) / 0xFF;
+            colorPtr->blue  = (blue  * 0xFFFF) / 0xFF;
+        }
+        else /* if (i == 3) */
+        {
+            colorPtr->red   = (red   * 0xFFFF) / 0xFFF;
+            colorPtr->green = (green * 0xFFFF) / 0xFFF;
+            colorPtr->blue  = (blue  * 0xFFFF) / 0xFFF;
+        }
+    }
+    else
+    {
+        if (!find_color(spec, colorPtr))
+        {
+            return FALSE;
+        }
+    }
+    return TRUE;
+}
+
+static gboolean
+xpm_seek_string (struct file_handle *h, const gchar *str)
+{
+    const gchar *p, *word;
+    gsize len;
+
+    len = strlen (str);
+    p = h->pos;
+    while (p < h->end)
+    {
+        for (; p < h->end && g_ascii_isspace (*p); p++)
+        {
+        }
+        for (word = p; p < h->end && !g_ascii_isspace (*p); p++)
+        {
+        }
+        if (((gsize) (p - word) == len) && (memcmp (word, str, len) == 0))
+        {
+            h->pos = p;
+            return TRUE;
+        }
+    }
+    h->pos = h->end;
+
+    return FALSE;
+}
+
+static gboolean
+xpm_seek_char (struct file_handle *h, gchar c)
+{
+    const gchar *p;
+    gchar b;
+
+    p = h->pos;
+    while (p < h->end)
+    {
+        b = *p++;
+        if (c != b && b == '/')
+        {
+            if ((p < h->end) && (*p == '*'))
+            {   /* we have a comment */
+                for (p++; p + 1 < h->end && !(p[0] == '*' && p[1] == '/'); p++)
+                {
+                }
+                if (p + 1 >= h->end)
+                {
+                    break;
+                }
+                p += 2;
+            }
+        }
+        else if (c == b)
+        {
+            h->pos = p;
+            return TRUE;
+        }
+    }
+    h->pos = h->end;
+
+    return FALSE;
+}
+
+static gboolean
+xpm_read_string (struct file_handle *h, const gchar **string, gsize *length)
+{
+    const gchar *start, *stop;
+
+    start = memchr (h->pos, '"', h->end - h->pos);
+    if (!start)
+    {
+        h->pos = h->end;
+        return FALSE;
+    }
+    start++;
+
+    stop = memchr (start, '"', h->end - start);
+    if (!stop)
+    {
+        h->pos = h->end;
+        return FALSE;
+    }
+
+    /* Strings point into the mapped file, they are not nul terminated */
+    *string = start;
+    *length = stop - start;
+    h->pos = stop + 1;
+
+    return TRUE;
+}
+
+static guint
+xpm_color_hash (const gchar *key, gint cpp)
+{
+    guint hash;
+    gint i;
+
+    /* FNV-1a */
+    hash = 2166136261u;
+    for (i = 0; i < cpp; i++)
+    {
+        hash = (hash ^ (guchar) key[i]) * 16777619u;
+    }
+
+    return hash;
+}
+
+static inline guint
+xpm_color_mix (guint hash, guint seed)
+{
+    /* Murmur3 finalizer, so that every bit of the key reaches the low bits */
+    hash ^= seed * 0x9e3779b9u;
+    hash ^= hash >> 16;
+    hash *= 0x85ebca6bu;
+    hash ^= hash >> 13;
+    hash *= 0xc2b2ae35u;
+    hash ^= hash >> 16;
+
+    return hash;
+}
+
+static void
+xpm_color_table_free (XPMColorTable *table)
+{
+    g_free (table->slots);
+    g_free (table->seeds);
+    table->slots = NULL;
+    table->seeds = NULL;
+}
+
+/*
+ * Places the keys of a bucket with the first seed that sends all of them
+ * to free slots. Slots taken are undone if no seed works.
+ */
+static gboolean
+xpm_color_table_place (XPMColorTable *table, XPMColor *colors, gint *next,
+                       gint first, guint bucket)
+{
+    guint seed, slot;
+    gint index, placed;
+
+    for (seed = 1; seed <= XPM_COLOR_TABLE_MAX_SEED; seed++)
+    {
+        for (index = first; index >= 0; index = next[index])
+        {
+            slot = xpm_color_mix (colors[index].hash, seed) & table->mask;
+            if (table->slots[slot] >= 0)
+            {
+                break;
+            }
+            table->slots[slot] = index;
+        }
+        if (index < 0)
+        {
+            table->seeds[bucket] = seed;
+            return TRUE;
+        }
+        for (placed = first; placed != index; placed = next[placed])
+        {
+            slot = xpm_color_mix (colors[placed].hash, seed) & table->mask;
+            table->slots[slot] = -1;
+        }
+    }
+
+    return FALSE;
+}
+
+static gboolean
+xpm_color_table_try (XPMColorTable *table, XPMColor *colors, gint n_col, gint cpp, guint size)
+{
+    gint *first, *next, *count;
+    gint cnt, index, max_count;
+    guint bucket, n_buckets;
+    gboolean done;
+
+    n_buckets = size / 2;
+    table->mask = size - 1;
+    table->bucket_mask = n_buckets - 1;
+    table->slots = g_new (gint, size);
+    memset (table->slots, 0xff, size * sizeof (gint));
+    table->seeds = g_new0 (guint, n_buckets);
+
+    first = g_new (gint, n_buckets);
+    memset (first, 0xff, n_buckets * sizeof (gint));
+    count = g_new0 (gint, n_buckets);
+    next = g_new (gint, n_col);
+    max_count = 0;
+
+    /* First level, spread the keys over the buckets */
+    for (cnt = 0; cnt < n_col; cnt++)
+    {
+        colors[cnt].hash = xpm_color_hash (colors[cnt].color_string, cpp);
+        bucket = xpm_color_mix (colors[cnt].hash, 0) & table->bucket_mask;
+        for (index = first[bucket]; index >= 0; index = next[index])
+        {
+            if (memcmp (colors[index].color_string, colors[cnt].color_string, cpp) == 0)
+            {
+                break;
+            }
+        }
+        if (index >= 0)
+        {
+            /* Duplicate key, the last definition wins */
+            colors[index].pixel_index = cnt;
+            continue;
+        }
+        colors[cnt].pixel_index = cnt;
+        next[cnt] = first[bucket];
+        first[bucket] = cnt;
+        count[bucket]++;
+        max_count = MAX (max_count, count[bucket]);
+    }
+
+    /* Second level, largest buckets first while there are most free slots */
+    done = TRUE;
+    for (; max_count > 0 && done; max_count--)
+    {
+        for (bucket = 0; bucket < n_buckets && done; bucket++)
+        {
+            if (count[bucket] == max_count)
+            {
+                done = xpm_color_table_place (table, colors, next, first[bucket], bucket);
+            }
+        }
+    }
+
+    g_free (first);
+    g_free (count);
+    g_free (next);
+    if (!done)
+    {
+        xpm_color_table_free (table);
+    }
+
+    return done;
+}
+
+/*
+ * The colormap is known before the first pixel is read, so the table is
+ * a perfect hash of it: every key has a slot of its own and a lookup is
+ * two hashes and one compare, with no probing.
+ */
+static gboolean
+xpm_color_table_build (XPMColorTable *table, XPMColor *colors, gint n_col, gint cpp)
+{
+    guint size;
+    gint i;
+
+    size = 16;
+    while (size < (guint) n_col * 2)
+    {
+        size <<= 1;
+    }
+    /* Seeds run out when slots are scarce, give it more room then */
+    for (i = 0; i < XPM_COLOR_TABLE_TRIES; i++, size <<= 1)
+    {
+        if (xpm_color_table_try (table, colors, n_col, cpp, size))
+        {
+            return TRUE;
+        }
+    }
+
+    return FALSE;
+}
+
+static XPMColor *
+xpm_color_table_lookup (XPMColorTable *table, XPMColor *colors, const gchar *key, gint cpp)
+{
+    guint hash, bucket, slot;
+    gint index;
+
+    hash = xpm_color_hash (key, cpp);
+    bucket = xpm_color_mix (hash, 0) & table->bucket_mask;
+    slot = xpm_color_mix (hash, table->seeds[bucket]) & table->mask;
+    index = table->slots[slot];
+    if (index >= 0 && memcmp (colors[index].color_string, key, cpp) == 0)
+    {
+        return &colors[colors[index].pixel_index];
+    }
+
+    return NULL;
+}
+
+static const gchar *
+search_color_symbol (gchar *symbol, xfwmColorSymbol *color_sym)
+{
+    xfwmColorSymbol *i;
+
+    i = color_sym;
+    while (i && i->name)
+    {
+        if (!g_ascii_strcasecmp (i->name, symbol))
+        {
+            return i->value;
+        }
+        ++i;
+    }
+    return NULL;
+}
+
+static void
+safe_strncpy (char *dst, const char *src, size_t size)
+{
+    size_t len = strnlen (src, size);
+    memcpy (dst, src, len);
+    /* Add NULL terminator */
+    dst[len] = '\0';
+}
+
+static gchar *
+xpm_extract_color (const gchar *buffer, xfwmColorSymbol *color_sym)
+{
+    const gchar *p;
+    gchar word[129], color[129], current_color[129];
+    gchar *r;
+    gint new_key;
+    gint key;
+    gint current_key;
+    gint space;
+
+    p = &buffer[0];
+    space = 128;
+    word[0] = '\0';
+    color[0] = '\0';
+    current_color[0] = '\0';
+    current_key = 1;
+    key = 0;
+
+    while (1)
+    {
+        /* skip whitespace */
+        for (; *p != '\0' && g_ascii_isspace (*p); p++)
+        {
+        }
+        /* copy word */
+        for (r = word;
+                 (*p != '\0') &&
+                 (!g_ascii_isspace (*p)) &&
+                 (r - word < (gint) sizeof (word) - 1);
+             p++, r++)
+        {
+                *r = *p;
+        }
+        *r = '\0';
+        if (*word == '\0')
+        {
+            if (color[0] == '\0')  /* incomplete colormap entry */
+            {
+                return NULL;
+            }
+            else  /* end of entry, still store the last color */
+            {
+                new_key = 1;
+            }
+        }
+        else if (key > 0 && color[0] == '\0')  /* next word must be a color name part */
+        {
+                new_key = 0;
+        }
+        else
+        {
+            if (strcmp (word, "s") == 0)
+            {
+                new_key = 5;
+            }
+            else if (strcmp (word, "c") == 0)
+            {
+                new_key = 4;
+            }
+            else if (strcmp (word, "g") == 0)
+            {
+                new_key = 3;
+            }
+            else if (strcmp (word, "g4") == 0)
+            {
+                new_key = 2;
+            }
+            else if (strcmp (word, "m") == 0)
+            {
+                new_key = 1;
+            }
+            else
+            {
+                new_key = 0;
+            }
+        }
+        if (new_key == 0)
+        {  /* word is a color name part */
+            if (key == 0)  /* key expected */
+            {
+                return NULL;
+            }
+            /* accumulate color name */
+            if (color[0] != '\0')
+            {
+                strncat (color, " ", space);
+                space -= MIN (space, 1);
+            }
+            strncat (color, word, space);
+            space -= MIN (space, (gint) strlen (word));
+        }
+        else if (key == 5)
+        {
+            const gchar *new_color = NULL;
+            new_color = search_color_symbol (color, color_sym);
+            if (new_color)
+            {
+                current_key = key;
+                safe_strncpy (current_color, new_color, sizeof (current_color) - 1);
+            }
+            space = 128;
+            color[0] = '\0';
+            key = new_key;
+            if (*p == '\0')
+            {
+                break;
+            }
+        }
+        else
+        {  /* word is a key */
+            if (key > current_key)
+            {
+                current_key = key;
+                safe_strncpy (current_color, color, sizeof (current_color) - 1);
+            }
+            space = 128;
+            color[0] = '\0';
+            key = new_key;
+            if (*p == '\0')
+            {
+                break;
+            }
+        }
+    }
+    if (current_key > 1)
+    {
+        return g_strdup (current_color);
+    }
+    else
+    {
+        return NULL;
+    }
+}
+
+static const gchar *
+file_buffer (enum buf_op op, gpointer handle, gsize *length)
+{
+    struct file_handle *h;
+    const gchar *string;
+
+    h = handle;
+    switch (op)
+    {
+        case op_header:
+            if (xpm_seek_string (h, "XPM") != TRUE)
+            {
+                break;
+            }
+            if (xpm_seek_char (h, '{') != TRUE)
+            {
+                break;
+            }
+            /* Fall through to the next xpm_seek_char. */
+            G_GNUC_FALLTHROUGH;
+
+        case op_cmap:
+            if (xpm_seek_char (h, '"'))
+            {
+                h->pos--;
+            }
+            if (!xpm_read_string (h, &string, length))
+            {
+                return NULL;
+            }
+            /* Header and colormap are parsed as C strings, copy them */
+            if (*length >= h->buffer_size)
+            {
+                h->buffer_size = MAX (*length + 1, 2 * h->buffer_size);
+                h->buffer = g_realloc (h->buffer, h->buffer_size);
+            }
+            memcpy (h->buffer, string, *length);
+            h->buffer[*length] = '\0';
+            return h->buffer;
+
+        case op_body:
+            /* Pixels are read in place */
+            if (!xpm_read_string (h, &string, length))
+            {
+                return NULL;
+            }
+            return string;
+
+        default:
+            g_assert_not_reached ();
+    }
+
+    return NULL;
+}
+
+/* This function does all the work. */
+static GdkPixbuf *
+pixbuf_create_from_xpm (gpointer handle, xfwmColorSymbol *color_sym)
+{
+    const gchar *buffer;
+    gchar *name_buf;
+    gint w, h, n_col, cpp, items;
+    gint cnt, ycnt, wbytes, n;
+    gsize length;
+    XPMColorTable color_table;
+    XPMColor *colors, *color, *fallbackcolor;
+    guchar *pixtmp;
+    GdkPixbuf *pixbuf;
+
+    fallbackcolor = NULL;
+
+    buffer = file_buffer (op_header, handle, &length);
+    if (!buffer)
+    {
+        g_warning ("Cannot read Pixmap header");
+        return NULL;
+    }
+    items = sscanf (buffer, "%d %d %d %d", &w, &h, &n_col, &cpp);
+
+    if (items != 4)
+    {
+        g_warning ("Pixmap definition contains invalid number attributes (expecting at least 4, got %i)", items);
+        return NULL;
+    }
+
+    if ((w <= 0) ||
+        (h <= 0) ||
+        (cpp <= 0) ||
+        (cpp >= 32) ||
+        (n_col <= 0) ||
+        (n_col >= G_MAXINT / (cpp + 1)) ||
+        (n_col >= G_MAXINT / (gint) sizeof (XPMColor)))
+    {
+        g_warning ("Pixmap definition contains invalid attributes");
+        return NULL;
+    }
+
+    name_buf = g_try_malloc0 (n_col * (cpp + 1));
+    if (!name_buf) {
+        g_warning ("Cannot allocate buffer");
+        return NULL;
+    }
+
+    colors = (XPMColor *) g_try_malloc0 (sizeof (XPMColor) * n_col);
+    if (!colors)
+    {
+        g_free (name_buf);
+        g_warning ("Cannot allocate colors for Pixmap");
+        return NULL;
+    }
+
+    for (cnt = 0; cnt < n_col; cnt++)
+    {
+        gchar *color_name;
+
+        buffer = file_buffer (op_cmap, handle, &length);
+        if (!buffer)
+        {
+            g_free (name_buf);
+            g_free (colors);
+            g_warning ("Cannot load colormap attributes");
+            return NULL;
+        }
+
+        color = &colors[cnt];
+        color->color_string = &name_buf[cnt * (cpp + 1)];
+        strncpy (color->color_string, buffer, cpp);
+        color->color_string[cpp] = 0;
+        buffer += strlen (color->color_string);
+        color->transparent = FALSE;
+
+        color_name = xpm_extract_color (buffer, color_sym);
+
+        if ((color_name == NULL) ||
+            (g_ascii_strcasecmp (color_name, "None") == 0) ||
+            (parse_color (color_name, color) == FALSE))
+        {
+            color->transparent = TRUE;
+            color->red = 0;
+            color->green = 0;
+            color->blue = 0;
+        }
+
+        g_free (color_name);
+
+        /* Bytes as stored in the RGBA pixbuf, transparent pixels are all zeroes */
+        color->pixel[0] = color->red   >> 8;
+        color->pixel[1] = color->green >> 8;
+        color->pixel[2] = color->blue  >> 8;
+        color->pixel[3] = color->transparent ? 0 : 0xFF;
+
+        if (cnt == 0)
+        {
+            fallbackcolor = color;
+        }
+    }
+
+    /* The table is used for fast lookups of color from chars */
+    if (!xpm_color_table_build (&color_table, colors, n_col, cpp))
+    {
+        g_free (name_buf);
+        g_free (colors);
+        g_warning ("Cannot build the color table for Pixmap");
+        return NULL;
+    }
+
+    pixbuf = gdk_pixbuf_new (GDK_COLORSPACE_RGB, TRUE, 8, w, h);
+
+    if (!pixbuf)
+    {
+        xpm_color_table_free (&color_table);
+        g_free (colors);
+        g_free (name_buf);
+        g_warning ("Cannot allocate Pixbuf");
+        return NULL;
+    }
+
+    wbytes = w * cpp;
+
+    for (ycnt = 0; ycnt < h; ycnt++)
+    {
+        pixtmp = gdk_pixbuf_get_pixels (pixbuf) + ycnt * gdk_pixbuf_get_rowstride(pixbuf);
+
+        buffer = file_buffer (op_body, handle, &length);
+        if ((!buffer) || ((gsize) wbytes > length))
+        {
+            continue;
+        }
+
+        color = NULL;
+        for (n = 0; n < wbytes; n += cpp)
+        {
+            /* Runs of the same color are the common case */
+            if (!color || memcmp (&buffer[n], &buffer[n - cpp], cpp) != 0)
+            {
+                color = xpm_color_table_lookup (&color_table, colors, &buffer[n], cpp);
+
+                /* Bad XPM...punt */
+                if (!color)
+                {
+                    color = fallbackcolor;
+                }
+            }
+
+            memcpy (pixtmp, color->pixel, 4);
+            pixtmp += 4;
+        }
+    }
+
+    xpm_color_table_free (&color_table);
+    g_free (colors);
+    g_free (name_buf);
+
+    return pixbuf;
+}
+
+
+GdkPixbuf *
+xpmImageLoad (const gchar *filename, xfwmColorSymbol *color_sym)
+{
+    GMappedFile *mapped;
+    GdkPixbuf *pixbuf;
+    struct file_handle h;
+
+    TRACE ("file %s", filename);
+
+    mapped = g_mapped_file_new (filename, FALSE, NULL);
+    if (!mapped)
+    {
+        return NULL;
+    }
+
+    if (g_mapped_file_get_length (mapped) == 0)
+    {
+        g_mapped_file_unref (mapped);
+        return NULL;
+    }
+
+    memset (&h, 0, sizeof (h));
+    h.pos = g_mapped_file_get_contents (mapped);
+    h.end = h.pos + g_mapped_file_get_length (mapped);
+    pixbuf = pixbuf_create_from_xpm (&h, color_sym);
+    g_free (h.buffer);
+    g_mapped_file_unref (mapped);
+
+    return pixbuf;
+}
@@ -24,6 +24,7 @@
 #include "config.h"
 #endif
 
+#include "compositor.h"
 #include "xsync.h"
 
 #ifdef HAVE_XSYNC
@@ -246,6 +247,7 @@ clientXSyncRequest (Client * c)
     xev.data.l[3] = (long) XSyncValueHigh32 (next_value);
     xev.data.l[4] = (long) (FLAG_TEST (c->flags, CLIENT_FLAG_XSYNC_EXT_COUNTER) ? 1 : 0);
     XSendEvent (display_info->dpy, c->window, FALSE, NoEventMask, (XEvent *) &xev);
+    c->xsync_request_time = g_get_monotonic_time ();
 
     clientXSyncResetTimeout (c);
     FLAG_SET (c->flags, CLIENT_FLAG_XSYNC_WAITING);
@@ -254,19 +256,104 @@ clientXSyncRequest (Client * c)
 void
 clientXSyncUpdateValue (Client *c, XSyncValue value)
 {
+    gint64 latency;
+
     g_return_if_fail (c != NULL);
     TRACE ("client \"%s\" (0x%lx)", c->name, c->window);
 
+    /* Smoothed time taken by the client to reply to a sync request */
+    if (c->xsync_request_time)
+    {
+        latency = g_get_monotonic_time () - c->xsync_request_time;
+        if (c->xsync_latency)
+        {
+            latency = (3 * c->xsync_latency + latency) / 4;
+        }
+        c->xsync_latency = latency;
+        c->xsync_request_time = 0;
+    }
+
     c->xsync_value = value;
     if (FLAG_TEST (c->flags, CLIENT_FLAG_XSYNC_EXT_COUNTER))
     {
         if (XSyncValueLow32(c->xsync_value) % 2 == 0)
         {
             addToXSyncValue (&value, 1);
+            clientXSyncFrameComplete (c);
         }
     }
     c->next_xsync_value = value;
     clientXSyncClearTimeout (c);
 }
 
+static void
+clientXSyncSendFrameMessage (Client *c, int message, guint64 serial, long l2, long l3, long l4)
+{
+    DisplayInfo *display_info;
+    XClientMessageEvent xev;
+
+    display_info = c->screen_info->display_info;
+
+    xev.type = ClientMessage;
+    xev.window = c->window;
+    xev.message_type = display_info->atoms[message];
+    xev.format = 32;
+    xev.data.l[0] = (long) (serial & G_GUINT64_CONSTANT (0xffffffff));
+    xev.data.l[1] = (long) (serial >> 32);
+    xev.data.l[2] = l2;
+    xev.data.l[3] = l3;
+    xev.data.l[4] = l4;
+
+    myDisplayErrorTrapPush (display_info);
+    XSendEvent (display_info->dpy, c->window, FALSE, NoEventMask, (XEvent *) &xev);
+    myDisplayErrorTrapPopIgnored (display_info);
+}
+
+/*
+ * With the extended counter, an even value means the client is done
+ * drawing a frame. The compositor tells the client once that frame made
+ * it to screen, so that the client can pace its rendering on ours, see
+ * compositorFrameComplete(). When not compositing, the frame is on screen
+ * already.
+ */
+void
+clientXSyncFrameComplete (Client *c)
+{
+    guint64 serial;
+
+    g_return_if_fail (c != NULL);
+    TRACE ("client \"%s\" (0x%lx)", c->name, c->window);
+
+    serial = ((guint64) XSyncValueHigh32 (c->xsync_value) << 32) |
+             (guint64) XSyncValueLow32 (c->xsync_value);
+
+    if (!compositorFrameComplete (c, serial))
+    {
+        clientXSyncFrameDrawn (c, serial, g_get_monotonic_time ());
+        clientXSyncFrameTimings (c, serial, 0, 0);
+    }
+}
+
+void
+clientXSyncFrameDrawn (Client *c, guint64 serial, gint64 drawn_time)
+{
+    g_return_if_fail (c != NULL);
+    TRACE ("client \"%s\" (0x%lx)", c->name, c->window);
+
+    clientXSyncSendFrameMessage (c, NET_WM_FRAME_DRAWN, serial,
+                                 (long) (drawn_time & G_GINT64_CONSTANT (0xffffffff)),
+                                 (long) (drawn_time >> 32), 0);
+}
+
+void
+clientXSyncFrameTimings (Client *c, guint64 serial, gint32 presentation_offset, guint32 refresh_interval)
+{
+    g_return_if_fail (c != NULL);
+    TRACE ("client \"%s\" (0x%lx)", c->name, c->window);
+
+    /* A presentation offset or refresh interval of 0 means unknown */
+    clientXSyncSendFrameMessage (c, NET_WM_FRAME_TIMINGS, serial,
+                                 (long) presentation_offset, (long) refresh_interval, 0);
+}
+
 #endif /* HAVE_XSYNC */
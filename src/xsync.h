@@ -52,6 +52,14 @@ void                     clientXSyncClearTimeout                (Client *);
 void                     clientXSyncRequest                     (Client *);
 void                     clientXSyncUpdateValue                 (Client *,
                                                                  XSyncValue);
+void                     clientXSyncFrameComplete               (Client *);
+void                     clientXSyncFrameDrawn                  (Client *,
+                                                                 guint64,
+                                                                 gint64);
+void                     clientXSyncFrameTimings                (Client *,
+                                                                 guint64,
+                                                                 gint32,
+                                                                 guint32);
 
 #endif /* HAVE_XSYNC */
 
@@ -0,0 +1,213 @@
+/*      $Id$
+
+        This program is free software; you can redistribute it and/or modify
+        it under the terms of the GNU General Public License as published by
+        the Free Software Foundation; either version 2, or (at your option)
+        any later version.
+
+        This program is distributed in the hope that it will be useful,
+        but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+        GNU General Public License for more details.
+
+        You should have received a copy of the GNU General Public License
+        along with this program; if not, write to the Free Software
+        Foundation, Inc., Inc., 51 Franklin Street, Fifth Floor, Boston,
+        MA 02110-1301, USA.
+
+
+        xfwm4    - (c) 2002-2022 Olivier Fourdan
+
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdlib.h>
+
+#include <glib.h>
+#include <gdk/gdk.h>
+
+#include "overlap.h"
+
+/*
+ * Times the smart placement search on random layouts of 10 to 500 windows
+ * on a 1920x1080 monitor, and checks the position found against the brute
+ * force overlap sum on the smaller layouts.
+ */
+
+#define MONITOR_WIDTH   1920
+#define MONITOR_HEIGHT  1080
+#define WINDOW_WIDTH    640
+#define WINDOW_HEIGHT   480
+#define LAYOUTS         20
+#define CHECK_MAX_RECTS 100
+
+static const guint sizes[] = { 10, 20, 50, 100, 200, 500 };
+
+static guint64
+overlap_at (const GdkRectangle *rects, guint n_rects, gint x, gint y)
+{
+    GdkRectangle win, inter;
+    guint64 total;
+    guint i;
+
+    win.x = x;
+    win.y = y;
+    win.width = WINDOW_WIDTH;
+    win.height = WINDOW_HEIGHT;
+    total = 0;
+    for (i = 0; i < n_rects; i++)
+    {
+        if (gdk_rectangle_intersect (&win, &rects[i], &inter))
+        {
+            total += (guint64) inter.width * inter.height;
+        }
+    }
+
+    return total;
+}
+
+static gint
+clamp_candidate (gint v, gint min, gint max)
+{
+    return CLAMP (v, min, max);
+}
+
+static guint64
+brute_force (const GdkRectangle *rects, guint n_rects, GdkRectangle *range)
+{
+    GArray *xs, *ys;
+    guint64 best, overlaps;
+    gint v;
+    guint i, j;
+
+    xs = g_array_new (FALSE, FALSE, sizeof (gint));
+    ys = g_array_new (FALSE, FALSE, sizeof (gint));
+    v = range->x;
+    g_array_append_val (xs, v);
+    v = range->x + range->width;
+    g_array_append_val (xs, v);
+    v = range->y;
+    g_array_append_val (ys, v);
+    v = range->y + range->height;
+    g_array_append_val (ys, v);
+    for (i = 0; i < n_rects; i++)
+    {
+        v = clamp_candidate (rects[i].x + rects[i].width, range->x, range->x + range->width);
+        g_array_append_val (xs, v);
+        v = clamp_candidate (rects[i].x - WINDOW_WIDTH, range->x, range->x + range->width);
+        g_array_append_val (xs, v);
+        v = clamp_candidate (rects[i].y + rects[i].height, range->y, range->y + range->height);
+        g_array_append_val (ys, v);
+        v = clamp_candidate (rects[i].y - WINDOW_HEIGHT, range->y, range->y + range->height);
+        g_array_append_val (ys, v);
+    }
+
+    best = G_MAXUINT64;
+    for (j = 0; j < ys->len; j++)
+    {
+        for (i = 0; i < xs->len; i++)
+        {
+            overlaps = overlap_at (rects, n_rects,
+                                   g_array_index (xs, gint, i),
+                                   g_array_index (ys, gint, j));
+            best = MIN (best, overlaps);
+        }
+    }
+    g_array_free (xs, TRUE);
+    g_array_free (ys, TRUE);
+
+    return best;
+}
+
+static gboolean
+check_clamped_edge (void)
+{
+    GdkRectangle range, obstacle;
+    gint x, y;
+
+    /* 1000 wide monitor, 400 wide window, obstacle from 100 to 700 */
+    obstacle.x = 100;
+    obstacle.y = 0;
+    obstacle.width = 600;
+    obstacle.height = WINDOW_HEIGHT;
+    range.x = 0;
+    range.y = 0;
+    range.width = 1000 - 400;
+    range.height = 0;
+    overlapFindLeast (&obstacle, 1, 400, WINDOW_HEIGHT, &range, &x, &y);
+    if (x != 600)
+    {
+        g_printerr ("Expected x=600 next to the obstacle, got x=%i\n", x);
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+int
+main (int argc, char **argv)
+{
+    GdkRectangle *rects, range;
+    GRand *rand;
+    guint64 overlaps, expected;
+    gint64 start, elapsed;
+    gint x, y;
+    guint s, l, i, n;
+    gboolean result;
+
+    result = check_clamped_edge ();
+
+    range.x = 0;
+    range.y = 0;
+    range.width = MONITOR_WIDTH - WINDOW_WIDTH;
+    range.height = MONITOR_HEIGHT - WINDOW_HEIGHT;
+
+    rand = g_rand_new_with_seed (42);
+    for (s = 0; s < G_N_ELEMENTS (sizes); s++)
+    {
+        n = sizes[s];
+        rects = g_new (GdkRectangle, n);
+        elapsed = 0;
+        for (l = 0; l < LAYOUTS; l++)
+        {
+            for (i = 0; i < n; i++)
+            {
+                rects[i].width = g_rand_int_range (rand, 100, 800);
+                rects[i].height = g_rand_int_range (rand, 100, 600);
+                rects[i].x = g_rand_int_range (rand, 0, MONITOR_WIDTH - rects[i].width);
+                rects[i].y = g_rand_int_range (rand, 0, MONITOR_HEIGHT - rects[i].height);
+            }
+
+            start = g_get_monotonic_time ();
+            overlaps = overlapFindLeast (rects, n, WINDOW_WIDTH, WINDOW_HEIGHT,
+                                         &range, &x, &y);
+            elapsed += g_get_monotonic_time () - start;
+
+            if (overlap_at (rects, n, x, y) != overlaps)
+            {
+                g_printerr ("%u windows: overlap at %i,%i is not %" G_GUINT64_FORMAT "\n",
+                            n, x, y, overlaps);
+                result = FALSE;
+            }
+            if (n <= CHECK_MAX_RECTS)
+            {
+                expected = brute_force (rects, n, &range);
+                if (expected != overlaps)
+                {
+                    g_printerr ("%u windows: found %" G_GUINT64_FORMAT
+                                ", brute force found %" G_GUINT64_FORMAT "\n",
+                                n, overlaps, expected);
+                    result = FALSE;
+                }
+            }
+        }
+        g_print ("%3u windows: %8.1f us per placement\n", n, (gdouble) elapsed / LAYOUTS);
+        g_free (rects);
+    }
+    g_rand_free (rand);
+
+    return result ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,135 @@
+/*      $Id$
+
+        This program is free software; you can redistribute it and/or modify
+        it under the terms of the GNU General Public License as published by
+        the Free Software Foundation; either version 2, or (at your option)
+        any later version.
+
+        This program is distributed in the hope that it will be useful,
+        but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+        GNU General Public License for more details.
+
+        You should have received a copy of the GNU General Public License
+        along with this program; if not, write to the Free Software
+        Foundation, Inc., Inc., 51 Franklin Street, Fifth Floor, Boston,
+        MA 02110-1301, USA.
+
+
+        xfwm4    - (c) 2002-2022 Olivier Fourdan
+
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <glib.h>
+#include <gdk-pixbuf/gdk-pixbuf.h>
+
+#include "xpmload.h"
+
+/*
+ * Loads every XPM image found under the themes directory given on the
+ * command line, checks that each one decodes, then times a number of
+ * passes over the whole set.
+ */
+
+#define PASSES 20
+
+static void
+collect_files (const gchar *path, GPtrArray *files)
+{
+    const gchar *name;
+    gchar *child;
+    GDir *dir;
+
+    dir = g_dir_open (path, 0, NULL);
+    if (dir == NULL)
+    {
+        return;
+    }
+
+    while ((name = g_dir_read_name (dir)) != NULL)
+    {
+        child = g_build_filename (path, name, NULL);
+        if (g_file_test (child, G_FILE_TEST_IS_DIR))
+        {
+            collect_files (child, files);
+            g_free (child);
+        }
+        else if (g_str_has_suffix (name, ".xpm"))
+        {
+            g_ptr_array_add (files, child);
+        }
+        else
+        {
+            g_free (child);
+        }
+    }
+    g_dir_close (dir);
+}
+
+int
+main (int argc, char **argv)
+{
+    GPtrArray *files;
+    GdkPixbuf *pixbuf;
+    guint64 pixels;
+    gint64 start, elapsed;
+    guint i, pass;
+    int status;
+
+    if (argc < 2)
+    {
+        g_printerr ("usage: %s THEMES_DIR\n", argv[0]);
+        return 2;
+    }
+
+    files = g_ptr_array_new_with_free_func (g_free);
+    collect_files (argv[1], files);
+    if (files->len == 0)
+    {
+        g_printerr ("no XPM file found under %s\n", argv[1]);
+        g_ptr_array_free (files, TRUE);
+        return 1;
+    }
+
+    status = 0;
+    pixels = 0;
+    for (i = 0; i < files->len; i++)
+    {
+        pixbuf = xpmImageLoad (g_ptr_array_index (files, i), NULL);
+        if (pixbuf == NULL)
+        {
+            g_printerr ("cannot load %s\n", (gchar *) g_ptr_array_index (files, i));
+            status = 1;
+            continue;
+        }
+        pixels += (guint64) gdk_pixbuf_get_width (pixbuf) * gdk_pixbuf_get_height (pixbuf);
+        g_object_unref (pixbuf);
+    }
+
+    start = g_get_monotonic_time ();
+    for (pass = 0; pass < PASSES; pass++)
+    {
+        for (i = 0; i < files->len; i++)
+        {
+            pixbuf = xpmImageLoad (g_ptr_array_index (files, i), NULL);
+            if (pixbuf)
+            {
+                g_object_unref (pixbuf);
+            }
+        }
+    }
+    elapsed = g_get_monotonic_time () - start;
+
+    g_print ("%u files, %" G_GUINT64_FORMAT " pixels: %.2f ms per pass, %.2f us per file\n",
+             files->len, pixels,
+             (gdouble) elapsed / PASSES / 1000.0,
+             (gdouble) elapsed / PASSES / files->len);
+
+    g_ptr_array_free (files, TRUE);
+
+    return status;
+}
@@ -0,0 +1,123 @@
+/*      $Id$
+
+        This program is free software; you can redistribute it and/or modify
+        it under the terms of the GNU General Public License as published by
+        the Free Software Foundation; either version 2, or (at your option)
+        any later version.
+
+        This program is distributed in the hope that it will be useful,
+        but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+        GNU General Public License for more details.
+
+        You should have received a copy of the GNU General Public License
+        along with this program; if not, write to the Free Software
+        Foundation, Inc., Inc., 51 Franklin Street, Fifth Floor, Boston,
+        MA 02110-1301, USA.
+
+
+        xfwm4    - (c) 2002-2022 Olivier Fourdan
+
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <X11/Xlib.h>
+#include <X11/Xutil.h>
+
+/*
+ * Creates and maps one window per "client" line of a scenario, in order,
+ * waiting for each to be mapped before mapping the next one so that the
+ * window manager frames them in the order of the scenario. Prints "ready"
+ * once they all are, then stays around until killed.
+ */
+
+static void
+wait_for_map (Display *dpy, Window w)
+{
+    XEvent xevent;
+
+    do
+    {
+        XWindowEvent (dpy, w, StructureNotifyMask, &xevent);
+    }
+    while (xevent.type != MapNotify);
+}
+
+int
+main (int argc, char **argv)
+{
+    Display *dpy;
+    FILE *scenario;
+    char line[256], title[128];
+    unsigned int width, height;
+    XSizeHints hints;
+    XEvent xevent;
+    Window w;
+    int n;
+
+    if (argc != 2)
+    {
+        fprintf (stderr, "Usage: %s SCENARIO\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    scenario = fopen (argv[1], "r");
+    if (!scenario)
+    {
+        fprintf (stderr, "Cannot read %s\n", argv[1]);
+        return EXIT_FAILURE;
+    }
+
+    dpy = XOpenDisplay (NULL);
+    if (!dpy)
+    {
+        fprintf (stderr, "Cannot open display\n");
+        fclose (scenario);
+        return EXIT_FAILURE;
+    }
+
+    n = 0;
+    while (fgets (line, sizeof (line), scenario))
+    {
+        title[0] = '\0';
+        if (sscanf (line, " client %u %u %127[^\n]", &width, &height, title) < 2)
+        {
+            continue;
+        }
+        if (title[0] == '\0')
+        {
+            snprintf (title, sizeof (title), "client %i", n);
+        }
+
+        w = XCreateSimpleWindow (dpy, DefaultRootWindow (dpy), 0, 0, width, height, 0,
+                                 BlackPixel (dpy, DefaultScreen (dpy)),
+                                 WhitePixel (dpy, DefaultScreen (dpy)));
+        XStoreName (dpy, w, title);
+        hints.flags = PSize;
+        hints.width = width;
+        hints.height = height;
+        XSetWMNormalHints (dpy, w, &hints);
+        XSelectInput (dpy, w, StructureNotifyMask);
+        XMapWindow (dpy, w);
+        wait_for_map (dpy, w);
+        n++;
+    }
+    fclose (scenario);
+
+    printf ("ready\n");
+    fflush (stdout);
+
+    for (;;)
+    {
+        XNextEvent (dpy, &xevent);
+    }
+
+    return EXIT_SUCCESS;
+}
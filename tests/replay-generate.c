@@ -0,0 +1,293 @@
+/*      $Id$
+
+        This program is free software; you can redistribute it and/or modify
+        it under the terms of the GNU General Public License as published by
+        the Free Software Foundation; either version 2, or (at your option)
+        any later version.
+
+        This program is distributed in the hope that it will be useful,
+        but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+        GNU General Public License for more details.
+
+        You should have received a copy of the GNU General Public License
+        along with this program; if not, write to the Free Software
+        Foundation, Inc., Inc., 51 Franklin Street, Fifth Floor, Boston,
+        MA 02110-1301, USA.
+
+
+        xfwm4    - (c) 2002-2022 Olivier Fourdan
+
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <X11/Xlib.h>
+#include <glib.h>
+
+#include "eventrecordfile.h"
+
+/*
+ * Writes an event recording from a scenario, see scenarios/README for
+ * the syntax. Window IDs are made up, they are bound to the windows of
+ * the replaying session through the client records, one per "client"
+ * line of the scenario, in order.
+ */
+
+#define FAKE_ROOT               0x00e00001
+#define FAKE_WINDOW(n, slot)    (0x00f00000 | ((n) << 8) | ((slot) + 1))
+#define TIME_BASE               1000
+
+typedef struct
+{
+    FILE *file;
+    gint clients;
+    gint64 time;
+    guint pressed;
+} Generator;
+
+static const gchar *part_names[] =
+{
+    "window", "frame", "title",
+    "left", "right", "top", "bottom",
+    "bottom-left", "bottom-right", "top-left", "top-right",
+    "menu", "stick", "shade", "hide", "maximize", "close",
+    NULL
+};
+
+static gint
+lookup_part (const gchar *name)
+{
+    gint i;
+
+    for (i = 0; part_names[i]; i++)
+    {
+        if (strcmp (part_names[i], name) == 0)
+        {
+            /* The names above follow the slots of client records */
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+static void
+write_record (Generator *gen, XEvent *xevent)
+{
+    EventRecord record;
+
+    memset (&record, 0, sizeof (record));
+    record.time = gen->time * 1000;
+    record.xevent = *xevent;
+    fwrite (&record, sizeof (record), 1, gen->file);
+}
+
+static void
+write_client (Generator *gen)
+{
+    EventRecordClient client;
+    XEvent xevent;
+    gint slot;
+
+    memset (&client, 0, sizeof (client));
+    client.type = RECORD_CLIENT;
+    for (slot = 0; part_names[slot]; slot++)
+    {
+        client.windows[slot] = FAKE_WINDOW (gen->clients, slot);
+    }
+    memset (&xevent, 0, sizeof (xevent));
+    memcpy (&xevent, &client, sizeof (client));
+    write_record (gen, &xevent);
+    gen->clients++;
+}
+
+static void
+write_pointer (Generator *gen, int type, gint n, gint part, gint x, gint y, guint button)
+{
+    XEvent xevent;
+
+    memset (&xevent, 0, sizeof (xevent));
+    xevent.type = type;
+    xevent.xany.window = FAKE_WINDOW (n, part);
+    if (type == MotionNotify)
+    {
+        xevent.xmotion.root = FAKE_ROOT;
+        xevent.xmotion.time = TIME_BASE + gen->time;
+        xevent.xmotion.x = xevent.xmotion.x_root = x;
+        xevent.xmotion.y = xevent.xmotion.y_root = y;
+        xevent.xmotion.state = gen->pressed ? (Button1Mask << (gen->pressed - 1)) : 0;
+        xevent.xmotion.same_screen = True;
+    }
+    else
+    {
+        xevent.xbutton.root = FAKE_ROOT;
+        xevent.xbutton.time = TIME_BASE + gen->time;
+        xevent.xbutton.x = xevent.xbutton.x_root = x;
+        xevent.xbutton.y = xevent.xbutton.y_root = y;
+        xevent.xbutton.button = button;
+        xevent.xbutton.state = (type == ButtonRelease) ? (Button1Mask << (button - 1)) : 0;
+        xevent.xbutton.same_screen = True;
+        gen->pressed = (type == ButtonPress) ? button : 0;
+    }
+    write_record (gen, &xevent);
+    /* Leave some time between events, like a real pointer would */
+    gen->time += 10;
+}
+
+static gchar **
+split_fields (const gchar *line, gint *nargs)
+{
+    gchar **fields, **args;
+    gint i;
+
+    fields = g_strsplit_set (line, " \t", -1);
+    args = g_new0 (gchar *, g_strv_length (fields) + 1);
+    *nargs = 0;
+    for (i = 0; fields[i]; i++)
+    {
+        if (fields[i][0] != '\0')
+        {
+            args[(*nargs)++] = g_strdup (fields[i]);
+        }
+    }
+    g_strfreev (fields);
+
+    return args;
+}
+
+static gboolean
+parse_line (Generator *gen, gchar **argv, gint argc)
+{
+    gint n, part, x0, y0, x1, y1, steps, i;
+    guint button;
+
+    if (strcmp (argv[0], "client") == 0)
+    {
+        write_client (gen);
+        return TRUE;
+    }
+    if (strcmp (argv[0], "wait") == 0 && argc == 2)
+    {
+        gen->time += atoi (argv[1]);
+        return TRUE;
+    }
+    if (strcmp (argv[0], "expect") == 0)
+    {
+        /* For the test runner */
+        return TRUE;
+    }
+
+    if (argc < 5)
+    {
+        return FALSE;
+    }
+    n = atoi (argv[1]);
+    part = lookup_part (argv[2]);
+    if ((n < 0) || (n >= gen->clients) || (part < 0))
+    {
+        return FALSE;
+    }
+    x0 = atoi (argv[3]);
+    y0 = atoi (argv[4]);
+
+    if (strcmp (argv[0], "press") == 0 || strcmp (argv[0], "release") == 0)
+    {
+        button = (argc > 5) ? (guint) atoi (argv[5]) : Button1;
+        write_pointer (gen, (argv[0][0] == 'p') ? ButtonPress : ButtonRelease,
+                       n, part, x0, y0, button);
+        return TRUE;
+    }
+    if (strcmp (argv[0], "motion") == 0)
+    {
+        write_pointer (gen, MotionNotify, n, part, x0, y0, 0);
+        return TRUE;
+    }
+    if (strcmp (argv[0], "drag") == 0 && argc >= 7)
+    {
+        x1 = atoi (argv[5]);
+        y1 = atoi (argv[6]);
+        steps = (argc > 7) ? MAX (1, atoi (argv[7])) : 10;
+        write_pointer (gen, ButtonPress, n, part, x0, y0, Button1);
+        for (i = 1; i <= steps; i++)
+        {
+            write_pointer (gen, MotionNotify, n, part,
+                           x0 + (x1 - x0) * i / steps,
+                           y0 + (y1 - y0) * i / steps, 0);
+        }
+        write_pointer (gen, ButtonRelease, n, part, x1, y1, Button1);
+        return TRUE;
+    }
+
+    return FALSE;
+}
+
+int
+main (int argc, char **argv)
+{
+    EventRecordHeader header;
+    Generator gen;
+    gchar *contents, **lines, **args;
+    GError *error;
+    gint i, nargs;
+    gboolean result;
+
+    if (argc != 3)
+    {
+        g_printerr ("Usage: %s SCENARIO RECORDING\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    error = NULL;
+    if (!g_file_get_contents (argv[1], &contents, NULL, &error))
+    {
+        g_printerr ("%s\n", error->message);
+        g_error_free (error);
+        return EXIT_FAILURE;
+    }
+
+    memset (&gen, 0, sizeof (gen));
+    gen.file = fopen (argv[2], "wb");
+    if (!gen.file)
+    {
+        g_printerr ("Cannot write %s\n", argv[2]);
+        g_free (contents);
+        return EXIT_FAILURE;
+    }
+
+    memset (&header, 0, sizeof (header));
+    g_strlcpy (header.magic, RECORD_MAGIC, sizeof (header.magic));
+    header.version = RECORD_VERSION;
+    header.event_size = sizeof (XEvent);
+    header.root = FAKE_ROOT;
+    fwrite (&header, sizeof (header), 1, gen.file);
+
+    result = TRUE;
+    lines = g_strsplit (contents, "\n", -1);
+    for (i = 0; result && lines[i]; i++)
+    {
+        g_strstrip (lines[i]);
+        if (lines[i][0] == '\0' || lines[i][0] == '#')
+        {
+            continue;
+        }
+        args = split_fields (lines[i], &nargs);
+        if (!parse_line (&gen, args, nargs))
+        {
+            g_printerr ("%s:%i: cannot parse \"%s\"\n", argv[1], i + 1, lines[i]);
+            result = FALSE;
+        }
+        g_strfreev (args);
+    }
+    g_strfreev (lines);
+    g_free (contents);
+    fclose (gen.file);
+
+    return result ? EXIT_SUCCESS : EXIT_FAILURE;
+}
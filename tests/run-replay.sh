@@ -0,0 +1,117 @@
+#!/bin/sh
+#
+# Replays a scenario against xfwm4 on a private Xvfb server and checks
+# the "expect" lines of the scenario against the requests and round-trips
+# reported, either for the whole replay ("replay") or for an operation
+# of the statistics written by --trace-requests-file, e.g.
+#
+#   expect replay round_trips 200
+#   expect move max_round_trips 4
+#
+# Usage: run-replay.sh XFWM4 GENERATE CLIENT SCENARIO
+
+set -e
+
+if [ $# -ne 4 ]; then
+    echo "Usage: $0 XFWM4 GENERATE CLIENT SCENARIO" >&2
+    exit 1
+fi
+
+xfwm4=$1
+generate=$2
+client=$3
+scenario=$4
+name=$(basename "$scenario" .scenario)
+
+# Exit status 77 marks the test as skipped for both meson and automake
+for program in Xvfb dbus-run-session; do
+    if ! command -v "$program" >/dev/null 2>&1; then
+        echo "$name: $program not found, skipping" >&2
+        exit 77
+    fi
+done
+
+tmpdir=$(mktemp -d)
+xvfb_pid=
+client_pid=
+
+cleanup () {
+    [ -n "$client_pid" ] && kill "$client_pid" 2>/dev/null
+    [ -n "$xvfb_pid" ] && kill "$xvfb_pid" 2>/dev/null
+    rm -rf "$tmpdir"
+}
+trap cleanup EXIT
+
+"$generate" "$scenario" "$tmpdir/$name.rec"
+
+Xvfb -displayfd 3 -screen 0 1280x1024x24 -nolisten tcp 3>"$tmpdir/display" 2>/dev/null &
+xvfb_pid=$!
+for i in $(seq 50); do
+    [ -s "$tmpdir/display" ] && break
+    sleep 0.1
+done
+if [ ! -s "$tmpdir/display" ]; then
+    echo "$name: Xvfb did not start" >&2
+    exit 1
+fi
+DISPLAY=:$(cat "$tmpdir/display")
+export DISPLAY
+
+# Keep away from the settings of whoever runs the tests
+HOME=$tmpdir
+XDG_CONFIG_HOME=$tmpdir/config
+XDG_CACHE_HOME=$tmpdir/cache
+export HOME XDG_CONFIG_HOME XDG_CACHE_HOME
+
+mkfifo "$tmpdir/client"
+"$client" "$scenario" > "$tmpdir/client" &
+client_pid=$!
+read ready < "$tmpdir/client" || true
+if [ "$ready" != "ready" ]; then
+    echo "$name: the test client failed" >&2
+    exit 1
+fi
+
+timeout 120 dbus-run-session -- "$xfwm4" --compositor=off \
+    --replay-events "$tmpdir/$name.rec" --quit-after-replay \
+    --trace-requests-file "$tmpdir/requests" > "$tmpdir/output" 2>"$tmpdir/errors" || {
+    cat "$tmpdir/errors" >&2
+    echo "$name: xfwm4 failed" >&2
+    exit 1
+}
+
+report=$(grep '^Replayed ' "$tmpdir/output" || true)
+if [ -z "$report" ]; then
+    cat "$tmpdir/errors" >&2
+    echo "$name: nothing replayed" >&2
+    exit 1
+fi
+echo "$name: $report"
+
+# "Replayed N events from FILE in T ms, R X requests, RT round-trips"
+replay_requests=$(echo "$report" | sed -n 's/.* \([0-9]*\) X requests.*/\1/p')
+replay_round_trips=$(echo "$report" | sed -n 's/.* \([0-9]*\) round-trips.*/\1/p')
+
+status=0
+grep '^[[:space:]]*expect[[:space:]]' "$scenario" | while read -r expect operation field max; do
+    if [ "$operation" = "replay" ]; then
+        case $field in
+            requests) value=$replay_requests ;;
+            round_trips) value=$replay_round_trips ;;
+            *) value= ;;
+        esac
+    else
+        value=$(sed -n "s/^operation name=$operation .* $field=\([0-9]*\).*/\1/p" "$tmpdir/requests")
+    fi
+    if [ -z "$value" ]; then
+        echo "$name: no $field for $operation" >&2
+        exit 1
+    fi
+    if [ "$value" -gt "$max" ]; then
+        echo "$name: $operation $field is $value, expected at most $max" >&2
+        exit 1
+    fi
+    echo "$name: $operation $field $value (at most $max)"
+done || status=1
+
+exit $status
@@ -0,0 +1,371 @@
+/*      $Id$
+
+        This program is free software; you can redistribute it and/or modify
+        it under the terms of the GNU General Public License as published by
+        the Free Software Foundation; either version 2, or (at your option)
+        any later version.
+
+        This program is distributed in the hope that it will be useful,
+        but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+        GNU General Public License for more details.
+
+        You should have received a copy of the GNU General Public License
+        along with this program; if not, write to the Free Software
+        Foundation, Inc., Inc., 51 Franklin Street, Fifth Floor, Boston,
+        MA 02110-1301, USA.
+
+
+        xfwm4    - (c) 2002-2022 Olivier Fourdan
+
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <string.h>
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <gdk-pixbuf/gdk-pixbuf.h>
+
+#include "xpmload.h"
+
+/*
+ * Each case writes an XPM image along with the pixels it must decode to,
+ * then compares what xpmImageLoad() gives, pixel per pixel. Cases without
+ * color symbols are also compared with the XPM loader of gdk-pixbuf,
+ * which xpmload.c derives from, when that loader is available.
+ */
+
+/* Key characters, no quote nor backslash */
+#define KEY_CHARS "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789.#"
+
+typedef struct
+{
+    const gchar *name;
+    GString *xpm;
+    gint width;
+    gint height;
+    guchar *expected;
+    xfwmColorSymbol *symbols;
+}
+XpmCase;
+
+static void
+xpm_case_init (XpmCase *xc, const gchar *name, gint width, gint height, gint n_col, gint cpp)
+{
+    xc->name = name;
+    xc->width = width;
+    xc->height = height;
+    xc->expected = g_new0 (guchar, width * height * 4);
+    xc->symbols = NULL;
+    xc->xpm = g_string_new ("/* XPM */\nstatic char * test_xpm[] = {\n");
+    g_string_append_printf (xc->xpm, "\"%d %d %d %d\",\n", width, height, n_col, cpp);
+}
+
+static void
+xpm_case_free (XpmCase *xc)
+{
+    g_string_free (xc->xpm, TRUE);
+    g_free (xc->expected);
+}
+
+static void
+xpm_case_line (XpmCase *xc, const gchar *line)
+{
+    g_string_append_printf (xc->xpm, "\"%s\",\n", line);
+}
+
+/* Transparent pixels are all zeroes */
+static void
+xpm_case_expect (XpmCase *xc, gint x, gint y, guint rgb, gboolean transparent)
+{
+    guchar *p;
+
+    p = &xc->expected[(y * xc->width + x) * 4];
+    p[0] = transparent ? 0 : (rgb >> 16) & 0xff;
+    p[1] = transparent ? 0 : (rgb >> 8) & 0xff;
+    p[2] = transparent ? 0 : rgb & 0xff;
+    p[3] = transparent ? 0 : 0xff;
+}
+
+static gboolean
+compare_pixels (const gchar *name, const gchar *loader, GdkPixbuf *pixbuf, XpmCase *xc)
+{
+    const guchar *row, *p, *q;
+    gint channels;
+    gint x, y;
+    guchar alpha;
+
+    if ((gdk_pixbuf_get_width (pixbuf) != xc->width) ||
+        (gdk_pixbuf_get_height (pixbuf) != xc->height))
+    {
+        g_printerr ("%s: %s gives a %ix%i image, expected %ix%i\n", name, loader,
+                    gdk_pixbuf_get_width (pixbuf), gdk_pixbuf_get_height (pixbuf),
+                    xc->width, xc->height);
+        return FALSE;
+    }
+
+    channels = gdk_pixbuf_get_n_channels (pixbuf);
+    for (y = 0; y < xc->height; y++)
+    {
+        row = gdk_pixbuf_get_pixels (pixbuf) + y * gdk_pixbuf_get_rowstride (pixbuf);
+        for (x = 0; x < xc->width; x++)
+        {
+            p = &row[x * channels];
+            q = &xc->expected[(y * xc->width + x) * 4];
+            alpha = (channels == 4) ? p[3] : 0xff;
+            /* Only compare the color of visible pixels */
+            if ((alpha != q[3]) || ((alpha != 0) && memcmp (p, q, 3) != 0))
+            {
+                g_printerr ("%s: %s gives %02x%02x%02x/%02x at %i,%i, expected %02x%02x%02x/%02x\n",
+                            name, loader, p[0], p[1], p[2], alpha, x, y, q[0], q[1], q[2], q[3]);
+                return FALSE;
+            }
+        }
+    }
+
+    return TRUE;
+}
+
+static gboolean
+xpm_case_check (XpmCase *xc)
+{
+    GdkPixbuf *pixbuf;
+    GError *error;
+    gchar *filename;
+    gboolean result;
+    gint fd;
+
+    g_string_append (xc->xpm, "};\n");
+
+    error = NULL;
+    fd = g_file_open_tmp ("xfwm4-test-XXXXXX.xpm", &filename, &error);
+    if (fd < 0)
+    {
+        g_printerr ("%s: %s\n", xc->name, error->message);
+        g_error_free (error);
+        return FALSE;
+    }
+    g_close (fd, NULL);
+
+    if (!g_file_set_contents (filename, xc->xpm->str, xc->xpm->len, &error))
+    {
+        g_printerr ("%s: %s\n", xc->name, error->message);
+        g_error_free (error);
+        g_free (filename);
+        return FALSE;
+    }
+
+    result = TRUE;
+    pixbuf = xpmImageLoad (filename, xc->symbols);
+    if (pixbuf == NULL)
+    {
+        g_printerr ("%s: xpmImageLoad failed\n", xc->name);
+        result = FALSE;
+    }
+    else
+    {
+        result = compare_pixels (xc->name, "xpmImageLoad", pixbuf, xc);
+        g_object_unref (pixbuf);
+    }
+
+    /* gdk-pixbuf knows nothing of the color symbols of the theme */
+    if (xc->symbols == NULL)
+    {
+        pixbuf = gdk_pixbuf_new_from_file (filename, NULL);
+        if (pixbuf)
+        {
+            result = compare_pixels (xc->name, "gdk-pixbuf", pixbuf, xc) && result;
+            g_object_unref (pixbuf);
+        }
+    }
+
+    g_unlink (filename);
+    g_free (filename);
+
+    g_print ("%s: %s\n", xc->name, result ? "ok" : "FAILED");
+
+    return result;
+}
+
+/* The last entry of a key wins */
+static gboolean
+test_duplicate_keys (void)
+{
+    XpmCase xc;
+    gboolean result;
+    gint x;
+
+    xpm_case_init (&xc, "duplicate keys", 4, 1, 3, 1);
+    xpm_case_line (&xc, "a c #ff0000");
+    xpm_case_line (&xc, "b c #00ff00");
+    xpm_case_line (&xc, "a c #0000ff");
+    xpm_case_line (&xc, "abab");
+    for (x = 0; x < 4; x++)
+    {
+        xpm_case_expect (&xc, x, 0, (x % 2) ? 0x00ff00 : 0x0000ff, FALSE);
+    }
+
+    result = xpm_case_check (&xc);
+    xpm_case_free (&xc);
+
+    return result;
+}
+
+/* Pixels with an unknown key take the first color */
+static gboolean
+test_missing_key (void)
+{
+    XpmCase xc;
+    gboolean result;
+    gchar *line;
+    gint width, x;
+
+    /* The known keys, then every other key character */
+    width = strlen (KEY_CHARS);
+    xpm_case_init (&xc, "missing key", width, 1, 2, 1);
+    xpm_case_line (&xc, "b c #405060");
+    xpm_case_line (&xc, "a c #102030");
+    line = g_strconcat ("ba", &KEY_CHARS[2], NULL);
+    xpm_case_line (&xc, line);
+    g_free (line);
+    xpm_case_expect (&xc, 0, 0, 0x405060, FALSE);
+    for (x = 1; x < width; x++)
+    {
+        xpm_case_expect (&xc, x, 0, (x == 1) ? 0x102030 : 0x405060, FALSE);
+    }
+
+    result = xpm_case_check (&xc);
+    xpm_case_free (&xc);
+
+    return result;
+}
+
+/* Keys sharing characters, and runs of the same key */
+static gboolean
+test_multi_char_keys (void)
+{
+    static const gchar *keys[] = { "aaa", "aab", "aba", "baa", "a a" };
+    static const guint rgb[] = { 0x010203, 0x102030, 0x203040, 0x304050, 0x405060 };
+    static const gint row[] = { 0, 0, 1, 2, 3, 4, 4, 2, 1, 0 };
+    XpmCase xc;
+    GString *line;
+    gboolean result;
+    gchar *entry;
+    guint i;
+
+    xpm_case_init (&xc, "multi character keys", G_N_ELEMENTS (row), 1, G_N_ELEMENTS (keys), 3);
+    for (i = 0; i < G_N_ELEMENTS (keys); i++)
+    {
+        entry = g_strdup_printf ("%s c #%06x", keys[i], rgb[i]);
+        xpm_case_line (&xc, entry);
+        g_free (entry);
+    }
+    line = g_string_new (NULL);
+    for (i = 0; i < G_N_ELEMENTS (row); i++)
+    {
+        g_string_append (line, keys[row[i]]);
+        xpm_case_expect (&xc, i, 0, rgb[row[i]], FALSE);
+    }
+    xpm_case_line (&xc, line->str);
+    g_string_free (line, TRUE);
+
+    result = xpm_case_check (&xc);
+    xpm_case_free (&xc);
+
+    return result;
+}
+
+/* More colors than a single character key can address */
+static gboolean
+test_many_colors (void)
+{
+    const gint n_col = 700;
+    const gint width = 35;
+    const gint height = 20;
+    XpmCase xc;
+    GString *line;
+    gboolean result;
+    gchar *entry;
+    gint i, x, y;
+    guint rgb;
+
+    xpm_case_init (&xc, "many colors", width, height, n_col, 2);
+    for (i = 0; i < n_col; i++)
+    {
+        rgb = (i * 0x2f1d3) & 0xffffff;
+        entry = g_strdup_printf ("%c%c c #%06x", KEY_CHARS[i / 64], KEY_CHARS[i % 64], rgb);
+        xpm_case_line (&xc, entry);
+        g_free (entry);
+    }
+    line = g_string_new (NULL);
+    for (y = 0; y < height; y++)
+    {
+        g_string_truncate (line, 0);
+        for (x = 0; x < width; x++)
+        {
+            /* Spread the colors over the image */
+            i = ((y * width + x) * 7) % n_col;
+            g_string_append_c (line, KEY_CHARS[i / 64]);
+            g_string_append_c (line, KEY_CHARS[i % 64]);
+            xpm_case_expect (&xc, x, y, (i * 0x2f1d3) & 0xffffff, FALSE);
+        }
+        xpm_case_line (&xc, line->str);
+    }
+    g_string_free (line, TRUE);
+
+    result = xpm_case_check (&xc);
+    xpm_case_free (&xc);
+
+    return result;
+}
+
+/* None, color names and the color symbols of the theme */
+static gboolean
+test_symbolic_colors (void)
+{
+    xfwmColorSymbol symbols[] = {
+        { (gchar *) "active_color_1", "#ff8000" },
+        { NULL, NULL }
+    };
+    XpmCase xc;
+    gboolean result;
+
+    xpm_case_init (&xc, "symbolic colors", 6, 1, 6, 1);
+    xc.symbols = symbols;
+    xpm_case_line (&xc, "  c None");
+    xpm_case_line (&xc, "a s active_color_1 c #111111");
+    xpm_case_line (&xc, "b s inactive_color_2 c #222222");
+    xpm_case_line (&xc, "c c red");
+    xpm_case_line (&xc, "d s missing_color");
+    xpm_case_line (&xc, "e c NONE");
+    xpm_case_line (&xc, " abcde");
+    xpm_case_expect (&xc, 0, 0, 0, TRUE);
+    xpm_case_expect (&xc, 1, 0, 0xff8000, FALSE);
+    xpm_case_expect (&xc, 2, 0, 0x222222, FALSE);
+    xpm_case_expect (&xc, 3, 0, 0xff0000, FALSE);
+    xpm_case_expect (&xc, 4, 0, 0, TRUE);
+    xpm_case_expect (&xc, 5, 0, 0, TRUE);
+
+    result = xpm_case_check (&xc);
+    xpm_case_free (&xc);
+
+    return result;
+}
+
+int
+main (int argc, char **argv)
+{
+    gboolean result;
+
+    result = TRUE;
+    result = test_duplicate_keys () && result;
+    result = test_missing_key () && result;
+    result = test_multi_char_keys () && result;
+    result = test_many_colors () && result;
+    result = test_symbolic_colors () && result;
+
+    return result ? 0 : 1;
+}